@@ -0,0 +1,154 @@
+#ifndef _MGARD_ASYNC_HPP
+#define _MGARD_ASYNC_HPP
+
+#include <vector>
+#include <memory>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstring>
+#include "decompose.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// in-situ front end of Decomposer
+// fields are snapshotted into one of max_queue_depth reusable buffers and
+// decomposed by a background pool, so the caller can reuse its array as soon
+// as submit returns
+template <class T>
+class AsyncDecomposer{
+public:
+    // stage executed on the worker after decomposition (e.g. quantization and encoding)
+    // coefficients are only valid during the call
+    typedef function<void(const T * coeff, const vector<size_t>& dims, int levels)> Callback;
+
+    AsyncDecomposer(int num_workers=1, size_t max_queue_depth_=2, bool hierarchical_=false) : pool(num_workers){
+        if(max_queue_depth_ < 1) max_queue_depth_ = 1;
+        hierarchical = hierarchical_;
+        snapshots.resize(max_queue_depth_);
+        for(int i=max_queue_depth_-1; i>=0; i--){
+            free_slots.push_back(i);
+        }
+        for(int i=0; i<pool.num_threads(); i++){
+            decomposers.push_back(unique_ptr<Decomposer<T>>(new Decomposer<T>()));
+            free_decomposers.push_back(decomposers.back().get());
+        }
+    }
+    ~AsyncDecomposer(){
+        pool.wait();
+    }
+    // copy the field into a snapshot buffer and return
+    // blocks only while all snapshot buffers are in use (backpressure)
+    future<int> submit(const T * data, const vector<size_t>& dims, size_t target_level, Callback callback=Callback()){
+        int slot = acquire_slot(true);
+        return enqueue(slot, data, dims, target_level, callback);
+    }
+    // hand the field over without copying: the storage of field is swapped
+    // with a recycled snapshot buffer, whose old content is undefined
+    // a field whose size does not match dims is rejected: field is left as is and
+    // the returned future is not valid()
+    future<int> submit(vector<T>& field, const vector<size_t>& dims, size_t target_level, Callback callback=Callback()){
+        size_t num_elements = 1;
+        for(const auto& d:dims){
+            num_elements *= d;
+        }
+        if(field.size() != num_elements){
+            cerr << "submitted field has " << field.size() << " values, dims give " << num_elements << endl;
+            return future<int>();
+        }
+        int slot = acquire_slot(true);
+        snapshots[slot].swap(field);
+        field.resize(snapshots[slot].size());
+        return enqueue(slot, NULL, dims, target_level, callback);
+    }
+    // non-blocking submit, returns false if all snapshot buffers are in use
+    bool try_submit(const T * data, const vector<size_t>& dims, size_t target_level, future<int>& result, Callback callback=Callback()){
+        int slot = acquire_slot(false);
+        if(slot < 0) return false;
+        result = enqueue(slot, data, dims, target_level, callback);
+        return true;
+    }
+    // number of fields queued or being decomposed
+    size_t queue_depth(){
+        unique_lock<mutex> lock(slot_mutex);
+        return snapshots.size() - free_slots.size();
+    }
+    size_t max_queue_depth() const{
+        return snapshots.size();
+    }
+    // block until all submitted fields are processed
+    void wait(){
+        pool.wait();
+    }
+
+private:
+    bool hierarchical = false;
+    vector<vector<T>> snapshots;            // double (or deeper) buffered copies of the fields
+    vector<int> free_slots;
+    vector<unique_ptr<Decomposer<T>>> decomposers;  // one workspace per worker
+    vector<Decomposer<T> *> free_decomposers;
+    mutex slot_mutex;
+    condition_variable slot_cv;
+    ThreadPool pool;
+
+    int acquire_slot(bool block){
+        unique_lock<mutex> lock(slot_mutex);
+        if(free_slots.empty()){
+            if(!block) return -1;
+            slot_cv.wait(lock, [this]{ return !free_slots.empty(); });
+        }
+        int slot = free_slots.back();
+        free_slots.pop_back();
+        return slot;
+    }
+    void release_slot(int slot){
+        {
+            unique_lock<mutex> lock(slot_mutex);
+            free_slots.push_back(slot);
+        }
+        slot_cv.notify_one();
+    }
+    future<int> enqueue(int slot, const T * data, const vector<size_t>& dims, size_t target_level, Callback callback){
+        size_t num_elements = 1;
+        for(const auto& d:dims){
+            num_elements *= d;
+        }
+        vector<T>& snapshot = snapshots[slot];
+        if(data){
+            snapshot.resize(num_elements);
+            memcpy(snapshot.data(), data, num_elements * sizeof(T));
+        }
+        auto result = make_shared<promise<int>>();
+        future<int> fut = result->get_future();
+        bool hb = hierarchical;
+        pool.submit([this, slot, dims, target_level, callback, result, hb]{
+            Decomposer<T> * decomposer = NULL;
+            {
+                unique_lock<mutex> lock(slot_mutex);
+                decomposer = free_decomposers.back();
+                free_decomposers.pop_back();
+            }
+            try{
+                int levels = decomposer->decompose(snapshots[slot].data(), dims, target_level, hb);
+                if(callback) callback(snapshots[slot].data(), dims, levels);
+                result->set_value(levels);
+            }
+            catch(...){
+                result->set_exception(current_exception());
+            }
+            {
+                unique_lock<mutex> lock(slot_mutex);
+                free_decomposers.push_back(decomposer);
+            }
+            release_slot(slot);
+        });
+        return fut;
+    }
+};
+
+}
+#endif
@@ -0,0 +1,100 @@
+#ifndef _MGARD_BATCH_HPP
+#define _MGARD_BATCH_HPP
+
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include "decompose.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// one variable of a batch, decomposed in place
+template <class T>
+struct BatchField{
+    T * data;
+    vector<size_t> dims;
+    size_t target_level;
+    int levels;         // output: number of levels actually performed
+    double time;        // output: decomposition time in seconds
+    BatchField(T * data_, const vector<size_t>& dims_, size_t target_level_) : data(data_), dims(dims_), target_level(target_level_), levels(0), time(0){}
+};
+
+// aggregate statistics of a batch
+struct BatchStatistics{
+    size_t num_fields = 0;
+    size_t num_elements = 0;
+    size_t num_bytes = 0;
+    double wall_time = 0;       // elapsed time of the whole batch
+    double field_time = 0;      // sum of per-field decomposition times
+    double min_field_time = 0;
+    double max_field_time = 0;
+    double throughput = 0;      // MB/s over wall_time
+};
+
+// decompose many variables concurrently on a work-stealing pool
+// fields are scheduled largest first; fields larger than an even share of the
+// batch also parallelize their 3D levels on the same pool (nested parallelism)
+// each thread keeps its own Decomposer, so workspaces and Thomas factors are
+// reused across fields of identical shape instead of being reallocated
+template <class T>
+class BatchDecomposer{
+public:
+    BatchDecomposer(ThreadPool& pool_) : pool(pool_){
+        for(int i=0; i<=pool.num_threads(); i++){
+            decomposers.push_back(unique_ptr<Decomposer<T>>(new Decomposer<T>()));
+        }
+    }
+    BatchStatistics decompose(vector<BatchField<T>>& fields, bool hierarchical=false){
+        typedef chrono::steady_clock clock;
+        BatchStatistics stats;
+        stats.num_fields = fields.size();
+        if(fields.empty()) return stats;
+        vector<size_t> num_elements(fields.size(), 1);
+        for(int i=0; i<fields.size(); i++){
+            for(const auto& d:fields[i].dims){
+                num_elements[i] *= d;
+            }
+            stats.num_elements += num_elements[i];
+        }
+        stats.num_bytes = stats.num_elements * sizeof(T);
+        // largest first, identical shapes end up adjacent
+        vector<size_t> order(fields.size());
+        for(int i=0; i<order.size(); i++) order[i] = i;
+        stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){
+            if(num_elements[a] != num_elements[b]) return num_elements[a] > num_elements[b];
+            return fields[a].dims < fields[b].dims;
+        });
+        size_t nested_threshold = max(stats.num_elements / pool.num_threads(), min_nested_elements);
+        auto start = clock::now();
+        pool.parallel_for(0, order.size(), [&](size_t i){
+            BatchField<T>& field = fields[order[i]];
+            Decomposer<T>& decomposer = *decomposers[pool.thread_index()];
+            decomposer.set_thread_pool((num_elements[order[i]] >= nested_threshold) ? &pool : NULL);
+            auto field_start = clock::now();
+            field.levels = decomposer.decompose(field.data, field.dims, field.target_level, hierarchical);
+            field.time = chrono::duration<double>(clock::now() - field_start).count();
+        });
+        stats.wall_time = chrono::duration<double>(clock::now() - start).count();
+        stats.min_field_time = fields[0].time;
+        for(const auto& field:fields){
+            stats.field_time += field.time;
+            stats.min_field_time = min(stats.min_field_time, field.time);
+            stats.max_field_time = max(stats.max_field_time, field.time);
+        }
+        stats.throughput = stats.num_bytes / stats.wall_time / 1e6;
+        return stats;
+    }
+    // fields below this size are never split across threads
+    size_t min_nested_elements = 1 << 20;
+
+private:
+    ThreadPool& pool;
+    vector<unique_ptr<Decomposer<T>>> decomposers;  // indexed by pool.thread_index()
+};
+
+}
+#endif
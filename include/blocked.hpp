@@ -0,0 +1,206 @@
+#ifndef _MGARD_BLOCKED_HPP
+#define _MGARD_BLOCKED_HPP
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "utils.hpp"
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// one tile of a blocked decomposition
+struct Block{
+    vector<size_t> origin;  // position of the first value in the domain
+    vector<size_t> dims;    // dimensions of the tile
+    size_t offset;          // position of the coefficients in the blocked buffer
+    int levels;             // number of levels the tile was decomposed with
+};
+
+// tiling of a domain into independent blocks, stored block after block
+struct BlockIndex{
+    vector<size_t> dims;
+    vector<size_t> block_dims;
+    bool hierarchical = false;
+    vector<vector<size_t>> tile_starts;     // start of the tiles along each dimension
+    vector<Block> blocks;                   // row-major order of the tiles
+    // id of the block holding the value at position
+    size_t find(const vector<size_t>& position) const{
+        size_t id = 0;
+        for(int k=0; k<dims.size(); k++){
+            size_t t = upper_bound(tile_starts[k].begin(), tile_starts[k].end(), position[k]) - tile_starts[k].begin() - 1;
+            id = id * tile_starts[k].size() + t;
+        }
+        return id;
+    }
+};
+
+// split each dimension into tiles of block_dims; a remainder smaller than half
+// a block is merged into the last tile, so that no tile is too thin to coarsen
+inline BlockIndex init_block_index(const vector<size_t>& dims, const vector<size_t>& block_dims){
+    BlockIndex index;
+    index.dims = dims;
+    index.block_dims = block_dims;
+    index.tile_starts.resize(dims.size());
+    for(int k=0; k<dims.size(); k++){
+        size_t b = max(block_dims[k], (size_t) 1);
+        size_t num_tiles = max(dims[k] / b, (size_t) 1);
+        if((dims[k] > num_tiles * b) && (dims[k] - num_tiles * b >= (b + 1) / 2)) num_tiles ++;
+        for(size_t t=0; t<num_tiles; t++){
+            index.tile_starts[k].push_back(t * b);
+        }
+    }
+    size_t num_blocks = 1;
+    for(const auto& starts:index.tile_starts){
+        num_blocks *= starts.size();
+    }
+    size_t offset = 0;
+    for(size_t id=0; id<num_blocks; id++){
+        Block block;
+        block.origin.resize(dims.size());
+        block.dims.resize(dims.size());
+        size_t rest = id;
+        for(int k=dims.size()-1; k>=0; k--){
+            const auto& starts = index.tile_starts[k];
+            size_t t = rest % starts.size();
+            rest /= starts.size();
+            block.origin[k] = starts[t];
+            block.dims[k] = ((t + 1 < starts.size()) ? starts[t + 1] : dims[k]) - starts[t];
+        }
+        block.offset = offset;
+        block.levels = 0;
+        size_t size = 1;
+        for(const auto& d:block.dims){
+            size *= d;
+        }
+        offset += size;
+        index.blocks.push_back(block);
+    }
+    return index;
+}
+
+// decompose a domain as independent blocks (e.g. 64^3), so that any block can be
+// recomposed alone and blocks scale without communication
+// each block is decomposed by the Decomposer of the executing thread, which keeps
+// its workspace and Thomas factors for the next block of the same shape
+// every value belongs to exactly one block, so an error bound that holds for each
+// block holds for the whole domain, including block boundaries
+template <class T>
+class BlockedDecomposer{
+public:
+    BlockedDecomposer(const vector<size_t>& block_dims_=vector<size_t>(3, 64)) : block_dims(block_dims_){}
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+    }
+    // placement of the workspaces of the per-thread Decomposers, see MemoryPolicy;
+    // they run without a pool, so each workspace is touched by the thread that uses it
+    void set_memory_policy(const MemoryPolicy& policy){
+        memory_policy = policy;
+        for(auto& decomposer:decomposers){
+            decomposer->set_memory_policy(policy);
+        }
+    }
+    // decompose data (dense row-major) into coeff (same number of values, block after block)
+    // and return the block index
+    BlockIndex decompose(const T * data, const vector<size_t>& dims, size_t target_level, T * coeff, bool hierarchical=false){
+        // block_dims are aligned with the last dimensions, e.g. 64^3 gives 64^2 tiles in 2D
+        vector<size_t> bdims(dims.size());
+        for(int k=0; k<dims.size(); k++){
+            int j = k + (int) block_dims.size() - (int) dims.size();
+            bdims[k] = block_dims[max(j, 0)];
+        }
+        BlockIndex index = init_block_index(dims, bdims);
+        index.hierarchical = hierarchical;
+        int num_threads = pool ? pool->num_threads() + 1 : 1;
+        while(decomposers.size() < num_threads){
+            decomposers.push_back(unique_ptr<Decomposer<T>>(new Decomposer<T>()));
+            decomposers.back()->set_memory_policy(memory_policy);
+        }
+        auto strides = init_strides(dims);
+        auto run = [&](size_t id){
+            Block& block = index.blocks[id];
+            T * block_coeff = coeff + block.offset;
+            size_t offset = 0;
+            for(int k=0; k<dims.size(); k++){
+                offset += block.origin[k] * strides[k];
+            }
+            data_copy_strided(data + offset, strides, block.dims, block_coeff, init_strides(block.dims));
+            Decomposer<T>& decomposer = *decomposers[pool ? pool->thread_index() : 0];
+            block.levels = decomposer.decompose(block_coeff, block.dims, target_level, hierarchical);
+        };
+        if(pool) pool->parallel_for(0, index.blocks.size(), run);
+        else for(size_t id=0; id<index.blocks.size(); id++) run(id);
+        return index;
+    }
+
+private:
+    vector<size_t> block_dims;
+    ThreadPool * pool = NULL;
+    MemoryPolicy memory_policy;
+    vector<unique_ptr<Decomposer<T>>> decomposers;  // indexed by pool->thread_index()
+};
+
+template <class T>
+class BlockedRecomposer{
+public:
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+    }
+    // placement of the workspaces of the per-thread Recomposers, see BlockedDecomposer
+    void set_memory_policy(const MemoryPolicy& policy){
+        memory_policy = policy;
+        for(auto& recomposer:recomposers){
+            recomposer->set_memory_policy(policy);
+        }
+    }
+    // recompose one block from its coefficients into a dense array of block.dims
+    void recompose_block(const T * coeff, const BlockIndex& index, size_t id, T * block_data){
+        const Block& block = index.blocks[id];
+        size_t size = 1;
+        for(const auto& d:block.dims){
+            size *= d;
+        }
+        memcpy(block_data, coeff + block.offset, size * sizeof(T));
+        Recomposer<T>& recomposer = get_recomposer();
+        recomposer.recompose(block_data, block.dims, block.levels, index.hierarchical);
+    }
+    // recompose all blocks into data (dense row-major of index.dims)
+    void recompose(const T * coeff, const BlockIndex& index, T * data){
+        // create the recomposers of all threads before they run
+        get_recomposer();
+        auto strides = init_strides(index.dims);
+        auto run = [&](size_t id){
+            const Block& block = index.blocks[id];
+            size_t offset = 0;
+            for(int k=0; k<index.dims.size(); k++){
+                offset += block.origin[k] * strides[k];
+            }
+            // recompose in place inside the domain, with the strides of the domain
+            data_copy_strided(coeff + block.offset, init_strides(block.dims), block.dims, data + offset, strides);
+            get_recomposer().recompose(data + offset, block.dims, block.levels, index.hierarchical, strides);
+        };
+        if(pool) pool->parallel_for(0, index.blocks.size(), run);
+        else for(size_t id=0; id<index.blocks.size(); id++) run(id);
+    }
+
+private:
+    ThreadPool * pool = NULL;
+    MemoryPolicy memory_policy;
+    vector<unique_ptr<Recomposer<T>>> recomposers;  // indexed by pool->thread_index()
+
+    Recomposer<T>& get_recomposer(){
+        int num_threads = pool ? pool->num_threads() + 1 : 1;
+        while(recomposers.size() < num_threads){
+            recomposers.push_back(unique_ptr<Recomposer<T>>(new Recomposer<T>()));
+            recomposers.back()->set_memory_policy(memory_policy);
+        }
+        return *recomposers[pool ? pool->thread_index() : 0];
+    }
+};
+
+}
+#endif
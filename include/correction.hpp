@@ -2,6 +2,9 @@
 #define _MGARD_CORRECTION_HPP
 
 #include <vector>
+#include <cstring>
+#include <algorithm>
+#include "thread_pool.hpp"
 
 namespace MGARD{
 
@@ -58,6 +61,34 @@ void  compute_load_vector_nodal_row(T * load_v_buffer, size_t n_nodal, size_t n_
     // if next n is even, load_v_buffer[n_nodal - 1] = 0
     if(n_nodal == n_coeff + 2) load_v_buffer[n_coeff + 1] = 0;
 }
+// same as above for batchsize interleaved lines: entry i of line j is at i * batchsize + j
+// in both coeff_buffer and load_v_buffer, as in compute_correction_batched
+template <class T>
+void compute_load_vector_nodal_row_batched(T * load_v_buffer, size_t n_nodal, size_t n_coeff, T h, const T * coeff_buffer, int batchsize){
+    T ah = beta;
+    T const * coeff = coeff_buffer;
+    T * load_v = load_v_buffer;
+    for(int j=0; j<batchsize; j++){
+        load_v[j] = coeff[j] * ah;
+    }
+    load_v += batchsize;
+    for(int i=1; i<n_coeff; i++){
+        for(int j=0; j<batchsize; j++){
+            load_v[j] = (coeff[j] + coeff[batchsize + j]) * ah;
+        }
+        coeff += batchsize;
+        load_v += batchsize;
+    }
+    for(int j=0; j<batchsize; j++){
+        load_v[j] = coeff[j] * ah;
+    }
+    if(n_nodal == n_coeff + 2){
+        load_v += batchsize;
+        for(int j=0; j<batchsize; j++){
+            load_v[j] = 0;
+        }
+    }
+}
 
 // compute entries for load vector in coeff rows
 // for uniform decomposition only
@@ -109,18 +140,16 @@ void compute_correction(T * correction_buffer, size_t n_nodal, T h, T * load_v_b
     // forward pass
     // simplified algorithm
     T * d = load_v_buffer;
-    // vector<T> b(n, h*4/3);
-    // b[0] = h*2/3;
-    // b[n-1] = h*2/3;
     // T c = h/3;
     // eliminate h for efficiency
-    vector<T> b(n, 4.0/3);
-    b[0] = 2.0/3;
-    b[n-1] = 2.0/3;
+    // b is kept in correction_buffer, whose entry i is only written
+    // in the backward pass after b[i] is read
+    T * b = correction_buffer;
     T c = 1.0/3;
+    b[0] = 2.0/3;
     for(int i=1; i<n; i++){
         auto w = c / b[i-1];
-        b[i] = b[i] - w * c;
+        b[i] = (T) ((i == n - 1) ? 2.0/3 : 4.0/3) - w * c;
         d[i] = d[i] - w * d[i-1];
     }
     // backward pass
@@ -129,21 +158,184 @@ void compute_correction(T * correction_buffer, size_t n_nodal, T h, T * load_v_b
         correction_buffer[i] = (d[i] - c * correction_buffer[i+1]) / b[i];
     }
 }
-template <class T>
-void compute_correction_precomputed(T * correction_buffer, size_t n_nodal, const T * w, const T * b, T h, T * load_v_buffer){
+// the recursions carry their value in F, the type of the factors, so that factors
+// in double give float data a double accumulator (see Decomposer)
+template <class T, class F>
+void compute_correction_precomputed(T * correction_buffer, size_t n_nodal, const F * w, const F * b, T h, T * load_v_buffer){
     size_t n = n_nodal;
     // Thomas algorithm for solving M_l x = load_v
     // forward pass
     // simplified algorithm
     T * d = load_v_buffer;
-    T c = 1.0/3;
+    F c = 1.0/3;
+    F carry = d[0];
     for(int i=1; i<n; i++){
-        d[i] = d[i] - w[i] * d[i-1];
+        carry = d[i] - w[i] * carry;
+        d[i] = carry;
     }
     // backward pass
-    correction_buffer[n-1] = d[n-1] / b[n-1];
+    carry = carry / b[n-1];
+    correction_buffer[n-1] = carry;
     for(int i=n-2; i>=0; i--){
-        correction_buffer[i] = (d[i] - c * correction_buffer[i+1]) / b[i];
+        carry = (d[i] - c * carry) / b[i];
+        correction_buffer[i] = carry;
+    }
+}
+// the solution of M_l decays by a factor of 2 - sqrt(3) per entry away from a
+// nonzero right-hand side (the limit w of the Thomas factors, see DecayCoefficients),
+// so the spikes of the partitioned solver are truncated to this many entries
+// without loss of precision; IncrementalDecomposer and QueryEngine rely on the
+// same decay to solve lines on a window only
+const size_t partitioned_spike_length = 128;
+// lines shorter than this are always solved with the Thomas algorithm
+const size_t partitioned_min_length = 1 << 16;
+// compute the Thomas factors b of a line whose diagonal is first_diag, 4/3, 4/3, ...
+// the factors reach a fixed point after a few dozen entries, so only the head is kept
+/*
+@params b: buffer to store the factors, max_length entries
+@params max_length: maximal number of factors
+@params first_diag: first diagonal entry
+return number of stored factors; factors beyond are equal to the last one
+*/
+template <class T>
+size_t compute_thomas_head(T * b, size_t max_length, T first_diag){
+    T c = 1.0/3;
+    b[0] = first_diag;
+    for(int i=1; i<max_length; i++){
+        auto w = c / b[i-1];
+        b[i] = (T) (4.0/3) - w * c;
+        if(b[i] == b[i-1]) return i + 1;
+    }
+    return max_length;
+}
+// solve m rows of M_l in place with Thomas algorithm
+// the diagonal is described by the head factors and last_diag for the last row
+/*
+@params x: output solution, may alias d
+@params d: right-hand side, will be modified during computation
+@params m: number of rows (at least 2)
+@params b_head, head_length: factors computed by compute_thomas_head
+@params last_diag: last diagonal entry (2/3 at the end of the line, 4/3 otherwise)
+*/
+template <class T>
+void compute_correction_local(T * x, T * d, size_t m, const T * b_head, size_t head_length, T last_diag){
+    T c = 1.0/3;
+    T b_tail = b_head[head_length - 1];
+    for(int i=1; i<m; i++){
+        auto w = c / ((i - 1 < head_length) ? b_head[i-1] : b_tail);
+        d[i] = d[i] - w * d[i-1];
+    }
+    T b_last = last_diag - c / ((m - 2 < head_length) ? b_head[m-2] : b_tail) * c;
+    x[m-1] = d[m-1] / b_last;
+    for(int i=m-2; i>=0; i--){
+        x[i] = (d[i] - c * x[i+1]) / ((i < head_length) ? b_head[i] : b_tail);
+    }
+}
+// compute correction on nodal value for 1D case
+// using a partitioned (truncated SPIKE) solver that splits the line across the pool
+// each partition is solved independently together with its left and right spikes,
+// then a 2x2 system per partition boundary couples the partitions and
+// the spikes fix up the entries next to the boundaries
+/*
+@params correction_buffer: buffer to store the output correction
+@params n_nodal: number of nodal values
+@params h: interval length
+@params load_v_buffer: computed load vector in previous step, will be modified during computation
+@params pool: thread pool to run the partitions
+*/
+template <class T>
+void compute_correction_partitioned(T * correction_buffer, size_t n_nodal, T h, T * load_v_buffer, ThreadPool * pool){
+    const size_t K = partitioned_spike_length;
+    size_t num_partitions = min((size_t) pool->num_threads(), n_nodal / (2 * K));
+    if(num_partitions < 2){
+        compute_correction(correction_buffer, n_nodal, h, load_v_buffer);
+        return;
+    }
+    T c = 1.0/3;
+    T end_diag = 2.0/3;
+    T interior_diag = 4.0/3;
+    T end_head[K], interior_head[K];
+    size_t end_head_length = compute_thomas_head(end_head, K, end_diag);
+    size_t interior_head_length = compute_thomas_head(interior_head, K, interior_diag);
+    vector<size_t> offsets(num_partitions + 1);
+    for(int p=0; p<=num_partitions; p++){
+        offsets[p] = n_nodal * p / num_partitions;
+    }
+    // left spikes A_p^{-1} (c e_0) and right spikes A_p^{-1} (c e_{m-1}), first and last K entries
+    vector<T> left_spikes(num_partitions * K);
+    vector<T> right_spikes(num_partitions * K);
+    pool->parallel_for(0, num_partitions, [&](size_t p){
+        size_t m = offsets[p + 1] - offsets[p];
+        bool first = (p == 0);
+        bool last = (p == num_partitions - 1);
+        const T * head = first ? end_head : interior_head;
+        size_t head_length = first ? end_head_length : interior_head_length;
+        T last_diag = last ? end_diag : interior_diag;
+        compute_correction_local(correction_buffer + offsets[p], load_v_buffer + offsets[p], m, head, head_length, last_diag);
+        T * left = left_spikes.data() + p * K;
+        T * right = right_spikes.data() + p * K;
+        if(!first){
+            // leading K rows: same first row as the partition, interior last row
+            memset(left, 0, K * sizeof(T));
+            left[0] = c;
+            compute_correction_local(left, left, K, head, head_length, interior_diag);
+        }
+        if(!last){
+            // trailing K rows: interior first row, same last row as the partition
+            memset(right, 0, K * sizeof(T));
+            right[K - 1] = c;
+            compute_correction_local(right, right, K, interior_head, interior_head_length, last_diag);
+        }
+    });
+    // reduced system at each boundary, neglecting spike entries that are K entries
+    // away from their source:
+    //   x_bottom = y_bottom - right[K-1] * x_top
+    //   x_top = y_top - left[0] * x_bottom
+    vector<T> bottoms(num_partitions), tops(num_partitions);
+    for(int p=0; p+1<num_partitions; p++){
+        T y_bottom = correction_buffer[offsets[p + 1] - 1];
+        T y_top = correction_buffer[offsets[p + 1]];
+        T v = right_spikes[p * K + K - 1];
+        T w = left_spikes[(p + 1) * K];
+        bottoms[p] = (y_bottom - v * y_top) / (1 - v * w);
+        tops[p + 1] = y_top - w * bottoms[p];
+    }
+    for(int p=0; p<num_partitions; p++){
+        if(p + 1 < num_partitions){
+            T * x = correction_buffer + offsets[p + 1] - K;
+            const T * right = right_spikes.data() + p * K;
+            for(int i=0; i<K; i++){
+                x[i] -= right[i] * tops[p + 1];
+            }
+        }
+        if(p > 0){
+            T * x = correction_buffer + offsets[p];
+            const T * left = left_spikes.data() + p * K;
+            for(int i=0; i<K; i++){
+                x[i] -= left[i] * bottoms[p - 1];
+            }
+        }
+    }
+}
+// compute correction on nodal value for 1D case
+// choose between the Thomas algorithm and the partitioned solver:
+// the partitioned solver does about twice the work, so it only pays off
+// for long lines when there are fewer independent lines than threads
+/*
+@params correction_buffer: buffer to store the output correction
+@params n_nodal: number of nodal values
+@params h: interval length
+@params load_v_buffer: computed load vector in previous step, will be modified during computation
+@params num_lines: number of lines being solved concurrently
+@params pool: thread pool, NULL for serial execution
+*/
+template <class T>
+void compute_correction_dispatch(T * correction_buffer, size_t n_nodal, T h, T * load_v_buffer, size_t num_lines, ThreadPool * pool){
+    if(pool && (pool->num_threads() > 1) && (num_lines < pool->num_threads()) && (n_nodal >= partitioned_min_length)){
+        compute_correction_partitioned(correction_buffer, n_nodal, h, load_v_buffer, pool);
+    }
+    else{
+        compute_correction(correction_buffer, n_nodal, h, load_v_buffer);
     }
 }
 // compute entries for load vector in vertical (non-contiguous) direction
@@ -210,40 +402,182 @@ void compute_load_vector_vertical(T * load_v_buffer, const T * nodal_buffer, con
 @params batchsize: number of columns to be computed together
 @params correction_stride: stride for adjacent correction data in non-continguous dimension
 @params load_v_buffer: buffer to store load vector
+the recursions carry their values in F, as in compute_correction_precomputed,
+for up to solve_chunk_size columns at a time
 */
-template <class T>
-void compute_correction_batched(T * correction_buffer, T h, const T * w, const T * b, size_t n_nodal, int batchsize, size_t correction_stride, T * load_v_buffer){
+const int solve_chunk_size = 32;
+template <class T, class F>
+void compute_correction_batched(T * correction_buffer, T h, const F * w, const F * b, size_t n_nodal, int batchsize, size_t correction_stride, T * load_v_buffer){
     size_t n = n_nodal;
     // T c = h/3;
     // eliminate h for effificiency
-    T c = 1.0/3;
-    // Thomas algorithm for solving M_l x = load_v
-    // forward pass
-    // simplified algorithm
-    // b[:], w[:] are precomputed
-    T * load_v_pos = load_v_buffer + batchsize;
-    for(int i=1; i<n; i++){
-        for(int j=0; j<batchsize; j++){
-            load_v_pos[j] -= w[i] * load_v_pos[-batchsize + j];
+    F c = 1.0/3;
+    F carry[solve_chunk_size];
+    for(int j0=0; j0<batchsize; j0+=solve_chunk_size){
+        int m = min(batchsize - j0, solve_chunk_size);
+        // Thomas algorithm for solving M_l x = load_v
+        // forward pass
+        // simplified algorithm
+        // b[:], w[:] are precomputed
+        T * load_v_pos = load_v_buffer + j0;
+        for(int j=0; j<m; j++){
+            carry[j] = load_v_pos[j];
+        }
+        for(int i=1; i<n; i++){
+            load_v_pos += batchsize;
+            for(int j=0; j<m; j++){
+                carry[j] = load_v_pos[j] - w[i] * carry[j];
+                load_v_pos[j] = carry[j];
+            }
+        }
+        // backward pass
+        T * correction_pos = correction_buffer + (n - 1) * correction_stride + j0;
+        for(int j=0; j<m; j++){
+            carry[j] = carry[j] / b[n - 1];
+            correction_pos[j] = carry[j];
+        }
+        for(int i=n-2; i>=0; i--){
+            correction_pos -= correction_stride;
+            load_v_pos -= batchsize;
+            for(int j=0; j<m; j++){
+                carry[j] = (load_v_pos[j] - c * carry[j]) / b[i];
+                correction_pos[j] = carry[j];
+            }
         }
-        load_v_pos += batchsize;
     }
-    // backward pass
-    T * correction_pos = correction_buffer + (n - 1) * correction_stride;
-    load_v_pos -= batchsize;
-    for(int j=0; j<batchsize; j++){
-        correction_pos[j] = load_v_pos[j] / b[n - 1];
+}
+// solver used for the mass matrix M_l in the correction
+enum SolverMode{
+    SOLVER_THOMAS,  // Thomas algorithm with precomputed w and b for every entry
+    SOLVER_DECAY    // constant-coefficient recursive filters, see DecayCoefficients
+};
+// Thomas factors as full tables, see precompute_w_and_b
+template <class T>
+struct ThomasTables{
+    const T * w;
+    const T * b;
+};
+// the factors of the Thomas algorithm on M_l converge to w = 2 - sqrt(3) and
+// b = (2 + sqrt(3)) / 3 after a few dozen entries, so M_l^{-1} is applied as a forward
+// filter x[i] -= w x[i-1] and a backward filter x[i] = (x[i] - x[i+1] / 3) / b with
+// constant coefficients; only the head of the line and the last (boundary) row keep
+// their own factors, and divisions are replaced by multiplications with 1/b
+template <class T>
+struct DecayCoefficients{
+    size_t head = 0;        // number of leading entries with their own factors
+    vector<T> w;            // w[0, head)
+    vector<T> inv_b;        // 1/b[0, head)
+    T w_inf = 0;            // w in [head, n_nodal - 1)
+    T inv_b_inf = 0;        // 1/b in [head, n_nodal - 1)
+    T w_last = 0;           // w of the last row
+    T inv_b_last = 0;       // 1/b of the last row
+};
+// precompute decay coefficients for lines of n_nodal (>= 2) values
+// the recursion is the same as in precompute_w_and_b, stopped at its fixed point
+template <class T>
+void precompute_decay_coefficients(DecayCoefficients<T>& coeff, size_t n_nodal){
+    T c = 1.0/3;
+    coeff.w.assign(1, 0);
+    coeff.inv_b.assign(1, 1 / (T) (2.0/3));
+    T b_prev = 2.0/3;
+    for(int i=1; i<n_nodal - 1; i++){
+        T w = c / b_prev;
+        T b = (T) (4.0/3) - w * c;
+        coeff.w.push_back(w);
+        coeff.inv_b.push_back(1 / b);
+        if(b == b_prev) break;
+        b_prev = b;
     }
-    correction_pos -= correction_stride;
-    load_v_pos -= batchsize;
-    for(int i=n-2; i>=0; i--){
-        for(int j=0; j<batchsize; j++){
-            correction_pos[j] = (load_v_pos[j] - c * correction_pos[correction_stride + j]) / b[i];
+    coeff.head = coeff.w.size();
+    coeff.w_inf = coeff.w.back();
+    coeff.inv_b_inf = coeff.inv_b.back();
+    coeff.w_last = c / b_prev;
+    coeff.inv_b_last = 1 / ((T) (2.0/3) - coeff.w_last * c);
+}
+// compute correction on nodal value for batched lines using decay coefficients
+// same layout as compute_correction_batched with precomputed w and b
+template <class T, class F>
+void compute_correction_batched(T * correction_buffer, T h, const DecayCoefficients<F>& coeff, size_t n_nodal, int batchsize, size_t correction_stride, T * load_v_buffer){
+    size_t n = n_nodal;
+    size_t head = coeff.head;
+    F c = 1.0/3;
+    F carry[solve_chunk_size];
+    for(int j0=0; j0<batchsize; j0+=solve_chunk_size){
+        int m = min(batchsize - j0, solve_chunk_size);
+        // forward filter
+        T * load_v_pos = load_v_buffer + j0;
+        for(int j=0; j<m; j++){
+            carry[j] = load_v_pos[j];
+        }
+        for(int i=1; i<head; i++){
+            F w = coeff.w[i];
+            load_v_pos += batchsize;
+            for(int j=0; j<m; j++){
+                carry[j] = load_v_pos[j] - w * carry[j];
+                load_v_pos[j] = carry[j];
+            }
+        }
+        F w_inf = coeff.w_inf;
+        for(int i=head; i<n-1; i++){
+            load_v_pos += batchsize;
+            for(int j=0; j<m; j++){
+                carry[j] = load_v_pos[j] - w_inf * carry[j];
+                load_v_pos[j] = carry[j];
+            }
+        }
+        // boundary fix-up of the last row
+        F w_last = coeff.w_last;
+        load_v_pos += batchsize;
+        for(int j=0; j<m; j++){
+            carry[j] = load_v_pos[j] - w_last * carry[j];
+        }
+        // backward filter
+        T * correction_pos = correction_buffer + (n - 1) * correction_stride + j0;
+        F inv_b_last = coeff.inv_b_last;
+        for(int j=0; j<m; j++){
+            carry[j] = carry[j] * inv_b_last;
+            correction_pos[j] = carry[j];
+        }
+        F inv_b_inf = coeff.inv_b_inf;
+        for(int i=n-2; i>=(int)head; i--){
+            correction_pos -= correction_stride;
+            load_v_pos -= batchsize;
+            for(int j=0; j<m; j++){
+                carry[j] = (load_v_pos[j] - c * carry[j]) * inv_b_inf;
+                correction_pos[j] = carry[j];
+            }
+        }
+        for(int i=min(head, n - 1)-1; i>=0; i--){
+            F inv_b = coeff.inv_b[i];
+            correction_pos -= correction_stride;
+            load_v_pos -= batchsize;
+            for(int j=0; j<m; j++){
+                carry[j] = (load_v_pos[j] - c * carry[j]) * inv_b;
+                correction_pos[j] = carry[j];
+            }
         }
-        correction_pos -= correction_stride;
-        load_v_pos -= batchsize;
     }
 }
+template <class T, class F>
+void compute_correction_batched(T * correction_buffer, T h, const ThomasTables<F>& tables, size_t n_nodal, int batchsize, size_t correction_stride, T * load_v_buffer){
+    compute_correction_batched(correction_buffer, h, tables.w, tables.b, n_nodal, batchsize, correction_stride, load_v_buffer);
+}
+// compute correction on nodal value for 1D case using decay coefficients
+/*
+@params correction_buffer: buffer to store the output correction
+@params n_nodal: number of nodal values
+@params coeff: precomputed decay coefficients for n_nodal
+@params h: interval length
+@params load_v_buffer: computed load vector in previous step, will be modified during computation
+*/
+template <class T, class F>
+void compute_correction_precomputed(T * correction_buffer, size_t n_nodal, const DecayCoefficients<F>& coeff, T h, T * load_v_buffer){
+    compute_correction_batched(correction_buffer, h, coeff, n_nodal, 1, 1, load_v_buffer);
+}
+template <class T, class F>
+void compute_correction_precomputed(T * correction_buffer, size_t n_nodal, const ThomasTables<F>& tables, T h, T * load_v_buffer){
+    compute_correction_precomputed(correction_buffer, n_nodal, tables.w, tables.b, h, load_v_buffer);
+}
 // apply correction back to the nodal values
 /*
 @params nodal_pos: starting position of nodal values
@@ -252,17 +586,19 @@ void compute_correction_batched(T * correction_buffer, T h, const T * w, const T
 @params stride: stride across adjacent nodal values
 @params batchsize: number of points to be computed in a batch
 @params decompose: whether this function is called during decompose or not
+@params correction_stride: stride across adjacent corrections, 0 for batchsize
 */
 template <class T>
-void apply_correction_batched(T * nodal_pos, const T * correction_buffer, int n_nodal, int stride, int batchsize, bool decompose){
+void apply_correction_batched(T * nodal_pos, const T * correction_buffer, int n_nodal, int stride, int batchsize, bool decompose, size_t correction_stride=0){
     const T * correction_pos = correction_buffer;
+    if(correction_stride == 0) correction_stride = batchsize;
     if(decompose){
         for(int i=0; i<n_nodal; i++){
             for(int j=0; j<batchsize; j++){
                 nodal_pos[j] += correction_pos[j];
             }
             nodal_pos += stride;
-            correction_pos += batchsize;
+            correction_pos += correction_stride;
         }
     }
     else{
@@ -271,7 +607,7 @@ void apply_correction_batched(T * nodal_pos, const T * correction_buffer, int n_
                 nodal_pos[j] -= correction_pos[j];
             }
             nodal_pos += stride;
-            correction_pos += batchsize;
+            correction_pos += correction_stride;
         }
     }
 }
@@ -286,8 +622,14 @@ void apply_correction_batched(T * nodal_pos, const T * correction_buffer, int n_
 @params load_v_buffer: buffer to store load vectors. Contents of buffer will be modified
 @params default_batch_size: batchsize of vertical correction computation
 */
-template <class T>
-void compute_correction_vertical(T * data_pos, size_t n1, size_t n2, T h, T * horizontal_correction, size_t stride, T * load_v_buffer, const T * w, const T * b, int default_batch_size=1){
+template <class T, class F>
+void compute_correction_vertical(T * data_pos, size_t n1, size_t n2, T h, T * horizontal_correction, size_t stride, T * load_v_buffer, const F * w, const F * b, int default_batch_size=1){
+    ThomasTables<F> tables = {w, b};
+    compute_correction_vertical(data_pos, n1, n2, h, horizontal_correction, stride, load_v_buffer, tables, default_batch_size);
+}
+// same as above, factors is either ThomasTables or DecayCoefficients
+template <class T, class Factors>
+void compute_correction_vertical(T * data_pos, size_t n1, size_t n2, T h, T * horizontal_correction, size_t stride, T * load_v_buffer, const Factors& factors, int default_batch_size=1){
     size_t n1_nodal = (n1 >> 1) + 1;
     size_t n1_coeff = n1 - n1_nodal;
     size_t n2_nodal = (n2 >> 1) + 1;
@@ -300,13 +642,13 @@ void compute_correction_vertical(T * data_pos, size_t n1, size_t n2, T h, T * ho
     T * data_nodal_pos = data_pos;
     for(int i=0; i<num_batches; i++){
         compute_load_vector_vertical(load_v_buffer, nodal_pos, coeff_pos, n1_nodal, n1_coeff, stride, h, batchsize);
-        compute_correction_batched(nodal_pos, h, w, b, n1_nodal, batchsize, stride, load_v_buffer);
+        compute_correction_batched(nodal_pos, h, factors, n1_nodal, batchsize, stride, load_v_buffer);
         nodal_pos += batchsize, coeff_pos += batchsize, data_nodal_pos += batchsize;
     }
     if(n2_nodal - batchsize * num_batches > 0){
         batchsize = n2_nodal - batchsize * num_batches;
         compute_load_vector_vertical(load_v_buffer, nodal_pos, coeff_pos, n1_nodal, n1_coeff, stride, h, batchsize);
-        compute_correction_batched(nodal_pos, h, w, b, n1_nodal, batchsize, stride, load_v_buffer);
+        compute_correction_batched(nodal_pos, h, factors, n1_nodal, batchsize, stride, load_v_buffer);
     }
 }
 // compute the corrections for 2D cases
@@ -320,8 +662,15 @@ void compute_correction_vertical(T * data_pos, size_t n1, size_t n2, T h, T * ho
 @params stride: stride for adjacent data in non-continguous dimension
 @params default_batch_size: batchsize of vertical correction computation
 */
-template <class T>
-void compute_correction_2D(T * data_pos, T * correction_buffer, T * load_v_buffer, size_t n1, size_t n2, size_t nodal_rows, T h, size_t stride, const T * w1, const T * b1, const T * w2, const T * b2, int default_batch_size=1){
+template <class T, class F>
+void compute_correction_2D(T * data_pos, T * correction_buffer, T * load_v_buffer, size_t n1, size_t n2, size_t nodal_rows, T h, size_t stride, const F * w1, const F * b1, const F * w2, const F * b2, int default_batch_size=1){
+    ThomasTables<F> tables1 = {w1, b1};
+    ThomasTables<F> tables2 = {w2, b2};
+    compute_correction_2D(data_pos, correction_buffer, load_v_buffer, n1, n2, nodal_rows, h, stride, tables1, tables2, default_batch_size);
+}
+// same as above, factors1 and factors2 are either ThomasTables or DecayCoefficients
+template <class T, class Factors>
+void compute_correction_2D(T * data_pos, T * correction_buffer, T * load_v_buffer, size_t n1, size_t n2, size_t nodal_rows, T h, size_t stride, const Factors& factors1, const Factors& factors2, int default_batch_size=1){
     size_t n1_nodal = (n1 >> 1) + 1;
     size_t n1_coeff = n1 - n1_nodal;
     size_t n2_nodal = (n2 >> 1) + 1;
@@ -334,13 +683,13 @@ void compute_correction_2D(T * data_pos, T * correction_buffer, T * load_v_buffe
     for(int i=0; i<n1; i++){
         if(i < nodal_rows) compute_load_vector_nodal_row(load_v_buffer, n2_nodal, n2_coeff, h, coeff_pos);
         else  compute_load_vector_coeff_row(load_v_buffer, n2_nodal, n2_coeff, h, nodal_pos, coeff_pos);
-        compute_correction_precomputed(correction_pos, n2_nodal, w2, b2, h, load_v_buffer);
+        compute_correction_precomputed(correction_pos, n2_nodal, factors2, h, load_v_buffer);
         // subtract_correction(n2_nodal, nodal_pos);
         nodal_pos += stride, coeff_pos += stride;
         correction_pos += n2_nodal;
     }
     // compute vertical correction
-    compute_correction_vertical(data_pos, n1, n2, h, correction_buffer, n2_nodal, load_v_buffer, w1, b1, default_batch_size);
+    compute_correction_vertical(data_pos, n1, n2, h, correction_buffer, n2_nodal, load_v_buffer, factors1, default_batch_size);
 }
 // compute the corrections for 3D cases
 /*
@@ -5,15 +5,24 @@
 #include <cstdlib>
 #include <algorithm>
 #include <cstring>
+#include <map>
+#include <type_traits>
+#include <functional>
 #include "reorder.hpp"
 #include "utils.hpp"
 #include "correction.hpp"
+#include "lorenzo.hpp"
+#include "memory.hpp"
+#include "thread_pool.hpp"
+#include "task_graph.hpp"
 
 namespace MGARD{
 
 using namespace std;
 
-template <class T>
+// Acc is the type of the mass-matrix factors and of the values carried by the
+// solves, e.g. double for float data in MixedDecomposer
+template <class T, class Acc = T>
 class Decomposer{
 public:
 	Decomposer(bool use_sz_=true){
@@ -23,89 +32,348 @@ public:
 		if(data_buffer) free(data_buffer);
 		if(correction_buffer) free(correction_buffer);	
 		if(load_v_buffer) free(load_v_buffer);
+		if(thread_data_buffer) free(thread_data_buffer);
+		if(thread_load_v_buffer) free(thread_load_v_buffer);
+		if(pack_buffer) free(pack_buffer);
+		if(series_buffer) free(series_buffer);
 	};
-    // return levels
+    // run the task graph of 3D decompositions on the given pool
+    // (NULL for serial execution); may be called from a task of the same pool
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+    }
+    // solver for the mass matrix in the correction of every dimension count and
+    // of decompose_series, SOLVER_THOMAS by default
+    void set_solver_mode(SolverMode mode){
+        solver_mode = mode;
+    }
+    // placement of the workspaces allocated from now on, see MemoryPolicy
+    void set_memory_policy(const MemoryPolicy& policy){
+        memory_policy = policy;
+    }
+    // with use_sz and eb > 0, decompose ends with a Lorenzo prediction stage on the
+    // coarsest nodal grid: its values are replaced by their reconstruction (error <= eb)
+    // and the prediction codes are available from get_nodal_codes
+    void set_nodal_error_bound(T eb){
+        nodal_codes.eb = eb;
+    }
+    const LorenzoCodes<T>& get_nodal_codes() const{
+        return nodal_codes;
+    }
+    // decompose data in place and return the number of levels
+    // strides: distance between adjacent values of each dimension, dense row-major by default;
+    // data may point into a larger array (e.g. the interior of a ghost-cell padded buffer),
+    // which is decomposed without copies as long as one dimension is contiguous;
+    // any dimension order is accepted (e.g. init_column_major_strides for Fortran arrays)
+    // and gives the same coefficients, up to rounding, as a transposed row-major copy
 	int decompose(T * data_, const vector<size_t>& dims, size_t target_level, bool hierarchical=false, vector<size_t> strides=vector<size_t>()){
 		data = data_;
 		size_t num_elements = 1;
 		for(const auto& d:dims){
 			num_elements *= d;
 		}
-		if(strides.size() == 0){
-			strides = vector<size_t>(dims.size());
-			size_t stride = 1;
-			for(int i=dims.size()-1; i>=0; i--){
-				strides[i] = stride;
-				stride *= dims[i];
-			}
-			for(int i=0; i<dims.size(); i++){
-				cout << strides[i] << " ";
-			}
-			cout << endl;
+		if(strides.size() == 0) strides = init_strides(dims);
+		if(!is_sorted(strides.rbegin(), strides.rend())){
+			// layout-aware execution: process the dimensions by decreasing stride, so that
+			// the dimension with the smallest stride gets the contiguous row kernels
+			// (e.g. column-major data is decomposed as its row-major transpose, without copies)
+			vector<size_t> order = get_stride_order(strides);
+			return decompose(data_, permute(dims, order), target_level, hierarchical, permute(strides, order));
+		}
+		if((dims.size() > 1) && (strides.back() != 1)){
+			// the kernels need contiguous rows: decompose a dense copy
+			vector<T> dense(num_elements);
+			auto dense_strides = init_strides(dims);
+			data_copy_strided(data_, strides, dims, dense.data(), dense_strides);
+			int levels = decompose(dense.data(), dims, target_level, hierarchical, dense_strides);
+			data_copy_strided(dense.data(), dense_strides, dims, data_, strides);
+			return levels;
 		}
 		data_buffer_size = num_elements * sizeof(T);
-        int max_level = log2(*min_element(dims.begin(), dims.end()));
-        if(target_level > max_level) target_level = max_level;
+        // dimensions are coarsened independently, see init_levels
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        auto level_dims = init_levels(dims, target_level);
 		init(dims);
-        current_dims.resize(dims.size());
 		if(dims.size() == 1){
 			size_t h = 1;
 			size_t n = dims[0];
 			for(int i=0; i<target_level; i++){
-				hierarchical ? decompose_level_1D_with_hierarchical_basis(data, n, h) : decompose_level_1D(data, n, h);
+				hierarchical ? decompose_level_1D_with_hierarchical_basis(data, n, h, strides[0], data_buffer) : decompose_level_1D(data, n, h, strides[0], data_buffer, correction_buffer, load_v_buffer, 1);
 				n = (n >> 1) + 1;
 				h <<= 1;
 			}
 		}
 		else if(dims.size() == 2){
 			size_t h = 1;
-			size_t n1 = dims[0];
-			size_t n2 = dims[1];
 			for(int i=0; i<target_level; i++){
-				hierarchical ? decompose_level_2D_with_hierarchical_basis(data, n1, n2, (T)h, strides[0]) : decompose_level_2D(data, n1, n2, (T)h, strides[0]);
-				n1 = (n1 >> 1) + 1;
-				n2 = (n2 >> 1) + 1;
+				size_t n1 = level_dims[target_level - i][0];
+				size_t n2 = level_dims[target_level - i][1];
+				const vector<size_t>& next_dims = level_dims[target_level - i - 1];
+				if((next_dims[0] != n1) && (next_dims[1] != n2)){
+					hierarchical ? decompose_level_2D_with_hierarchical_basis(data, n1, n2, (T)h, strides[0]) : decompose_level_2D(data, n1, n2, (T)h, strides[0]);
+				}
+				else{
+					TaskGraph graph;
+					add_decompose_level_mixed_tasks(graph, -1, data, {1, n1, n2}, {0, strides[0], 1}, {false, next_dims[0] != n1, next_dims[1] != n2}, (T)h, hierarchical);
+					graph.run(pool);
+				}
 				h <<= 1;
 			}
 		}
 		else if(dims.size() == 3){
 			size_t h = 1;
-			size_t n1 = dims[0];
-			size_t n2 = dims[1];
-			size_t n3 = dims[2];
+			// all levels go into one task graph, tasks of a level start
+			// as soon as the part of the previous level they read is done
+			TaskGraph graph;
+			LevelTasks level;
 			for(int i=0; i<target_level; i++){
-                current_dims[0] = (n1 >> 1) + 1;
-                current_dims[1] = (n2 >> 1) + 1;
-                current_dims[2] = (n3 >> 1) + 1;
-				hierarchical ? decompose_level_3D_with_hierarchical_basis(data, n1, n2, n3, (T)h, strides[0], strides[1]) : decompose_level_3D(data, n1, n2, n3, (T)h, strides[0], strides[1]);
-				n1 = (n1 >> 1) + 1;
-				n2 = (n2 >> 1) + 1;
-				n3 = (n3 >> 1) + 1;
+				size_t n1 = level_dims[target_level - i][0];
+				size_t n2 = level_dims[target_level - i][1];
+				size_t n3 = level_dims[target_level - i][2];
+				const vector<size_t>& next_dims = level_dims[target_level - i - 1];
+				if((next_dims[0] != n1) && (next_dims[1] != n2) && (next_dims[2] != n3)){
+					level = add_decompose_level_3D_tasks(graph, level, data, n1, n2, n3, (T)h, strides[0], strides[1], hierarchical);
+				}
+				else{
+					level = LevelTasks(add_decompose_level_mixed_tasks(graph, join_level(graph, level), data, {n1, n2, n3}, {strides[0], strides[1], 1}, {next_dims[0] != n1, next_dims[1] != n2, next_dims[2] != n3}, (T)h, hierarchical));
+				}
 				h <<= 1;
 			}
+			graph.run(pool);
 		}
+        nodal_codes.clear();
+        if(use_sz && nodal_codes.enabled()) lorenzo_quantize(data, level_dims[0], strides, nodal_codes);
         return target_level;
 	}
+    // decompose num_series independent series of n values each (dense, one series
+    // after the other) in place and return the number of levels; every series gets
+    // the coefficients of decompose(series, {n}, target_level, hierarchical)
+    // series are interleaved series_batch_size at a time, so that all kernels of a
+    // level, including the correction, run across series as the columns in
+    // compute_correction_batched; batches are distributed over the thread pool and
+    // only use workspaces kept across calls
+    // the Lorenzo stage of set_nodal_error_bound is not applied to series
+    int decompose_series(T * data_, size_t num_series, size_t n, size_t target_level, bool hierarchical=false){
+        if(target_level > get_max_level(n)) target_level = get_max_level(n);
+        if((num_series == 0) || (target_level == 0)) return target_level;
+        auto level_dims = init_levels(vector<size_t>(1, n), target_level);
+        size_t batchsize = series_batch_size;
+        init_series(n, batchsize);
+        // factors of every level, looked up before the batches run concurrently
+        vector<ThomasTables<Acc>> tables(target_level + 1);
+        vector<const DecayCoefficients<Acc> *> decay(target_level + 1, NULL);
+        if(!hierarchical){
+            for(size_t l=1; l<=target_level; l++){
+                size_t n_nodal = (level_dims[l][0] >> 1) + 1;
+                get_thomas_tables(n_nodal, tables[l].w, tables[l].b);
+                if(solver_mode == SOLVER_DECAY) decay[l] = get_decay_coefficients(n_nodal);
+            }
+        }
+        size_t num_batches = (num_series - 1) / batchsize + 1;
+        auto batch = [&](size_t i){
+            size_t num_lines = min(batchsize, num_series - i * batchsize);
+            T * series = data_ + i * batchsize * n;
+            T * block = get_thread_series_buffer();
+            T * buffer = block + n * batchsize;
+            T * correction = buffer + n * batchsize;
+            T * load_v = correction + ((n >> 1) + 1) * batchsize;
+            interleave_lines(series, n, num_lines, n, block);
+            size_t h = 1;
+            for(size_t l=target_level; l>0; l--){
+                decompose_level_1D_batched(block, level_dims[l][0], num_lines, (T)h, buffer, correction, load_v, hierarchical, tables[l], decay[l]);
+                h <<= 1;
+            }
+            deinterleave_lines(block, n, num_lines, n, series);
+        };
+        if(pool) pool->parallel_for(0, num_batches, batch);
+        else for(size_t i=0; i<num_batches; i++) batch(i);
+        return target_level;
+    }
+    // number of series interleaved by decompose_series
+    size_t series_batch_size = 16;
 
 private:
 	unsigned int default_batch_size = 32;
 	size_t data_buffer_size = 0;
     bool use_sz = true;
+    LorenzoCodes<T> nodal_codes;    // codes of the coarsest nodal grid, see set_nodal_error_bound
 	T * data = NULL;			// pointer to the original data
 	T * data_buffer = NULL;		// buffer for reordered data
 	T * load_v_buffer = NULL;
 	T * correction_buffer = NULL;
-    vector<size_t> current_dims;
+    // workspaces are kept across calls and only grow, so repeated
+    // shapes reuse them without new allocations
+    size_t data_buffer_capacity = 0;
+    size_t buffer_capacity = 0;
+    ThreadPool * pool = NULL;
+    int slabs_per_thread = 4;
+    // per-thread scratch for parallel 3D levels, indexed by pool->thread_index()
+    T * thread_data_buffer = NULL;
+    T * thread_load_v_buffer = NULL;
+    size_t thread_data_buffer_size = 0;     // number of elements per thread
+    size_t thread_load_v_buffer_size = 0;   // number of elements per thread
+    size_t thread_data_buffer_capacity = 0;
+    size_t thread_load_v_buffer_capacity = 0;
+    // copy of a region with its active dimensions innermost, for anisotropic levels
+    T * pack_buffer = NULL;
+    size_t pack_buffer_capacity = 0;
+    // Thomas factors w and b keyed by n_nodal
+    map<size_t, pair<vector<Acc>, vector<Acc>>> thomas_tables;
+    SolverMode solver_mode = SOLVER_THOMAS;
+    MemoryPolicy memory_policy;
+    // decay coefficients keyed by n_nodal, used with SOLVER_DECAY
+    map<size_t, DecayCoefficients<Acc>> decay_tables;
+    // per-thread scratch of decompose_series, indexed by pool->thread_index()
+    T * series_buffer = NULL;
+    size_t series_buffer_size = 0;          // number of elements per thread
+    size_t series_buffer_capacity = 0;
 
 	void init(const vector<size_t>& dims){
 		size_t buffer_size = default_batch_size * (*max_element(dims.begin(), dims.end())) * sizeof(T);
 		// cerr << "buffer_size = " << buffer_size << endl;
-		if(data_buffer) free(data_buffer);
-		if(correction_buffer) free(correction_buffer);
-		if(load_v_buffer) free(load_v_buffer);
-		data_buffer = (T *) malloc(data_buffer_size);
-		correction_buffer = (T *) malloc(buffer_size);
-		load_v_buffer = (T *)malloc(buffer_size);
+		if(data_buffer_size > data_buffer_capacity){
+			if(data_buffer) free(data_buffer);
+			data_buffer = (T *) workspace_malloc(data_buffer_size, memory_policy, pool);
+			data_buffer_capacity = data_buffer_size;
+		}
+		if(buffer_size > buffer_capacity){
+			if(correction_buffer) free(correction_buffer);
+			if(load_v_buffer) free(load_v_buffer);
+			correction_buffer = (T *) workspace_malloc(buffer_size, memory_policy, pool);
+			load_v_buffer = (T *) workspace_malloc(buffer_size, memory_policy, pool);
+			buffer_capacity = buffer_size;
+		}
+		if(pool && (dims.size() >= 2)){
+			// a 3D level reorders planes of n2 x n3 and n1 x n3 elements, an anisotropic
+			// level decomposes planes of any two dimensions or lines of any dimension
+			vector<size_t> sorted_dims(dims);
+			sort(sorted_dims.begin(), sorted_dims.end());
+			thread_data_buffer_size = (dims.size() == 3) ? sorted_dims[1] * sorted_dims[2] : sorted_dims[1];
+			thread_load_v_buffer_size = buffer_size / sizeof(T);
+			size_t num_slots = pool->num_threads() + 1;
+			if(num_slots * thread_data_buffer_size > thread_data_buffer_capacity){
+				if(thread_data_buffer) free(thread_data_buffer);
+				thread_data_buffer_capacity = num_slots * thread_data_buffer_size;
+				thread_data_buffer = (T *) workspace_malloc(thread_data_buffer_capacity * sizeof(T), memory_policy, pool, thread_data_buffer_size * sizeof(T));
+			}
+			if(num_slots * thread_load_v_buffer_size > thread_load_v_buffer_capacity){
+				if(thread_load_v_buffer) free(thread_load_v_buffer);
+				thread_load_v_buffer_capacity = num_slots * thread_load_v_buffer_size;
+				thread_load_v_buffer = (T *) workspace_malloc(thread_load_v_buffer_capacity * sizeof(T), memory_policy, pool, thread_load_v_buffer_size * sizeof(T));
+			}
+		}
+	}
+	void get_thomas_tables(size_t n_nodal, const Acc *& w, const Acc *& b){
+		auto it = thomas_tables.find(n_nodal);
+		if(it == thomas_tables.end()){
+			auto& tables = thomas_tables[n_nodal];
+			tables.first.resize(n_nodal);
+			tables.second.resize(n_nodal);
+			precompute_w_and_b(tables.first.data(), tables.second.data(), n_nodal);
+			it = thomas_tables.find(n_nodal);
+		}
+		w = it->second.first.data();
+		b = it->second.second.data();
+	}
+	const DecayCoefficients<Acc> * get_decay_coefficients(size_t n_nodal){
+		auto it = decay_tables.find(n_nodal);
+		if(it == decay_tables.end()){
+			precompute_decay_coefficients(decay_tables[n_nodal], n_nodal);
+			it = decay_tables.find(n_nodal);
+		}
+		return &it->second;
+	}
+	// split [0, n) into slabs and add one task per slab
+	// each slab task depends on dependency (if >= 0)
+	vector<int> add_slab_tasks(TaskGraph& graph, size_t n, int dependency, const function<void(size_t)>& func){
+		return add_slab_tasks(graph, n, vector<int>(num_slabs(n), dependency), func);
+	}
+	// slab s depends on dependencies[s] (if >= 0), for chaining phases over the same index range
+	vector<int> add_slab_tasks(TaskGraph& graph, size_t n, const vector<int>& dependencies, const function<void(size_t)>& func){
+		size_t slabs = num_slabs(n);
+		vector<int> tasks;
+		for(size_t s=0; s<slabs; s++){
+			size_t begin = n * s / slabs;
+			size_t end = n * (s + 1) / slabs;
+			int task = graph.add_task([=]{
+				for(size_t i=begin; i<end; i++) func(i);
+			});
+			if(dependencies[s] >= 0) graph.add_dependency(dependencies[s], task);
+			tasks.push_back(task);
+		}
+		return tasks;
+	}
+	// dependencies of the slabs of [0, n) on the previous level: slab s waits for the
+	// slabs of level that overlap it, see LevelTasks
+	vector<int> get_slab_dependencies(TaskGraph& graph, size_t n, const LevelTasks& level){
+		size_t slabs = num_slabs(n);
+		if(level.slabs.size() <= 1) return vector<int>(slabs, level.slabs.empty() ? -1 : level.slabs[0]);
+		size_t prev_slabs = level.slabs.size();
+		int shared = level.shared;
+		vector<int> dependencies(slabs);
+		for(size_t s=0; s<slabs; s++){
+			size_t begin = n * s / slabs;
+			size_t end = n * (s + 1) / slabs;
+			vector<int> overlap;
+			for(size_t t=0; t<prev_slabs; t++){
+				size_t prev_begin = level.n * t / prev_slabs;
+				size_t prev_end = level.n * (t + 1) / prev_slabs;
+				if((prev_begin < end) && (begin < prev_end)) overlap.push_back(level.slabs[t]);
+			}
+			if(overlap.empty()){
+				if(shared < 0) shared = graph.add_join(level.slabs);
+				dependencies[s] = shared;
+			}
+			else dependencies[s] = (overlap.size() == 1) ? overlap[0] : graph.add_join(overlap);
+		}
+		return dependencies;
+	}
+	// a single task that finishes level (-1 for none)
+	int join_level(TaskGraph& graph, const LevelTasks& level){
+		if(level.slabs.empty()) return -1;
+		return (level.slabs.size() == 1) ? level.slabs[0] : graph.add_join(level.slabs);
+	}
+	size_t num_slabs(size_t n){
+		return pool ? min(n, (size_t) slabs_per_thread * pool->num_threads()) : 1;
+	}
+	T * get_pack_buffer(){
+		if(data_buffer_size > pack_buffer_capacity){
+			if(pack_buffer) free(pack_buffer);
+			pack_buffer = (T *) workspace_malloc(data_buffer_size, memory_policy, pool);
+			pack_buffer_capacity = data_buffer_size;
+		}
+		return pack_buffer;
+	}
+	// insert the factors for lines of n_nodal values, so that tasks only look them up
+	void prepare_factors(size_t n_nodal){
+		if(solver_mode == SOLVER_DECAY){
+			get_decay_coefficients(n_nodal);
+		}
+		else{
+			const Acc * w = NULL, * b = NULL;
+			get_thomas_tables(n_nodal, w, b);
+		}
+	}
+	// a batch of decompose_series keeps its interleaved series and the reorder buffer
+	// (n x batchsize each), and the correction and load vector of its first level
+	void init_series(size_t n, size_t batchsize){
+		series_buffer_size = 2 * (n + (n >> 1) + 1) * batchsize;
+		size_t num_slots = pool ? pool->num_threads() + 1 : 1;
+		if(num_slots * series_buffer_size > series_buffer_capacity){
+			if(series_buffer) free(series_buffer);
+			series_buffer_capacity = num_slots * series_buffer_size;
+			series_buffer = (T *) workspace_malloc(series_buffer_capacity * sizeof(T), memory_policy, pool, series_buffer_size * sizeof(T));
+		}
+	}
+	T * get_thread_series_buffer(){
+		return pool ? series_buffer + pool->thread_index() * series_buffer_size : series_buffer;
+	}
+	// scratch buffers of the calling thread
+	T * get_thread_data_buffer(){
+		return pool ? thread_data_buffer + pool->thread_index() * thread_data_buffer_size : data_buffer;
+	}
+	T * get_thread_load_v_buffer(){
+		return pool ? thread_load_v_buffer + pool->thread_index() * thread_load_v_buffer_size : load_v_buffer;
 	}
 	// compute the difference between original value 
 	// and interpolant (I - PI_l)Q_l
@@ -115,34 +383,78 @@ private:
 			coeff_buffer[i] -= (nodal_buffer[i] + nodal_buffer[i+1]) / 2; 
 		}
 	}
-	void add_correction(size_t n_nodal, T * nodal_buffer){
-		for(int i=0; i<n_nodal; i++){
-			nodal_buffer[i] += correction_buffer[i];
-		}
-	}
 	// decompose a level with n element and the given stride
 	// to a level with n/2 element
 	void decompose_level_1D(T * data_pos, size_t n, T h, bool nodal_row=true){
+		decompose_level_1D(data_pos, n, h, 1, data_buffer, correction_buffer, load_v_buffer, 1, nodal_row);
+	}
+	// same as above for data with the given stride and explicit workspaces:
+	// n elements in buffer, n/2 + 1 in correction and load_v
+	// num_lines: number of lines decomposed concurrently, used to choose the Thomas solver;
+	// with SOLVER_DECAY, prepare_factors(n/2 + 1) must run before concurrent calls
+	void decompose_level_1D(T * data_pos, size_t n, T h, size_t stride, T * buffer, T * correction, T * load_v, size_t num_lines, bool nodal_row=true){
 		size_t n_nodal = (n >> 1) + 1;
 		size_t n_coeff = n - n_nodal;
-		T * nodal_buffer = data_buffer;
-		T * coeff_buffer = data_buffer + n_nodal;
-		data_reorder_1D(data_pos, n_nodal, n_coeff, nodal_buffer, coeff_buffer);
+		T * nodal_buffer = buffer;
+		T * coeff_buffer = buffer + n_nodal;
+		data_reorder_1D(data_pos, n_nodal, n_coeff, nodal_buffer, coeff_buffer, stride);
 		compute_interpolant_difference_1D(n_coeff, nodal_buffer, coeff_buffer);
-		if(nodal_row) compute_load_vector_nodal_row(load_v_buffer, n_nodal, n_coeff, h, coeff_buffer);
-        else compute_load_vector_coeff_row(load_v_buffer, n_nodal, n_coeff, h, nodal_buffer, coeff_buffer);
-		compute_correction(correction_buffer, n_nodal, h, load_v_buffer);
-		add_correction(n_nodal, nodal_buffer);
-		memcpy(data_pos, data_buffer, n*sizeof(T));
+		if(nodal_row) compute_load_vector_nodal_row(load_v, n_nodal, n_coeff, h, coeff_buffer);
+        else compute_load_vector_coeff_row(load_v, n_nodal, n_coeff, h, nodal_buffer, coeff_buffer);
+		if(solver_mode == SOLVER_DECAY) compute_correction_precomputed(correction, n_nodal, *get_decay_coefficients(n_nodal), h, load_v);
+		else if(is_same<T, Acc>::value) compute_correction_dispatch(correction, n_nodal, h, load_v, num_lines, pool);
+		else{
+			const Acc * w = NULL, * b = NULL;
+			get_thomas_tables(n_nodal, w, b);
+			compute_correction_precomputed(correction, n_nodal, w, b, h, load_v);
+		}
+		for(int i=0; i<n_nodal; i++){
+			nodal_buffer[i] += correction[i];
+		}
+		copy_to_strided(buffer, n, data_pos, stride);
+	}
+	// decompose a level of batchsize interleaved lines of n values (see interleave_lines)
+	// with the operations of decompose_level_1D on every line, vectorized across lines
+	// n x batchsize elements in buffer, (n/2 + 1) x batchsize in correction and load_v
+	void decompose_level_1D_batched(T * block, size_t n, size_t batchsize, T h, T * buffer, T * correction, T * load_v, bool hierarchical, const ThomasTables<Acc>& tables, const DecayCoefficients<Acc> * decay){
+		size_t n_nodal = (n >> 1) + 1;
+		size_t n_coeff = n - n_nodal;
+		switch_rows_2D_by_buffer(block, buffer, n, batchsize, batchsize);
+		T * nodal = block;
+		T * coeff = block + n_nodal * batchsize;
+		if(!(n & 1)){
+			// virtual nodal value, as in data_reorder_1D
+			T * last = nodal + (n_nodal - 1) * batchsize;
+			for(size_t j=0; j<batchsize; j++){
+				last[j] = 2*last[j] - (last - batchsize)[j];
+			}
+		}
+		for(size_t i=0; i<n_coeff; i++){
+			const T * left = nodal + i * batchsize;
+			T * coeff_pos = coeff + i * batchsize;
+			for(size_t j=0; j<batchsize; j++){
+				coeff_pos[j] -= (left[j] + left[batchsize + j]) / 2;
+			}
+		}
+		if(hierarchical) return;
+		compute_load_vector_nodal_row_batched(load_v, n_nodal, n_coeff, h, coeff, batchsize);
+		if(decay) compute_correction_batched(correction, h, *decay, n_nodal, batchsize, batchsize, load_v);
+		else compute_correction_batched(correction, h, tables, n_nodal, batchsize, batchsize, load_v);
+		for(size_t i=0; i<n_nodal*batchsize; i++){
+			nodal[i] += correction[i];
+		}
 	}
     void decompose_level_1D_with_hierarchical_basis(T * data_pos, size_t n, T h, bool nodal_row=true){
+        decompose_level_1D_with_hierarchical_basis(data_pos, n, h, 1, data_buffer);
+    }
+    void decompose_level_1D_with_hierarchical_basis(T * data_pos, size_t n, T h, size_t stride, T * buffer){
         size_t n_nodal = (n >> 1) + 1;
         size_t n_coeff = n - n_nodal;
-        T * nodal_buffer = data_buffer;
-        T * coeff_buffer = data_buffer + n_nodal;
-        data_reorder_1D(data_pos, n_nodal, n_coeff, nodal_buffer, coeff_buffer);
+        T * nodal_buffer = buffer;
+        T * coeff_buffer = buffer + n_nodal;
+        data_reorder_1D(data_pos, n_nodal, n_coeff, nodal_buffer, coeff_buffer, stride);
         compute_interpolant_difference_1D(n_coeff, nodal_buffer, coeff_buffer);
-		memcpy(data_pos, data_buffer, n*sizeof(T));
+		copy_to_strided(buffer, n, data_pos, stride);
     }
 	// compute the difference between original value 
 	// and interpolant (I - PI_l)Q_l for the coefficient rows in 2D
@@ -153,26 +465,22 @@ private:
 		size_t n1_coeff = n1 - n1_nodal;
 		size_t n2_nodal = (n2 >> 1) + 1;
 		size_t n2_coeff = n2 - n2_nodal;
-		bool even_n2 = !(n2 & 1);
 		T * n1_nodal_data = data_pos;
 		T * n1_coeff_data = data_pos + n1_nodal * stride;
 		for(int i=0; i<n1_coeff; i++){
             const T * nodal_pos = n1_nodal_data + i * stride;
             T * coeff_pos = n1_coeff_data + i * stride;
-            // TODO: optimize average computation
             T * nodal_coeff_pos = coeff_pos;	// coeffcients in nodal rows
             T * coeff_coeff_pos = coeff_pos + n2_nodal;	// coefficients in coeffcients rows
-            for(int j=0; j<n2_coeff; j++){
+            // vertical average of each nodal column, reused by the two centers next to it
+            T prev_mid = 0;
+            for(int j=0; j<n2_nodal; j++){
+                T mid = (nodal_pos[j] + nodal_pos[stride + j]) / 2;
                 // coefficients in nodal columns
-                *(nodal_coeff_pos++) -= (nodal_pos[j] + nodal_pos[stride + j]) / 2;
-                // coefficients in centers
-                *(coeff_coeff_pos++) -= (nodal_pos[j] + nodal_pos[j + 1] + nodal_pos[stride + j] + nodal_pos[stride + j + 1]) / 4;
-            }
-            // compute the last (or second last if n2 is even) nodal column
-            *(nodal_coeff_pos ++) -= (nodal_pos[n2_coeff] + nodal_pos[stride + n2_coeff]) / 2;
-            if(even_n2){
-                // compute the last nodal column
-                *(nodal_coeff_pos ++) -= (nodal_pos[n2_coeff + 1] + nodal_pos[stride + n2_coeff + 1]) / 2;
+                nodal_coeff_pos[j] -= mid;
+                // coefficients in centers, between nodal columns j - 1 and j
+                if((j > 0) && (j - 1 < n2_coeff)) coeff_coeff_pos[j - 1] -= (prev_mid + mid) / 2;
+                prev_mid = mid;
             }
 		}
 	}
@@ -193,151 +501,244 @@ private:
 	}	
 	// decompose n1 x n2 data into coarse level (n1/2 x n2/2)
 	void decompose_level_2D(T * data_pos, size_t n1, size_t n2, T h, size_t stride){
+		decompose_level_2D(data_pos, n1, n2, h, stride, data_buffer, load_v_buffer);
+	}
+	// same as above with explicit workspaces: n1 x n2 elements in buffer,
+	// default_batch_size x max(n1, n2) in load_v
+	// the factors of n1 and n2 must have been prepared when called from a task
+	void decompose_level_2D(T * data_pos, size_t n1, size_t n2, T h, size_t stride, T * buffer, T * load_v){
 		// cerr << "decompose, h = " << h << endl; 
         size_t n1_nodal = (n1 >> 1) + 1;
         size_t n1_coeff = n1 - n1_nodal;
         size_t n2_nodal = (n2 >> 1) + 1;
         size_t n2_coeff = n2 - n2_nodal;
-		data_reorder_2D(data_pos, data_buffer, n1, n2, stride);
+		data_reorder_2D(data_pos, buffer, n1, n2, stride);
 		compute_interpolant_difference_2D(data_pos, n1, n2, stride);
-        vector<T> w1(n1_nodal);
-        vector<T> b1(n1_nodal);
-        vector<T> w2(n2_nodal);
-        vector<T> b2(n2_nodal);
-        precompute_w_and_b(w1.data(), b1.data(), n1_nodal);
-        precompute_w_and_b(w2.data(), b2.data(), n2_nodal);
-        compute_correction_2D(data_pos, data_buffer, load_v_buffer, n1, n2, n1_nodal, h, stride, w1.data(), b1.data(), w2.data(), b2.data(), default_batch_size);
-        apply_correction_batched(data_pos, data_buffer, n1_nodal, stride, n2_nodal, true);
+        if(solver_mode == SOLVER_DECAY){
+            compute_correction_2D(data_pos, buffer, load_v, n1, n2, n1_nodal, h, stride, *get_decay_coefficients(n1_nodal), *get_decay_coefficients(n2_nodal), default_batch_size);
+        }
+        else{
+            const Acc * w1 = NULL, * b1 = NULL, * w2 = NULL, * b2 = NULL;
+            get_thomas_tables(n1_nodal, w1, b1);
+            get_thomas_tables(n2_nodal, w2, b2);
+            compute_correction_2D(data_pos, buffer, load_v, n1, n2, n1_nodal, h, stride, w1, b1, w2, b2, default_batch_size);
+        }
+        apply_correction_batched(data_pos, buffer, n1_nodal, stride, n2_nodal, true);
 	}
     void decompose_level_2D_with_hierarchical_basis(T * data_pos, size_t n1, size_t n2, T h, size_t stride){
-        data_reorder_2D(data_pos, data_buffer, n1, n2, stride);
+        decompose_level_2D_with_hierarchical_basis(data_pos, n1, n2, h, stride, data_buffer);
+    }
+    void decompose_level_2D_with_hierarchical_basis(T * data_pos, size_t n1, size_t n2, T h, size_t stride, T * buffer){
+        data_reorder_2D(data_pos, buffer, n1, n2, stride);
         compute_interpolant_difference_2D(data_pos, n1, n2, stride);
     }
+	// compute the difference for one coefficient plane, given the nodal plane before it
+	// reads only the nodal values of the two adjacent nodal planes
+	// buffer: 2 * n3 elements
 	/*
-		2D computation + vertical computation for coefficient plane 
+		the multilinear interpolant is applied one dimension at a time:
+		mid[j][k] = (nodal[j][k] + next_nodal[j][k]) / 2 over the nodal (j, k),
+		row[j][k] = (mid[j][k] + mid[j][k + 1]) / 2 along n3, and the averages
+		of two consecutive mid / row rows along n2, so that every nodal value is
+		loaded once per plane; rows of mid and row are kept for the next j
+		with eps the machine epsilon, each average rounds once per dimension, so
+		the interpolant of a center is within 3/2 eps max|nodal| of the exact
+		average; the former 8-point sum rounds up to 7 times (35/16 eps), and a
+		coefficient of one level differs from the former one by at most
+		6 eps max|data| (test_interpolant); the mass-matrix corrections carry
+		these differences to the coarser levels, and a full float decomposition
+		differs by up to 24 eps max|data| (2D 129 x 100) and 5 (3D)
 	*/
-	void compute_interpolant_difference_3D(T * data_pos, size_t n1, size_t n2, size_t n3, size_t dim0_stride, size_t dim1_stride){
-		size_t n1_nodal = (n1 >> 1) + 1;
-		size_t n1_coeff = n1 - n1_nodal;
+	void compute_interpolant_difference_3D_coeff_plane(const T * nodal_pos, T * coeff_pos, size_t n2, size_t n3, size_t dim0_stride, size_t dim1_stride, T * buffer){
 		size_t n2_nodal = (n2 >> 1) + 1;
 		size_t n2_coeff = n2 - n2_nodal;
 		size_t n3_nodal = (n3 >> 1) + 1;
 		size_t n3_coeff = n3 - n3_nodal;
-		bool even_n2 = (!(n2 & 1));
-		bool even_n3 = (!(n3 & 1));
-		T * cur_data_pos = data_pos;
- 		for(int i=0; i<n1_nodal; i++){
- 			compute_interpolant_difference_2D(cur_data_pos, n2, n3, dim1_stride);
- 			cur_data_pos += dim0_stride;
- 		}
- 		// compute vertically
- 		const T * nodal_pos = data_pos;
- 		T * coeff_pos = data_pos + n1_nodal * dim0_stride;
-		for(int i=0; i<n1_coeff; i++){
-			// iterate throught coefficient planes along n1
-			/*
-				data in the coefficient plane
-				xxxxx		xxx						xx
-				xxxxx		xxx	coeff_nodal_nonal	xx 	coeff_nodal_coeff
-				xxxxx	=>	xxx						xx
-				xxxxx
-				xxxxx		xxx	coeff_coeff_nodal	xx 	coeff_coeff_coeff
-							xxx						xx
-			*/
-            const T * nodal_nodal_nodal_pos = nodal_pos;
-            T * coeff_nodal_nodal_pos = coeff_pos;
-            T * coeff_nodal_coeff_pos = coeff_pos + n3_nodal;
-            T * coeff_coeff_nodal_pos = coeff_pos + n2_nodal * dim1_stride;
-            T * coeff_coeff_coeff_pos = coeff_coeff_nodal_pos + n3_nodal;
-            // TODO: optimize average computation
-            for(int j=0; j<n2_coeff; j++){
-            	for(int k=0; k<n3_coeff; k++){
-	                // coeff_nodal_nonal
-	                coeff_nodal_nodal_pos[k] -= (nodal_nodal_nodal_pos[k] + nodal_nodal_nodal_pos[dim0_stride + k]) / 2;
-	                // coeff_nodal_coeff
-	                coeff_nodal_coeff_pos[k] -= (nodal_nodal_nodal_pos[k] + nodal_nodal_nodal_pos[dim0_stride + k] +
-	                								nodal_nodal_nodal_pos[k + 1] + nodal_nodal_nodal_pos[dim0_stride + k + 1]) / 4;
-	                // coeff_coeff_nodal
-	                coeff_coeff_nodal_pos[k] -= (nodal_nodal_nodal_pos[k] + nodal_nodal_nodal_pos[dim0_stride + k] +
-	                								nodal_nodal_nodal_pos[k + dim1_stride] + nodal_nodal_nodal_pos[dim0_stride + k + dim1_stride]) / 4;
-	                // coeff_coeff_coeff
-	                coeff_coeff_coeff_pos[k] -= (nodal_nodal_nodal_pos[k] + nodal_nodal_nodal_pos[dim0_stride + k] +
-	                								nodal_nodal_nodal_pos[k + 1] + nodal_nodal_nodal_pos[dim0_stride + k + 1] +
-	                								nodal_nodal_nodal_pos[k + dim1_stride] + nodal_nodal_nodal_pos[dim0_stride + k + dim1_stride] + 
-	                								nodal_nodal_nodal_pos[k + dim1_stride + 1] + nodal_nodal_nodal_pos[dim0_stride + k + dim1_stride + 1]) / 8;
-                }
-	            // compute the last (or second last if n3 is even) coeff_*_nodal column
-	            coeff_nodal_nodal_pos[n3_coeff] -= (nodal_nodal_nodal_pos[n3_coeff] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff]) / 2;
-                coeff_coeff_nodal_pos[n3_coeff] -= (nodal_nodal_nodal_pos[n3_coeff] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff] +
-                								nodal_nodal_nodal_pos[n3_coeff + dim1_stride] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff + dim1_stride]) / 4;
-	            if(even_n3){
-	            	// compute the last coeff_*_nodal column if n3 is even
-		            coeff_nodal_nodal_pos[n3_coeff + 1] -= (nodal_nodal_nodal_pos[n3_coeff + 1] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff + 1]) / 2;
-	                coeff_coeff_nodal_pos[n3_coeff + 1] -= (nodal_nodal_nodal_pos[n3_coeff + 1] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff + 1] +
-	                								nodal_nodal_nodal_pos[n3_coeff + 1 + dim1_stride] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff + 1 + dim1_stride]) / 4;
-	            }
-	            coeff_nodal_nodal_pos += dim1_stride;
-	            coeff_nodal_coeff_pos += dim1_stride;
-	            coeff_coeff_nodal_pos += dim1_stride;
-	            coeff_coeff_coeff_pos += dim1_stride;
-	            nodal_nodal_nodal_pos += dim1_stride;
-            }
-            // compute the last (or second last if n2 is even) coeff_nodal_* row
-            {
-            	for(int k=0; k<n3_coeff; k++){
-            		coeff_nodal_nodal_pos[k] -= (nodal_nodal_nodal_pos[k] + nodal_nodal_nodal_pos[dim0_stride + k]) / 2;
-	                coeff_nodal_coeff_pos[k] -= (nodal_nodal_nodal_pos[k] + nodal_nodal_nodal_pos[dim0_stride + k] +
-	                								nodal_nodal_nodal_pos[k + 1] + nodal_nodal_nodal_pos[dim0_stride + k + 1]) / 4;
-            	}
-        		coeff_nodal_nodal_pos[n3_coeff] -= (nodal_nodal_nodal_pos[n3_coeff] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff]) / 2;
-            	if(even_n3){
-            		coeff_nodal_nodal_pos[n3_coeff + 1] -= (nodal_nodal_nodal_pos[n3_coeff + 1] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff + 1]) / 2;
-            	}
-                coeff_nodal_nodal_pos += dim1_stride;
-                coeff_nodal_coeff_pos += dim1_stride;
-                coeff_coeff_nodal_pos += dim1_stride;
-                coeff_coeff_coeff_pos += dim1_stride;
-                nodal_nodal_nodal_pos += dim1_stride;
-        	}
-            if(even_n2){
-                // compute the last coeff_nodal_* row if n2 is even
-            	for(int k=0; k<n3_coeff; k++){
-            		coeff_nodal_nodal_pos[k] -= (nodal_nodal_nodal_pos[k] + nodal_nodal_nodal_pos[dim0_stride + k]) / 2;
-	                coeff_nodal_coeff_pos[k] -= (nodal_nodal_nodal_pos[k] + nodal_nodal_nodal_pos[dim0_stride + k] +
-	                								nodal_nodal_nodal_pos[k + 1] + nodal_nodal_nodal_pos[dim0_stride + k + 1]) / 4;
-            	}
-        		coeff_nodal_nodal_pos[n3_coeff] -= (nodal_nodal_nodal_pos[n3_coeff] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff]) / 2;
-            	if(even_n3){
-            		coeff_nodal_nodal_pos[n3_coeff + 1] -= (nodal_nodal_nodal_pos[n3_coeff + 1] + nodal_nodal_nodal_pos[dim0_stride + n3_coeff + 1]) / 2;
-            	}
-            }
-            nodal_pos += dim0_stride;
-            coeff_pos += dim0_stride;
+		/*
+			data in the coefficient plane
+			xxxxx		xxx						xx
+			xxxxx		xxx	coeff_nodal_nonal	xx 	coeff_nodal_coeff
+			xxxxx	=>	xxx						xx
+			xxxxx
+			xxxxx		xxx	coeff_coeff_nodal	xx 	coeff_coeff_coeff
+						xxx						xx
+		*/
+		T * mid = buffer;
+		T * prev_mid = buffer + n3_nodal;
+		T * row = buffer + 2 * n3_nodal;
+		T * prev_row = row + n3_coeff;
+		for(int j=0; j<n2_nodal; j++){
+			const T * nodal_nodal_nodal_pos = nodal_pos + j * dim1_stride;
+			T * coeff_nodal_nodal_pos = coeff_pos + j * dim1_stride;
+			T * coeff_nodal_coeff_pos = coeff_nodal_nodal_pos + n3_nodal;
+			for(int k=0; k<n3_nodal; k++){
+				mid[k] = (nodal_nodal_nodal_pos[k] + nodal_nodal_nodal_pos[dim0_stride + k]) / 2;
+				coeff_nodal_nodal_pos[k] -= mid[k];
+			}
+			for(int k=0; k<n3_coeff; k++){
+				row[k] = (mid[k] + mid[k + 1]) / 2;
+				coeff_nodal_coeff_pos[k] -= row[k];
+			}
+			// coefficient row j - 1 lies between nodal rows j - 1 and j
+			if((j > 0) && (j - 1 < n2_coeff)){
+				T * coeff_coeff_nodal_pos = coeff_pos + (n2_nodal + j - 1) * dim1_stride;
+				T * coeff_coeff_coeff_pos = coeff_coeff_nodal_pos + n3_nodal;
+				for(int k=0; k<n3_nodal; k++){
+					coeff_coeff_nodal_pos[k] -= (prev_mid[k] + mid[k]) / 2;
+				}
+				for(int k=0; k<n3_coeff; k++){
+					coeff_coeff_coeff_pos[k] -= (prev_row[k] + row[k]) / 2;
+				}
+			}
+			swap(mid, prev_mid);
+			swap(row, prev_row);
 		}
 	}
-	// decompse n1 x n2 x n3 data into coarse level (n1/2 x n2/2 x n3/2)
-	void decompose_level_3D(T * data_pos, size_t n1, size_t n2, size_t n3, T h, size_t dim0_stride, size_t dim1_stride){
-		data_reorder_3D(data_pos, data_buffer, n1, n2, n3, dim0_stride, dim1_stride);
-		compute_interpolant_difference_3D(data_pos, n1, n2, n3, dim0_stride, dim1_stride);
-        size_t n1_nodal = (n1 >> 1) + 1;
-        size_t n2_nodal = (n2 >> 1) + 1;
-        size_t n3_nodal = (n3 >> 1) + 1;
-        compute_correction_3D(data_pos, data_buffer, load_v_buffer, n1, n2, n3, n1_nodal, h, dim0_stride, dim1_stride, default_batch_size);
-        T * nodal_pos = data_pos;
-        const T * correction_pos = data_buffer;
-        for(int i=0; i<n1_nodal; i++){
-            apply_correction_batched(nodal_pos, correction_pos, n2_nodal, dim1_stride, n3_nodal, true);
-            nodal_pos += dim0_stride;
-            correction_pos += n2_nodal * n3_nodal;
+	// add the tasks of a 3D level (n1 x n2 x n3 into n1/2 x n2/2 x n3/2) to the graph
+	// after the tasks of the previous level, and return the tasks that finish the level
+	/*
+		reorder rows -> reorder planes -> reorder columns -> interpolant difference
+		of planes -> 2D correction of planes -> vertical correction of columns
+		the level starts and ends with slabs of the same rows (n2 index): the vertical
+		correction of rows j finishes them for the next level, whose row reorder of
+		rows j only waits for that slab, so coarse levels start on the rows that are
+		done while the rest of the finer level is still running
+		each plane's correction only waits for its own interpolant difference,
+		the other phases read across all planes or columns and wait for a join
+	*/
+	LevelTasks add_decompose_level_3D_tasks(TaskGraph& graph, const LevelTasks& level, T * data_pos, size_t n1, size_t n2, size_t n3, T h, size_t dim0_stride, size_t dim1_stride, bool hierarchical){
+		size_t n1_nodal = (n1 >> 1) + 1;
+		size_t n2_nodal = (n2 >> 1) + 1;
+		size_t n3_nodal = (n3 >> 1) + 1;
+		// reorder (1) of data_reorder_2D for the rows j of all planes
+		vector<int> row_tasks = add_slab_tasks(graph, n2, get_slab_dependencies(graph, n2, level), [=](size_t j){
+			data_reorder_2D_rows(data_pos + j * dim1_stride, get_thread_data_buffer(), n1, n3, dim0_stride);
+		});
+		vector<int> reorder_tasks = add_slab_tasks(graph, n1, graph.add_join(row_tasks), [=](size_t i){
+			data_reorder_2D_columns(data_pos + i * dim0_stride, get_thread_data_buffer(), n2, n3, dim1_stride);
+		});
+		vector<int> vertical_reorder_tasks = add_slab_tasks(graph, n2, graph.add_join(reorder_tasks), [=](size_t j){
+			T * cur_data_pos = data_pos + j * dim1_stride;
+			if(!(n1 & 1)){
+				// n1 is even, change the last coeff row into nodal row
+				T * last_row = cur_data_pos + (n1 - 1) * dim0_stride;
+				for(int k=0; k<n3; k++){
+					last_row[k] = 2 * last_row[k] - last_row[- dim0_stride + k];
+				}
+			}
+			switch_rows_2D_by_buffer(cur_data_pos, get_thread_data_buffer(), n1, n3, dim0_stride);
+		});
+		vector<int> interpolant_tasks = add_slab_tasks(graph, n1, graph.add_join(vertical_reorder_tasks), [=](size_t i){
+			if(i < n1_nodal) compute_interpolant_difference_2D(data_pos + i * dim0_stride, n2, n3, dim1_stride);
+			else compute_interpolant_difference_3D_coeff_plane(data_pos + (i - n1_nodal) * dim0_stride, data_pos + i * dim0_stride, n2, n3, dim0_stride, dim1_stride, get_thread_data_buffer());
+		});
+		if(hierarchical) return LevelTasks(graph.add_join(interpolant_tasks));
+        const Acc * w1 = NULL, * b1 = NULL, * w2 = NULL, * b2 = NULL, * w3 = NULL, * b3 = NULL;
+        get_thomas_tables(n1_nodal, w1, b1);
+        get_thomas_tables(n2_nodal, w2, b2);
+        get_thomas_tables(n3_nodal, w3, b3);
+        const DecayCoefficients<Acc> * decay1 = NULL, * decay2 = NULL, * decay3 = NULL;
+        if(solver_mode == SOLVER_DECAY){
+            decay1 = get_decay_coefficients(n1_nodal);
+            decay2 = get_decay_coefficients(n2_nodal);
+            decay3 = get_decay_coefficients(n3_nodal);
         }
+        // 2D corrections of all planes, stored in data_buffer
+        // the horizontal sweep of a plane fills n2 x n3_nodal entries before the
+        // vertical sweep reduces them to n2_nodal x n3_nodal, so planes are
+        // spaced by n2 x n3_nodal to be computed independently
+        size_t correction_plane_size = n2 * n3_nodal;
+        T * correction_buffer = data_buffer;
+        int batchsize = default_batch_size;
+        vector<int> correction_tasks = add_slab_tasks(graph, n1, interpolant_tasks, [=](size_t i){
+            size_t nodal_rows = (i < n1_nodal) ? n2_nodal : 0;
+            if(decay2) compute_correction_2D(data_pos + i * dim0_stride, correction_buffer + i * correction_plane_size, get_thread_load_v_buffer(), n2, n3, nodal_rows, h, dim1_stride, *decay2, *decay3, batchsize);
+            else compute_correction_2D(data_pos + i * dim0_stride, correction_buffer + i * correction_plane_size, get_thread_load_v_buffer(), n2, n3, nodal_rows, h, dim1_stride, w2, b2, w3, b3, batchsize);
+        });
+        // vertical corrections, applied to the nodal rows they belong to
+        vector<int> vertical_correction_tasks = add_slab_tasks(graph, n2_nodal, graph.add_join(correction_tasks), [=](size_t j){
+            T * correction_pos = correction_buffer + j * n3_nodal;
+            if(decay1) compute_correction_vertical(data_pos, n1, n3, h, correction_pos, correction_plane_size, get_thread_load_v_buffer(), *decay1, batchsize);
+            else compute_correction_vertical(data_pos, n1, n3, h, correction_pos, correction_plane_size, get_thread_load_v_buffer(), w1, b1, batchsize);
+            apply_correction_batched(data_pos + j * dim1_stride, correction_pos, n1_nodal, dim0_stride, n3_nodal, true, correction_plane_size);
+        });
+        // slab j of the vertical correction writes the rows j of the nodal planes,
+        // which are the rows j of the next level
+        return LevelTasks(vertical_correction_tasks, n2_nodal, -1);
 	}
-    void decompose_level_3D_with_hierarchical_basis(T * data_pos, size_t n1, size_t n2, size_t n3, T h, size_t dim0_stride, size_t dim1_stride){
-        data_reorder_3D(data_pos, data_buffer, n1, n2, n3, dim0_stride, dim1_stride);
-        compute_interpolant_difference_3D(data_pos, n1, n2, n3, dim0_stride, dim1_stride);
-    }
 
-};
+	// add the tasks of an anisotropic level, where only the active dimensions are coarsened
+	// n, strides and active describe a 3D region whose last dimension is contiguous;
+	// lower-dimensional data is passed with leading dimensions of size 1
+	/*
+		the region is split into slices along the inactive dimensions, and each slice
+		is decomposed with the 2D or 1D kernel along the active ones;
+		if the contiguous dimension is inactive, the region is first packed into
+		pack_buffer with the active dimensions innermost and unpacked afterwards
+	*/
+	int add_decompose_level_mixed_tasks(TaskGraph& graph, int dependency, T * data_pos, const vector<size_t>& n, const vector<size_t>& strides, const vector<bool>& active, T h, bool hierarchical){
+		// inactive dimensions first, then active ones
+		vector<int> order;
+		for(int d=0; d<3; d++) if(!active[d]) order.push_back(d);
+		for(int d=0; d<3; d++) if(active[d]) order.push_back(d);
+		size_t num_active = count(active.begin(), active.end(), true);
+		size_t q0 = n[order[0]], q1 = n[order[1]], q2 = n[order[2]];
+		size_t src_stride0 = strides[order[0]], src_stride1 = strides[order[1]], src_stride2 = strides[order[2]];
+		bool packed = !active[2];
+		T * view = packed ? get_pack_buffer() : data_pos;
+		size_t view_stride0 = packed ? q1 * q2 : src_stride0;
+		size_t view_stride1 = packed ? q2 : src_stride1;
+		if(packed){
+			vector<int> pack_tasks = add_slab_tasks(graph, q0, dependency, [=](size_t a){
+				T * dst = view + a * view_stride0;
+				const T * src = data_pos + a * src_stride0;
+				for(size_t b=0; b<q1; b++){
+					for(size_t c=0; c<q2; c++){
+						*(dst++) = src[b * src_stride1 + c * src_stride2];
+					}
+				}
+			});
+			dependency = graph.add_join(pack_tasks);
+		}
+		vector<int> level_tasks;
+		if(num_active == 2){
+			prepare_factors((q1 >> 1) + 1);
+			prepare_factors((q2 >> 1) + 1);
+			level_tasks = add_slab_tasks(graph, q0, dependency, [=](size_t a){
+				T * plane = view + a * view_stride0;
+				if(hierarchical) decompose_level_2D_with_hierarchical_basis(plane, q1, q2, h, view_stride1, get_thread_data_buffer());
+				else decompose_level_2D(plane, q1, q2, h, view_stride1, get_thread_data_buffer(), get_thread_load_v_buffer());
+			});
+		}
+		else{
+			size_t num_lines = q0 * q1;
+			if(!hierarchical) prepare_factors((q2 >> 1) + 1);
+			level_tasks = add_slab_tasks(graph, num_lines, dependency, [=](size_t l){
+				T * line = view + (l / q1) * view_stride0 + (l % q1) * view_stride1;
+				if(hierarchical) decompose_level_1D_with_hierarchical_basis(line, q2, h, 1, get_thread_data_buffer());
+				else{
+					T * load_v = get_thread_load_v_buffer();
+					decompose_level_1D(line, q2, h, 1, get_thread_data_buffer(), load_v + (q2 >> 1) + 1, load_v, num_lines);
+				}
+			});
+		}
+		dependency = graph.add_join(level_tasks);
+		if(packed){
+			vector<int> unpack_tasks = add_slab_tasks(graph, q0, dependency, [=](size_t a){
+				const T * src = view + a * view_stride0;
+				T * dst = data_pos + a * src_stride0;
+				for(size_t b=0; b<q1; b++){
+					for(size_t c=0; c<q2; c++){
+						dst[b * src_stride1 + c * src_stride2] = *(src++);
+					}
+				}
+			});
+			dependency = graph.add_join(unpack_tasks);
+		}
+		return dependency;
+	}
 
+};
 }
 
 #endif
\ No newline at end of file
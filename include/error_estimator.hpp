@@ -0,0 +1,304 @@
+#ifndef _MGARD_ERROR_ESTIMATOR_HPP
+#define _MGARD_ERROR_ESTIMATOR_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "utils.hpp"
+#include "recompose.hpp"
+#include "operator_norm.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// statistics of the coefficient errors of each level, from the coarsest level 0
+struct LevelErrors{
+    vector<size_t> count;       // number of coefficients
+    vector<double> sum_squares; // sum of squared errors
+    vector<double> max_abs;     // maximal absolute error
+};
+
+// level of every index along each dimension: index i belongs to the first level l
+// with i < level_dims[l][k]; a value belongs to the highest level among its indices
+inline vector<vector<int>> init_level_index(const vector<size_t>& dims, const vector<vector<size_t>>& level_dims){
+    vector<vector<int>> level_index(dims.size());
+    for(int k=0; k<dims.size(); k++){
+        level_index[k].resize(dims[k]);
+        int l = 0;
+        for(size_t i=0; i<dims[k]; i++){
+            while(i >= level_dims[l][k]) l ++;
+            level_index[k][i] = l;
+        }
+    }
+    return level_index;
+}
+
+// values are visited in blocks of level_block_size, see for_each_level_value
+const size_t level_block_size = 1 << 16;
+inline size_t get_num_level_blocks(const vector<size_t>& dims){
+    size_t num_elements = 1;
+    for(const auto& d:dims){
+        num_elements *= d;
+    }
+    return (num_elements + level_block_size - 1) / level_block_size;
+}
+// run func(b, p, l) for every value p of a dense decomposed array with its level l,
+// where b is the block of p; blocks run in parallel on pool if not NULL
+template <class Func>
+void for_each_level_value(const vector<size_t>& dims, const vector<vector<size_t>>& level_dims, ThreadPool * pool, const Func& func){
+    auto level_index = init_level_index(dims, level_dims);
+    // pad to 3 dimensions with leading dimensions of size 1
+    size_t n[3] = {1, 1, 1};
+    vector<int> zeros(1, 0);
+    const int * index[3] = {zeros.data(), zeros.data(), zeros.data()};
+    int offset = 3 - dims.size();
+    for(int k=0; k<dims.size(); k++){
+        n[offset + k] = dims[k];
+        index[offset + k] = level_index[k].data();
+    }
+    size_t num_elements = n[0] * n[1] * n[2];
+    size_t num_blocks = get_num_level_blocks(dims);
+    auto block = [&](size_t b){
+        size_t begin = b * level_block_size;
+        size_t end = min(begin + level_block_size, num_elements);
+        size_t i = begin / (n[1] * n[2]), j = (begin / n[2]) % n[1], k = begin % n[2];
+        int l1 = max(index[0][i], index[1][j]);
+        for(size_t p=begin; p<end; p++){
+            func(b, p, max(l1, index[2][k]));
+            if(++ k == n[2]){
+                k = 0;
+                if(++ j == n[1]) j = 0, i ++;
+                if(p + 1 < end) l1 = max(index[0][i], index[1][j]);
+            }
+        }
+    };
+    if(pool) pool->parallel_for(0, num_blocks, block);
+    else for(size_t b=0; b<num_blocks; b++) block(b);
+}
+
+// gather per-level statistics of coeff - approx (e.g. decomposed and dequantized coefficients)
+/*
+@params coeff, approx: dense decomposed data
+@params dims: dimensions
+@params target_level: number of levels of the decomposition
+@params pool: parallelize over blocks of values if not NULL
+*/
+template <class T>
+LevelErrors compute_level_errors(const T * coeff, const T * approx, const vector<size_t>& dims, size_t target_level, ThreadPool * pool=NULL){
+    if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+    auto level_dims = init_levels(dims, target_level);
+    size_t num_levels = target_level + 1;
+    // partial statistics per block of values, reduced in order for a deterministic result
+    size_t num_blocks = get_num_level_blocks(dims);
+    vector<double> sum_squares(num_blocks * num_levels, 0);
+    vector<double> max_abs(num_blocks * num_levels, 0);
+    for_each_level_value(dims, level_dims, pool, [&](size_t b, size_t p, int l){
+        double err = coeff[p] - approx[p];
+        sum_squares[b * num_levels + l] += err * err;
+        max_abs[b * num_levels + l] = max(max_abs[b * num_levels + l], fabs(err));
+    });
+    LevelErrors errors;
+    errors.count.resize(num_levels, 0);
+    errors.sum_squares.resize(num_levels, 0);
+    errors.max_abs.resize(num_levels, 0);
+    for(size_t l=0; l<num_levels; l++){
+        size_t box = 1, inner = (l > 0);
+        for(int k=0; k<dims.size(); k++){
+            box *= level_dims[l][k];
+            if(l > 0) inner *= level_dims[l - 1][k];
+        }
+        errors.count[l] = box - inner;
+        for(size_t b=0; b<num_blocks; b++){
+            errors.sum_squares[l] += sum_squares[b * num_levels + l];
+            errors.max_abs[l] = max(errors.max_abs[l], max_abs[b * num_levels + l]);
+        }
+    }
+    return errors;
+}
+
+// expected statistics of a uniform quantizer with error bound eb[l] on level l
+// (errors uniformly distributed in [-eb[l], eb[l]])
+inline LevelErrors uniform_level_errors(const vector<size_t>& dims, size_t target_level, const vector<double>& eb){
+    if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+    auto level_dims = init_levels(dims, target_level);
+    LevelErrors errors;
+    for(size_t l=0; l<=target_level; l++){
+        size_t box = 1, inner = (l > 0);
+        for(int k=0; k<dims.size(); k++){
+            box *= level_dims[l][k];
+            if(l > 0) inner *= level_dims[l - 1][k];
+        }
+        errors.count.push_back(box - inner);
+        errors.sum_squares.push_back((box - inner) * eb[l] * eb[l] / 3);
+        errors.max_abs.push_back(eb[l]);
+    }
+    return errors;
+}
+
+// estimated reconstruction error
+struct ErrorEstimate{
+    double l2 = 0;          // expected ||x - x'||_2
+    double rmse = 0;        // expected root mean squared error
+    double linf = 0;        // estimated ||x - x'||_inf
+    double linf_bound = 0;  // guaranteed ||x - x'||_inf, hierarchical basis only (0 otherwise)
+    double calibration = 1; // factor applied to linf by the calibration run
+    bool is_bound = false;  // linf is guaranteed (equal to linf_bound); otherwise it is a
+                            // statistical estimate that the actual error may exceed
+};
+
+// estimate the reconstruction error from coefficient errors, without recomposition
+// L2: the coefficient errors of level l are treated as uncorrelated, so that
+//     E||R e||^2 = sum_l w_l^2 ||e_l||^2 with the discrete level weights w_l of OperatorNorm
+// Linf: the error of a value is a sum of many independent contributions, so its maximum
+//     over N values is about rmse * sqrt(2 ln N); optionally calibrated by recomposing
+//     synthetic errors with the same level statistics on a small grid
+// in the hierarchical basis every level adds its coefficients to a convex interpolation
+// of the coarser level, which also gives the guaranteed bound sum_l max|e_l|; in the
+// orthogonal basis linf is only an estimate and is_bound is false
+// the weights are computed on a surrogate grid of about surrogate_elements values and
+// extrapolated to coarser levels, so that an estimate costs a small fraction of a
+// decomposition; they are cached per surrogate shape
+template <class T>
+class ErrorEstimator{
+public:
+    ErrorEstimator(){}
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+        operator_norm.set_thread_pool(pool_);
+        recomposer.set_thread_pool(pool_);
+    }
+    ErrorEstimate estimate(const vector<size_t>& dims, size_t target_level, const LevelErrors& errors, bool hierarchical=false, bool calibrate=false){
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        size_t num_elements = 1;
+        for(const auto& d:dims){
+            num_elements *= d;
+        }
+        auto weights = get_level_weights(dims, target_level, hierarchical);
+        ErrorEstimate estimate;
+        double sum = 0;
+        for(size_t l=0; l<=target_level; l++){
+            sum += weights[l] * weights[l] * errors.sum_squares[l];
+        }
+        estimate.l2 = sqrt(sum);
+        estimate.rmse = sqrt(sum / num_elements);
+        estimate.linf = estimate.rmse * tail_factor(num_elements);
+        if(calibrate){
+            estimate.calibration = calibration_factor(dims, target_level, errors, hierarchical);
+            estimate.linf *= estimate.calibration;
+        }
+        if(hierarchical){
+            for(size_t l=0; l<=target_level; l++){
+                estimate.linf_bound += errors.max_abs[l];
+            }
+            estimate.linf = min(estimate.linf, estimate.linf_bound);
+            estimate.is_bound = (estimate.linf == estimate.linf_bound);
+        }
+        return estimate;
+    }
+    // discrete level weights w_l of the reconstruction, see estimate
+    vector<double> get_level_weights(const vector<size_t>& dims, size_t target_level, bool hierarchical=false){
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        auto surrogate_dims = get_surrogate_dims(dims);
+        size_t surrogate_level = min(target_level, get_max_level(surrogate_dims));
+        return extrapolate(operator_norm.get_discrete_level_weights(surrogate_dims, surrogate_level, hierarchical), target_level);
+    }
+    // number of values of the surrogate grid
+    size_t surrogate_elements = 1 << 18;
+
+private:
+    ThreadPool * pool = NULL;
+    OperatorNorm<T> operator_norm;
+    Recomposer<T> recomposer;
+    vector<T> surrogate_buffer;
+
+    static double tail_factor(size_t n){
+        return (n > 1) ? sqrt(2 * log((double) n)) : 1;
+    }
+    vector<size_t> get_surrogate_dims(const vector<size_t>& dims){
+        // at most surrogate_elements^(1/d) + 1 values per dimension (65 in 3D)
+        size_t max_size = (size_t) round(pow((double) surrogate_elements, 1.0 / dims.size())) + 1;
+        vector<size_t> surrogate_dims(dims);
+        for(auto& d:surrogate_dims){
+            d = min(d, max_size);
+        }
+        return surrogate_dims;
+    }
+    // map weights of the surrogate levels to the target levels: the finest levels
+    // correspond one to one, coarser levels grow by the ratio of the two coarsest
+    // surrogate detail levels (about sqrt(2^d) for d coarsened dimensions)
+    static vector<double> extrapolate(const vector<double>& surrogate, size_t target_level){
+        size_t surrogate_level = surrogate.size() - 1;
+        vector<double> weights(target_level + 1);
+        size_t offset = target_level - surrogate_level;
+        for(size_t l=1; l<=surrogate_level; l++){
+            weights[l + offset] = surrogate[l];
+        }
+        if(offset == 0){
+            weights[0] = surrogate[0];
+            return weights;
+        }
+        double ratio = (surrogate_level >= 2) ? surrogate[1] / surrogate[2] : 1;
+        for(int l=offset; l>=1; l--){
+            weights[l] = weights[l + 1] * ratio;
+        }
+        weights[0] = surrogate[0] * pow(ratio, (double) offset);
+        return weights;
+    }
+    static int get_level(const vector<vector<int>>& level_index, const vector<size_t>& dims, size_t index){
+        int level = 0;
+        for(int k=dims.size()-1; k>=0; k--){
+            level = max(level, level_index[k][index % dims[k]]);
+            index /= dims[k];
+        }
+        return level;
+    }
+    // ratio of the measured to the estimated Linf error on the surrogate grid, with
+    // errors uniformly distributed at the mean squared error of each target level
+    double calibration_factor(const vector<size_t>& dims, size_t target_level, const LevelErrors& errors, bool hierarchical){
+        auto surrogate_dims = get_surrogate_dims(dims);
+        size_t surrogate_level = min(target_level, get_max_level(surrogate_dims));
+        size_t offset = target_level - surrogate_level;
+        auto level_dims = init_levels(surrogate_dims, surrogate_level);
+        auto level_index = init_level_index(surrogate_dims, level_dims);
+        size_t n = 1;
+        for(const auto& d:surrogate_dims){
+            n *= d;
+        }
+        // the coarsest surrogate level stands for all coarser target levels
+        vector<double> amplitude(surrogate_level + 1, 0);
+        for(size_t l=0; l<=target_level; l++){
+            double ms = errors.count[l] ? errors.sum_squares[l] / errors.count[l] : 0;
+            size_t sl = (l > offset) ? l - offset : 0;
+            amplitude[sl] = max(amplitude[sl], sqrt(3 * ms));
+        }
+        surrogate_buffer.resize(n);
+        vector<size_t> count(surrogate_level + 1, 0);
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for(size_t i=0; i<n; i++){
+            int l = get_level(level_index, surrogate_dims, i);
+            state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+            // uniform in [-1, 1)
+            double u = (double) (state >> 11) / (double) (1ULL << 52) - 1;
+            surrogate_buffer[i] = amplitude[l] * u;
+            count[l] ++;
+        }
+        auto weights = operator_norm.get_discrete_level_weights(surrogate_dims, surrogate_level, hierarchical);
+        double sum = 0;
+        for(size_t l=0; l<=surrogate_level; l++){
+            sum += weights[l] * weights[l] * count[l] * amplitude[l] * amplitude[l] / 3;
+        }
+        double estimated = sqrt(sum / n) * tail_factor(n);
+        recomposer.recompose(surrogate_buffer.data(), surrogate_dims, surrogate_level, hierarchical);
+        double measured = 0;
+        for(const auto& x:surrogate_buffer){
+            measured = max(measured, (double) fabs(x));
+        }
+        return (estimated > 0) ? measured / estimated : 1;
+    }
+};
+
+}
+#endif
@@ -0,0 +1,205 @@
+#ifndef _MGARD_INCREMENTAL_HPP
+#define _MGARD_INCREMENTAL_HPP
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "utils.hpp"
+#include "decompose.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+/*
+    update of a decomposition after a change inside a bounding box
+    the decomposition is linear, so the coefficients of the new data are the old ones
+    plus the decomposition of the change delta; each level of the latter is computed on
+    a window of the level grid around the nodal values changed by the finer levels:
+    - the interpolant difference and load vector only reach the neighbors of a value
+    - the correction decays away from a nonzero load (see partitioned_spike_length),
+      so the lines through the change are solved on the window only, with halo
+      entries on each side for the decay to reach the precision of T
+    windows are aligned to the nodal values of the level (or end at the domain
+    boundary), so that their coarse grid is a part of the global one; the window of a
+    level grows by the halo around the shrinking support of the change, and the cost of
+    an update is about sum_l (box / 2^l + 2 halo)^d values instead of the whole domain
+    the result matches a full decomposition of the new data up to rounding
+    decompositions with a Lorenzo stage on the coarsest nodal grid are not supported
+*/
+template <class T>
+class IncrementalDecomposer{
+public:
+    void set_thread_pool(ThreadPool * pool_){
+        decomposer.set_thread_pool(pool_);
+    }
+    // must match the solver of the decomposition being updated
+    void set_solver_mode(SolverMode mode){
+        decomposer.set_solver_mode(mode);
+    }
+    // add the decomposition of delta (dense, box_dims values at origin) to coeff,
+    // a dense decomposition of dims with target_level levels
+    void update(T * coeff, const vector<size_t>& dims, size_t target_level, const vector<size_t>& origin, const vector<size_t>& box_dims, const T * delta, bool hierarchical=false){
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        auto level_dims = init_levels(dims, target_level);
+        auto strides = init_strides(dims);
+        int num_dims = dims.size();
+        // support of the change on the current level grid, and its values
+        vector<size_t> lo(origin), hi(num_dims);
+        for(int k=0; k<num_dims; k++){
+            hi[k] = origin[k] + box_dims[k] - 1;
+        }
+        vector<T> values(delta, delta + num_elements(box_dims));
+        size_t halo = hierarchical ? 2 : get_halo();
+        for(size_t l=target_level; l>0; l--){
+            const vector<size_t>& n = level_dims[l];
+            const vector<size_t>& next = level_dims[l - 1];
+            vector<size_t> start(num_dims), window(num_dims);
+            vector<bool> active(num_dims);
+            for(int k=0; k<num_dims; k++){
+                active[k] = (n[k] != next[k]);
+                size_t s = lo[k], e = hi[k];
+                if(active[k]){
+                    s = (s > halo) ? (s - halo) & ~(size_t) 1 : 0;
+                    e = e + halo;
+                    // the halo (>= 2) keeps at least one coefficient in the window
+                    e = (e + 1 >= n[k]) ? n[k] - 1 : e + (e & 1);
+                }
+                start[k] = s;
+                window[k] = e - s + 1;
+            }
+            // the change padded to the window, decomposed by one level
+            vector<T> w(num_elements(window), 0);
+            copy_box(values.data(), lo, hi, w.data(), start, window);
+            decompose_window(w.data(), window, active, hierarchical);
+            // coefficients go to their positions in the level box, nodal values to the next level
+            vector<size_t> next_lo(num_dims), next_hi(num_dims), nodal_window(num_dims);
+            for(int k=0; k<num_dims; k++){
+                nodal_window[k] = active[k] ? (window[k] >> 1) + 1 : window[k];
+                next_lo[k] = active[k] ? start[k] / 2 : start[k];
+                next_hi[k] = next_lo[k] + nodal_window[k] - 1;
+            }
+            vector<T> next_values(num_elements(nodal_window));
+            for_each_index(window, [&](const vector<size_t>& a, size_t p){
+                size_t global = 0, nodal = 0;
+                bool is_nodal = true;
+                for(int k=0; k<num_dims; k++){
+                    size_t pos = start[k] + a[k];
+                    if(active[k]){
+                        if(a[k] < nodal_window[k]){
+                            pos = next_lo[k] + a[k];
+                        }
+                        else{
+                            pos = next[k] + start[k] / 2 + a[k] - nodal_window[k];
+                            is_nodal = false;
+                        }
+                    }
+                    global += pos * strides[k];
+                    nodal = nodal * nodal_window[k] + min(a[k], nodal_window[k] - 1);
+                }
+                if(is_nodal) next_values[nodal] = w[p];
+                else coeff[global] += w[p];
+            });
+            lo = next_lo, hi = next_hi;
+            values.swap(next_values);
+        }
+        // coarsest nodal values
+        vector<size_t> box(num_dims);
+        for(int k=0; k<num_dims; k++){
+            box[k] = hi[k] - lo[k] + 1;
+        }
+        for_each_index(box, [&](const vector<size_t>& a, size_t p){
+            size_t global = 0;
+            for(int k=0; k<num_dims; k++){
+                global += (lo[k] + a[k]) * strides[k];
+            }
+            coeff[global] += values[p];
+        });
+    }
+    // same as above with the change given as new_data - old_data (dense, dims) in the box
+    void update(T * coeff, const vector<size_t>& dims, size_t target_level, const T * old_data, const T * new_data, const vector<size_t>& origin, const vector<size_t>& box_dims, bool hierarchical=false){
+        auto strides = init_strides(dims);
+        vector<T> delta(num_elements(box_dims));
+        for_each_index(box_dims, [&](const vector<size_t>& a, size_t p){
+            size_t global = 0;
+            for(int k=0; k<dims.size(); k++){
+                global += (origin[k] + a[k]) * strides[k];
+            }
+            delta[p] = new_data[global] - old_data[global];
+        });
+        update(coeff, dims, target_level, origin, box_dims, delta.data(), hierarchical);
+    }
+
+private:
+    Decomposer<T> decomposer;
+
+    // values of the level grid for the decay (2 - sqrt(3))^k over k nodal values
+    // (every second value) to fall below the precision of T, plus the reach of the
+    // interpolant and load vector
+    static size_t get_halo(){
+        return 2 * (size_t) ceil(log(numeric_limits<T>::epsilon()) / log(2 - sqrt(3.0))) + 2;
+    }
+    static size_t num_elements(const vector<size_t>& dims){
+        size_t n = 1;
+        for(const auto& d:dims){
+            n *= d;
+        }
+        return n;
+    }
+    // run func(index, position) over a dense row-major box
+    template <class Func>
+    static void for_each_index(const vector<size_t>& dims, const Func& func){
+        size_t n = num_elements(dims);
+        vector<size_t> a(dims.size(), 0);
+        for(size_t p=0; p<n; p++){
+            func(a, p);
+            for(int k=dims.size()-1; k>=0; k--){
+                if(++ a[k] < dims[k]) break;
+                a[k] = 0;
+            }
+        }
+    }
+    // copy the box [lo, hi] of src (dense over that box) into dst (dense, dst_dims at dst_start)
+    static void copy_box(const T * src, const vector<size_t>& lo, const vector<size_t>& hi, T * dst, const vector<size_t>& dst_start, const vector<size_t>& dst_dims){
+        vector<size_t> box(lo.size());
+        for(int k=0; k<lo.size(); k++){
+            box[k] = hi[k] - lo[k] + 1;
+        }
+        auto dst_strides = init_strides(dst_dims);
+        for_each_index(box, [&](const vector<size_t>& a, size_t p){
+            size_t q = 0;
+            for(int k=0; k<lo.size(); k++){
+                q += (lo[k] - dst_start[k] + a[k]) * dst_strides[k];
+            }
+            dst[q] = src[p];
+        });
+    }
+    // decompose one level of the active dimensions of the dense window, for every
+    // index of the inactive ones
+    void decompose_window(T * w, const vector<size_t>& window, const vector<bool>& active, bool hierarchical){
+        auto window_strides = init_strides(window);
+        vector<size_t> sub_dims, sub_strides, outer_dims, outer_strides;
+        for(int k=0; k<window.size(); k++){
+            if(active[k]){
+                sub_dims.push_back(window[k]);
+                sub_strides.push_back(window_strides[k]);
+            }
+            else{
+                outer_dims.push_back(window[k]);
+                outer_strides.push_back(window_strides[k]);
+            }
+        }
+        for_each_index(outer_dims, [&](const vector<size_t>& a, size_t p){
+            size_t offset = 0;
+            for(int k=0; k<a.size(); k++){
+                offset += a[k] * outer_strides[k];
+            }
+            decomposer.decompose(w + offset, sub_dims, 1, hierarchical, sub_strides);
+        });
+    }
+};
+
+}
+#endif
@@ -0,0 +1,224 @@
+#ifndef _MGARD_INTEGER_LIFTING_HPP
+#define _MGARD_INTEGER_LIFTING_HPP
+
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include "reorder.hpp"
+#include "utils.hpp"
+#include "memory.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+/*
+    reversible integer-to-integer variant of the hierarchical basis decomposition,
+    for int8/int16/int32/int64 (signed or unsigned) fields that need lossless compression
+    each coefficient is u - floor((u_left + u_right) / 2) of its two nodal neighbors,
+    applied one active dimension at a time on every level (the tensor-product form of
+    the multilinear interpolant), and recomposition adds the same integer prediction,
+    so the round trip is exact
+    the prediction never overflows and the differences wrap modulo 2^bits, so the
+    coefficients keep the width of T and wrapped values are still recovered exactly
+    layout: as in Decomposer, except that for an even number of values the last one is
+    stored itself as the last nodal value instead of the extrapolated virtual node
+    (2u - u_left may not be representable, and halving it back is not exact)
+*/
+
+// floor((a + b) / 2) without overflow
+template <class T>
+inline T floor_average(T a, T b){
+    return (T) ((a & b) + ((a ^ b) >> 1));
+}
+// a - b and a + b modulo 2^bits
+template <class T>
+inline T wrap_subtract(T a, T b){
+    typedef typename make_unsigned<T>::type U;
+    return (T) (U) ((U) a - (U) b);
+}
+template <class T>
+inline T wrap_add(T a, T b){
+    typedef typename make_unsigned<T>::type U;
+    return (T) (U) ((U) a + (U) b);
+}
+
+// coeff[i] -= floor_average(left[i], right[i]) (or += with forward=false) for i < n
+// contiguous and branch-free, so that it compiles to integer SIMD
+template <class T>
+inline void lift_predict(const T * left, const T * right, T * coeff, size_t n, bool forward){
+    if(forward){
+        for(size_t i=0; i<n; i++){
+            coeff[i] = wrap_subtract(coeff[i], floor_average(left[i], right[i]));
+        }
+    }
+    else{
+        for(size_t i=0; i<n; i++){
+            coeff[i] = wrap_add(coeff[i], floor_average(left[i], right[i]));
+        }
+    }
+}
+
+// lifting of n contiguous values, with buffer of n elements
+template <class T>
+void lift_row(T * data_pos, size_t n, T * buffer, bool forward){
+    size_t n_nodal = (n >> 1) + 1;
+    size_t n_coeff = n - n_nodal;
+    T * nodal = buffer;
+    T * coeff = buffer + n_nodal;
+    if(forward){
+        deinterleave(data_pos, n_coeff, nodal, coeff);
+        // the last one (odd n) or two (even n) values are nodal
+        for(size_t i=2*n_coeff; i<n; i++){
+            nodal[i - n_coeff] = data_pos[i];
+        }
+        lift_predict(nodal, nodal + 1, coeff, n_coeff, true);
+        memcpy(data_pos, buffer, n * sizeof(T));
+    }
+    else{
+        memcpy(buffer, data_pos, n * sizeof(T));
+        lift_predict(nodal, nodal + 1, coeff, n_coeff, false);
+        interleave(nodal, coeff, n_coeff, data_pos);
+        for(size_t i=2*n_coeff; i<n; i++){
+            data_pos[i] = nodal[i - n_coeff];
+        }
+    }
+}
+
+// lifting along a non-contiguous dimension: n rows of length values, stride apart,
+// with buffer of n x length elements
+// the prediction runs over whole rows and the rows are then moved as in the 2D reorder
+template <class T>
+void lift_rows(T * data_pos, size_t n, size_t length, size_t stride, T * buffer, bool forward){
+    size_t n_nodal = (n >> 1) + 1;
+    size_t n_coeff = n - n_nodal;
+    if(!forward) switch_rows_2D_by_buffer_reverse(data_pos, buffer, n, length, stride);
+    for(size_t i=0; i<n_coeff; i++){
+        T * row = data_pos + (2 * i + 1) * stride;
+        lift_predict(row - stride, row + stride, row, length, forward);
+    }
+    // for even n the last row is a nodal row, as expected by switch_rows_2D_by_buffer
+    if(forward) switch_rows_2D_by_buffer(data_pos, buffer, n, length, stride);
+}
+
+/*
+    shared level loop of IntegerDecomposer and IntegerRecomposer
+    dims of up to 3 dimensions are padded to 3D with leading 1s; the dimensions of a
+    level are lifted in the order 2, 1, 0 and restored in the order 0, 1, 2
+*/
+template <class T>
+class IntegerLifting{
+public:
+    static_assert(is_integral<T>::value, "integer lifting needs an integral type");
+    ~IntegerLifting(){
+        if(buffer) free(buffer);
+    }
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+    }
+    // placement of the scratch buffer allocated from now on, see MemoryPolicy
+    void set_memory_policy(const MemoryPolicy& policy){
+        memory_policy = policy;
+    }
+
+protected:
+    ThreadPool * pool = NULL;
+    MemoryPolicy memory_policy;
+    T * buffer = NULL;              // num_threads + 1 scratch areas of buffer_size
+    size_t buffer_size = 0;         // number of elements per thread
+    size_t buffer_capacity = 0;
+
+    // apply (forward) or undo all levels of data, dense row-major; returns the number of levels
+    int run(T * data, const vector<size_t>& dims, size_t target_level, bool forward){
+        if((dims.size() == 0) || (dims.size() > 3)){
+            cerr << "integer lifting supports 1 to 3 dimensions\n";
+            return 0;
+        }
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        auto level_dims = init_levels(dims, target_level);
+        vector<size_t> padded_dims(3 - dims.size(), 1);
+        padded_dims.insert(padded_dims.end(), dims.begin(), dims.end());
+        auto strides = init_strides(padded_dims);
+        init(padded_dims);
+        for(size_t i=0; i<target_level; i++){
+            // level l is lifted from l into l - 1, finest first
+            size_t l = forward ? target_level - i : i + 1;
+            vector<size_t> n(3 - dims.size(), 1), next(3 - dims.size(), 1);
+            n.insert(n.end(), level_dims[l].begin(), level_dims[l].end());
+            next.insert(next.end(), level_dims[l - 1].begin(), level_dims[l - 1].end());
+            if(forward){
+                for(int d=2; d>=0; d--){
+                    if(n[d] != next[d]) lift_dimension(data, n, strides, d, true);
+                }
+            }
+            else{
+                for(int d=0; d<3; d++){
+                    if(n[d] != next[d]) lift_dimension(data, n, strides, d, false);
+                }
+            }
+        }
+        return target_level;
+    }
+
+private:
+    void init(const vector<size_t>& dims){
+        // a dimension is lifted by rows of the innermost one, so the largest
+        // scratch is the plane of that dimension and the innermost one
+        buffer_size = dims[2] * max(dims[0], dims[1]);
+        size_t num_slots = pool ? pool->num_threads() + 1 : 1;
+        if(num_slots * buffer_size > buffer_capacity){
+            if(buffer) free(buffer);
+            buffer_capacity = num_slots * buffer_size;
+            buffer = (T *) workspace_malloc(buffer_capacity * sizeof(T), memory_policy, pool, buffer_size * sizeof(T));
+        }
+    }
+    T * get_thread_buffer(){
+        return pool ? buffer + pool->thread_index() * buffer_size : buffer;
+    }
+    // lift dimension d of the n[0] x n[1] x n[2] box at the start of data
+    void lift_dimension(T * data, const vector<size_t>& n, const vector<size_t>& strides, int d, bool forward){
+        // lines are independent: parallel over the first dimension that is not d
+        size_t outer = (d == 0) ? n[1] : n[0];
+        auto line = [&](size_t o){
+            T * thread_buffer = get_thread_buffer();
+            if(d == 2){
+                T * row = data + o * strides[0];
+                for(size_t j=0; j<n[1]; j++){
+                    lift_row(row + j * strides[1], n[2], thread_buffer, forward);
+                }
+            }
+            else if(d == 1){
+                lift_rows(data + o * strides[0], n[1], n[2], strides[1], thread_buffer, forward);
+            }
+            else{
+                lift_rows(data + o * strides[1], n[0], n[2], strides[0], thread_buffer, forward);
+            }
+        };
+        if(pool) pool->parallel_for(0, outer, line);
+        else for(size_t o=0; o<outer; o++) line(o);
+    }
+};
+
+template <class T>
+class IntegerDecomposer : public IntegerLifting<T>{
+public:
+    // decompose data (dense row-major) in place and return the number of levels
+    int decompose(T * data, const vector<size_t>& dims, size_t target_level){
+        return this->run(data, dims, target_level, true);
+    }
+};
+
+template <class T>
+class IntegerRecomposer : public IntegerLifting<T>{
+public:
+    // recompose the output of IntegerDecomposer in place, bit-exact
+    void recompose(T * data, const vector<size_t>& dims, size_t target_level){
+        this->run(data, dims, target_level, false);
+    }
+};
+
+}
+#endif
@@ -0,0 +1,111 @@
+#ifndef _MGARD_LORENZO_HPP
+#define _MGARD_LORENZO_HPP
+
+#include <vector>
+#include <cmath>
+
+namespace MGARD{
+
+using namespace std;
+
+// error-bounded Lorenzo prediction codes of a grid, as in SZ
+// each value is predicted from its already reconstructed neighbors and the
+// prediction error is quantized with bin width 2 eb; codes[i] = q + radius for
+// |q| < radius, and 0 for values stored as is in unpredictable
+template <class T>
+struct LorenzoCodes{
+    T eb = 0;
+    int radius = 32768;
+    vector<int> codes;
+    vector<T> unpredictable;
+    void clear(){
+        codes.clear();
+        unpredictable.clear();
+    }
+    // whether the prediction stage runs, see Decomposer::set_nodal_error_bound
+    bool enabled() const{
+        return eb > 0;
+    }
+};
+
+// pad to 3 dimensions with leading dimensions of size 1 (and stride 0)
+inline void lorenzo_pad(const vector<size_t>& dims, const vector<size_t>& strides, size_t * n, size_t * s){
+    n[0] = n[1] = n[2] = 1;
+    s[0] = s[1] = s[2] = 0;
+    int offset = 3 - dims.size();
+    for(int i=0; i<dims.size(); i++){
+        n[offset + i] = dims[i];
+        s[offset + i] = strides[i];
+    }
+}
+
+// 1D to 3D Lorenzo prediction from reconstructed values, neighbors outside are 0
+template <class T>
+inline T lorenzo_predict(const T * x, size_t i, size_t j, size_t k, const size_t * s){
+    T a = (k > 0) ? x[- s[2]] : 0;
+    T b = (j > 0) ? x[- s[1]] : 0;
+    T c = (i > 0) ? x[- s[0]] : 0;
+    T ab = ((j > 0) && (k > 0)) ? x[- s[1] - s[2]] : 0;
+    T ac = ((i > 0) && (k > 0)) ? x[- s[0] - s[2]] : 0;
+    T bc = ((i > 0) && (j > 0)) ? x[- s[0] - s[1]] : 0;
+    T abc = ((i > 0) && (j > 0) && (k > 0)) ? x[- s[0] - s[1] - s[2]] : 0;
+    return a + b + c - ab - ac - bc + abc;
+}
+
+// quantize data in place: every value is replaced by its reconstruction (error <= eb)
+/*
+@params data: first value of the grid
+@params dims, strides: dimensions and strides of the grid
+@params codes: output codes, appended; codes.eb and codes.radius are used
+*/
+template <class T>
+void lorenzo_quantize(T * data, const vector<size_t>& dims, const vector<size_t>& strides, LorenzoCodes<T>& codes){
+    size_t n[3], s[3];
+    lorenzo_pad(dims, strides, n, s);
+    T eb = codes.eb;
+    int radius = codes.radius;
+    for(size_t i=0; i<n[0]; i++){
+        for(size_t j=0; j<n[1]; j++){
+            T * x = data + i * s[0] + j * s[1];
+            for(size_t k=0; k<n[2]; k++){
+                T pred = lorenzo_predict(x, i, j, k, s);
+                double q = round((x[0] - pred) / (2 * eb));
+                T recon = pred + 2 * eb * (T) q;
+                if((fabs(q) < radius) && (fabs(x[0] - recon) <= eb)){
+                    codes.codes.push_back((int) q + radius);
+                    x[0] = recon;
+                }
+                else{
+                    codes.codes.push_back(0);
+                    codes.unpredictable.push_back(x[0]);
+                }
+                x += s[2];
+            }
+        }
+    }
+}
+
+// reconstruct the grid from its codes, inverse of lorenzo_quantize
+template <class T>
+void lorenzo_dequantize(T * data, const vector<size_t>& dims, const vector<size_t>& strides, const LorenzoCodes<T>& codes){
+    size_t n[3], s[3];
+    lorenzo_pad(dims, strides, n, s);
+    T eb = codes.eb;
+    int radius = codes.radius;
+    const int * code = codes.codes.data();
+    const T * unpredictable = codes.unpredictable.data();
+    for(size_t i=0; i<n[0]; i++){
+        for(size_t j=0; j<n[1]; j++){
+            T * x = data + i * s[0] + j * s[1];
+            for(size_t k=0; k<n[2]; k++){
+                if(*code) x[0] = lorenzo_predict(x, i, j, k, s) + 2 * eb * (T) (*code - radius);
+                else x[0] = *(unpredictable ++);
+                code ++;
+                x += s[2];
+            }
+        }
+    }
+}
+
+}
+#endif
@@ -0,0 +1,115 @@
+#ifndef _MGARD_MEMORY_HPP
+#define _MGARD_MEMORY_HPP
+
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include "thread_pool.hpp"
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace MGARD{
+
+using namespace std;
+
+// placement of the workspaces of Decomposer and Recomposer
+// the default is plain malloc; the options only apply to workspaces of at least
+// huge_page_size bytes, which are aligned to huge pages
+struct MemoryPolicy{
+    // back the workspace by 2 MB transparent huge pages (madvise)
+    bool huge_pages = false;
+    // interleave the pages over all NUMA nodes, for workspaces shared by all threads
+    bool interleave = false;
+    // touch the pages on the workers of the pool, each its own part (see workspace_malloc),
+    // so that each page lands on the node of the thread that uses it
+    bool first_touch = false;
+};
+
+const size_t huge_page_size = 2 << 20;
+
+// bit mask of the online NUMA nodes, from /sys/devices/system/node/online (e.g. "0-1")
+inline unsigned long get_numa_node_mask(){
+    unsigned long mask = 0;
+    ifstream fin("/sys/devices/system/node/online");
+    string ranges;
+    if(!(fin >> ranges)) return 1;
+    size_t pos = 0;
+    while(pos < ranges.size()){
+        size_t end = ranges.find(',', pos);
+        if(end == string::npos) end = ranges.size();
+        string range = ranges.substr(pos, end - pos);
+        size_t dash = range.find('-');
+        int first = atoi(range.c_str());
+        int last = (dash == string::npos) ? first : atoi(range.c_str() + dash + 1);
+        for(int node=first; (node<=last) && (node<64); node++){
+            mask |= 1UL << node;
+        }
+        pos = end + 1;
+    }
+    return mask ? mask : 1;
+}
+
+// allocate a workspace of size bytes following policy; release it with free
+// with first_touch, worker i of pool (if not NULL) touches part i:
+// - slot_size == 0: the workspace is shared and split into pool->num_threads()
+//   contiguous ranges of whole huge pages
+// - slot_size > 0: the workspace holds one slot of slot_size bytes per thread index
+//   (e.g. get_thread_data_buffer); slot i is part i
+// the caller touches the rest: its own slot after those of the workers, and the
+// rounding up to whole huge pages
+inline void * workspace_malloc(size_t size, const MemoryPolicy& policy, ThreadPool * pool=NULL, size_t slot_size=0){
+    if((size < huge_page_size) || !(policy.huge_pages || policy.interleave || policy.first_touch)) return malloc(size);
+    void * ptr = NULL;
+    // round up to whole huge pages, so that the last one can be backed as well
+    size_t length = (size + huge_page_size - 1) / huge_page_size * huge_page_size;
+    if(posix_memalign(&ptr, huge_page_size, length)) return NULL;
+#ifdef __linux__
+#ifdef MADV_HUGEPAGE
+    if(policy.huge_pages) madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+#ifdef SYS_mbind
+    if(policy.interleave){
+        // MPOL_INTERLEAVE of <numaif.h>, without linking libnuma
+        const int mpol_interleave = 3;
+        unsigned long mask = get_numa_node_mask();
+        syscall(SYS_mbind, ptr, length, mpol_interleave, &mask, sizeof(mask) * 8, 0);
+    }
+#endif
+#endif
+    if(policy.first_touch){
+        char * bytes = (char *) ptr;
+        int num_parts = pool ? pool->num_threads() : 1;
+        // byte range [begin, end) of part i
+        auto part = [&](int i, size_t& begin, size_t& end){
+            if(slot_size){
+                begin = min(i * slot_size, length);
+                end = min((i + 1) * slot_size, length);
+            }
+            else{
+                size_t num_pages = length / huge_page_size;
+                begin = num_pages * i / num_parts * huge_page_size;
+                end = num_pages * (i + 1) / num_parts * huge_page_size;
+            }
+        };
+        auto touch = [&](int i){
+            size_t begin = 0, end = 0;
+            part(i, begin, end);
+            if(end > begin) memset(bytes + begin, 0, end - begin);
+        };
+        if(pool) pool->run_on_workers(touch);
+        else touch(0);
+        // the caller's slot and the rounding up to whole pages
+        size_t end = 0, rest = 0;
+        part(num_parts - 1, rest, end);
+        if(length > end) memset(bytes + end, 0, length - end);
+    }
+    return ptr;
+}
+
+}
+#endif
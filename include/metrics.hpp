@@ -0,0 +1,286 @@
+#ifndef _MGARD_METRICS_HPP
+#define _MGARD_METRICS_HPP
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <iostream>
+#include <algorithm>
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// quality of decompressed data against the original
+struct Metrics{
+    size_t num_elements = 0;
+    double min_value = 0;
+    double max_value = 0;
+    double value_range = 0;
+    double max_abs_value = 0;
+    double max_error = 0;
+    size_t max_error_pos = 0;
+    double mean_error = 0;      // mean of original - decompressed
+    double mse = 0;
+    double rmse = 0;
+    double nrmse = 0;           // rmse / value_range
+    double psnr = 0;
+};
+
+// sum with error compensation (Neumaier), exact up to the final rounding for
+// the partial sums of a few thousand chunks
+class CompensatedSum{
+public:
+    void add(double x){
+        double t = sum + x;
+        if(fabs(sum) >= fabs(x)) compensation += (sum - t) + x;
+        else compensation += (x - t) + sum;
+        sum = t;
+    }
+    double result() const{
+        return sum + compensation;
+    }
+private:
+    double sum = 0;
+    double compensation = 0;
+};
+
+// partial results of one chunk of compute_metrics
+struct MetricsPartial{
+    double min_value, max_value, max_abs_value;
+    double max_error;
+    double error_sum, squared_error_sum;
+};
+
+// one chunk in independent lanes, which the compiler maps to SIMD registers
+// squared errors are accumulated with Kahan summation per lane; the position of the
+// maximal error is not tracked here, see find_max_error_pos
+template <class T>
+MetricsPartial compute_metrics_chunk(const T * data_ori, const T * data_dec, size_t begin, size_t end){
+    const int lanes = 8;
+    double min_v[lanes], max_v[lanes], max_a[lanes], max_e[lanes];
+    double e_sum[lanes], e2_sum[lanes], e2_comp[lanes];
+    for(int j=0; j<lanes; j++){
+        min_v[j] = numeric_limits<double>::max();
+        max_v[j] = - numeric_limits<double>::max();
+        max_a[j] = 0, max_e[j] = 0;
+        e_sum[j] = 0, e2_sum[j] = 0, e2_comp[j] = 0;
+    }
+    size_t i = begin;
+    for(; i + lanes <= end; i += lanes){
+        for(int j=0; j<lanes; j++){
+            double x = data_ori[i + j];
+            double err = x - (double) data_dec[i + j];
+            min_v[j] = min(min_v[j], x);
+            max_v[j] = max(max_v[j], x);
+            max_a[j] = max(max_a[j], fabs(x));
+            max_e[j] = max(max_e[j], fabs(err));
+            e_sum[j] += err;
+            double y = err * err - e2_comp[j];
+            double t = e2_sum[j] + y;
+            e2_comp[j] = (t - e2_sum[j]) - y;
+            e2_sum[j] = t;
+        }
+    }
+    // remainder in lane 0
+    for(; i<end; i++){
+        double x = data_ori[i];
+        double err = x - (double) data_dec[i];
+        min_v[0] = min(min_v[0], x);
+        max_v[0] = max(max_v[0], x);
+        max_a[0] = max(max_a[0], fabs(x));
+        max_e[0] = max(max_e[0], fabs(err));
+        e_sum[0] += err;
+        double y = err * err - e2_comp[0];
+        double t = e2_sum[0] + y;
+        e2_comp[0] = (t - e2_sum[0]) - y;
+        e2_sum[0] = t;
+    }
+    MetricsPartial partial;
+    partial.min_value = min_v[0], partial.max_value = max_v[0];
+    partial.max_abs_value = max_a[0], partial.max_error = max_e[0];
+    CompensatedSum error_sum, squared_error_sum;
+    for(int j=0; j<lanes; j++){
+        partial.min_value = min(partial.min_value, min_v[j]);
+        partial.max_value = max(partial.max_value, max_v[j]);
+        partial.max_abs_value = max(partial.max_abs_value, max_a[j]);
+        partial.max_error = max(partial.max_error, max_e[j]);
+        error_sum.add(e_sum[j]);
+        squared_error_sum.add(e2_sum[j]);
+        squared_error_sum.add(- e2_comp[j]);
+    }
+    partial.error_sum = error_sum.result();
+    partial.squared_error_sum = squared_error_sum.result();
+    return partial;
+}
+
+// first position in [begin, end) with the given absolute error
+template <class T>
+size_t find_max_error_pos(const T * data_ori, const T * data_dec, size_t begin, size_t end, double max_error){
+    for(size_t i=begin; i<end; i++){
+        if(fabs((double) data_ori[i] - (double) data_dec[i]) == max_error) return i;
+    }
+    return begin;
+}
+
+// compute value range, errors, MSE and PSNR in a single pass over both arrays
+// (plus a rescan of the one chunk that holds the maximal error, to locate it)
+/*
+@params data_ori: original data
+@params data_dec: decompressed data
+@params num_elements: number of values
+@params pool: parallelize over chunks if not NULL
+*/
+template <class T>
+Metrics compute_metrics(const T * data_ori, const T * data_dec, size_t num_elements, ThreadPool * pool=NULL){
+    Metrics metrics;
+    metrics.num_elements = num_elements;
+    if(num_elements == 0) return metrics;
+    const size_t chunk_size = 1 << 16;
+    size_t num_chunks = (num_elements + chunk_size - 1) / chunk_size;
+    vector<MetricsPartial> partials(num_chunks);
+    auto chunk = [&](size_t c){
+        partials[c] = compute_metrics_chunk(data_ori, data_dec, c * chunk_size, min((c + 1) * chunk_size, num_elements));
+    };
+    if(pool) pool->parallel_for(0, num_chunks, chunk);
+    else for(size_t c=0; c<num_chunks; c++) chunk(c);
+    // reduce in chunk order for a deterministic result
+    metrics.min_value = partials[0].min_value;
+    metrics.max_value = partials[0].max_value;
+    metrics.max_error = -1;
+    size_t max_error_chunk = 0;
+    CompensatedSum error_sum, squared_error_sum;
+    for(size_t c=0; c<num_chunks; c++){
+        const MetricsPartial& p = partials[c];
+        metrics.min_value = min(metrics.min_value, p.min_value);
+        metrics.max_value = max(metrics.max_value, p.max_value);
+        metrics.max_abs_value = max(metrics.max_abs_value, p.max_abs_value);
+        if(p.max_error > metrics.max_error){
+            metrics.max_error = p.max_error;
+            max_error_chunk = c;
+        }
+        error_sum.add(p.error_sum);
+        squared_error_sum.add(p.squared_error_sum);
+    }
+    metrics.max_error_pos = find_max_error_pos(data_ori, data_dec, max_error_chunk * chunk_size, min((max_error_chunk + 1) * chunk_size, num_elements), metrics.max_error);
+    metrics.value_range = metrics.max_value - metrics.min_value;
+    metrics.mean_error = error_sum.result() / num_elements;
+    metrics.mse = squared_error_sum.result() / num_elements;
+    metrics.rmse = sqrt(metrics.mse);
+    metrics.nrmse = metrics.rmse / metrics.value_range;
+    metrics.psnr = 20 * log10(metrics.value_range / metrics.rmse);
+    return metrics;
+}
+
+// mean structural similarity over windows of window^d values placed every step values
+// along each dimension (d = 1 to 3), with the constants of Wang et al. for the value
+// range of the original data
+template <class T>
+double compute_ssim(const T * data_ori, const T * data_dec, const vector<size_t>& dims, size_t window=7, size_t step=2, ThreadPool * pool=NULL){
+    // pad to 3 dimensions with leading dimensions of size 1
+    size_t n[3] = {1, 1, 1}, w[3] = {1, 1, 1};
+    int offset = 3 - dims.size();
+    for(int k=0; k<dims.size(); k++){
+        n[offset + k] = dims[k];
+        w[offset + k] = min(window, dims[k]);
+    }
+    size_t num_elements = n[0] * n[1] * n[2];
+    double range = compute_metrics(data_ori, data_dec, num_elements, pool).value_range;
+    double c1 = (0.01 * range) * (0.01 * range);
+    double c2 = (0.03 * range) * (0.03 * range);
+    size_t num_windows[3];
+    for(int k=0; k<3; k++){
+        num_windows[k] = (n[k] - w[k]) / step + 1;
+    }
+    size_t window_size = w[0] * w[1] * w[2];
+    // one partial sum per window plane along the first dimension
+    vector<double> partial(num_windows[0], 0);
+    auto plane = [&](size_t a){
+        CompensatedSum sum;
+        for(size_t b=0; b<num_windows[1]; b++){
+            for(size_t c=0; c<num_windows[2]; c++){
+                double sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0;
+                for(size_t i=0; i<w[0]; i++){
+                    for(size_t j=0; j<w[1]; j++){
+                        size_t index = ((a * step + i) * n[1] + b * step + j) * n[2] + c * step;
+                        const T * x = data_ori + index;
+                        const T * y = data_dec + index;
+                        for(size_t k=0; k<w[2]; k++){
+                            sx += x[k], sy += y[k];
+                            sxx += (double) x[k] * x[k], syy += (double) y[k] * y[k];
+                            sxy += (double) x[k] * y[k];
+                        }
+                    }
+                }
+                double mx = sx / window_size, my = sy / window_size;
+                double vx = max(0.0, sxx / window_size - mx * mx);
+                double vy = max(0.0, syy / window_size - my * my);
+                double cxy = sxy / window_size - mx * my;
+                sum.add(((2 * mx * my + c1) * (2 * cxy + c2)) / ((mx * mx + my * my + c1) * (vx + vy + c2)));
+            }
+        }
+        partial[a] = sum.result();
+    };
+    if(pool) pool->parallel_for(0, num_windows[0], plane);
+    else for(size_t a=0; a<num_windows[0]; a++) plane(a);
+    CompensatedSum sum;
+    for(const auto& p:partial){
+        sum.add(p);
+    }
+    return sum.result() / (num_windows[0] * num_windows[1] * num_windows[2]);
+}
+
+// histogram of original - decompressed
+struct ErrorHistogram{
+    double min_error = 0;       // lower edge of the first bin
+    double max_error = 0;       // upper edge of the last bin
+    vector<size_t> counts;
+};
+
+// count errors in num_bins equal bins over [-range, range]
+// range = 0 uses the maximal absolute error (one extra pass)
+// num_bins = 0 returns an empty histogram
+template <class T>
+ErrorHistogram compute_error_histogram(const T * data_ori, const T * data_dec, size_t num_elements, size_t num_bins, double range=0, ThreadPool * pool=NULL){
+    if(num_bins == 0) return ErrorHistogram();
+    if(range <= 0){
+        range = compute_metrics(data_ori, data_dec, num_elements, pool).max_error;
+        if(range == 0) range = 1;
+    }
+    ErrorHistogram histogram;
+    histogram.min_error = - range;
+    histogram.max_error = range;
+    const size_t chunk_size = 1 << 16;
+    size_t num_chunks = (num_elements + chunk_size - 1) / chunk_size;
+    vector<size_t> partial(num_chunks * num_bins, 0);
+    double scale = num_bins / (2 * range);
+    auto chunk = [&](size_t c){
+        size_t * counts = partial.data() + c * num_bins;
+        size_t end = min((c + 1) * chunk_size, num_elements);
+        for(size_t i=c*chunk_size; i<end; i++){
+            double bin = ((double) data_ori[i] - (double) data_dec[i] + range) * scale;
+            // errors outside the range go to the outermost bins
+            size_t index = (bin <= 0) ? 0 : min((size_t) bin, num_bins - 1);
+            counts[index] ++;
+        }
+    };
+    if(pool) pool->parallel_for(0, num_chunks, chunk);
+    else for(size_t c=0; c<num_chunks; c++) chunk(c);
+    histogram.counts.resize(num_bins, 0);
+    for(size_t c=0; c<num_chunks; c++){
+        for(size_t b=0; b<num_bins; b++){
+            histogram.counts[b] += partial[c * num_bins + b];
+        }
+    }
+    return histogram;
+}
+
+inline void print_metrics(const Metrics& metrics){
+    cout << "Max value = " << metrics.max_value << ", min value = " << metrics.min_value << endl;
+    cout << "Max error = " << metrics.max_error << ", pos = " << metrics.max_error_pos << endl;
+    cout << "MSE = " << metrics.mse << ", PSNR = " << metrics.psnr << endl;
+}
+
+}
+#endif
@@ -2,6 +2,7 @@
 #define _MGARD_MISC_HPP
 
 #include <string>
+#include <cstring>
 
 namespace MGARD{
 
@@ -107,7 +108,7 @@ void data_copy_3D(T * dst, const T * src, size_t n1, size_t n2, size_t n3, size_
             y_src_pos += dim1_stride;
         }
         x_dst_pos += dim0_stride;
-        x_src_pos += dim1_stride;
+        x_src_pos += dim0_stride;
     }
 }
 
@@ -135,7 +136,7 @@ double dot_product_3D(const T * A, const T * B, size_t n1, size_t n2, size_t n3,
             y_B_pos += dim1_stride;
         }
         x_A_pos += dim0_stride;
-        x_B_pos += dim1_stride;
+        x_B_pos += dim0_stride;
     }
     return sum;
 }
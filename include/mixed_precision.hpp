@@ -0,0 +1,159 @@
+#ifndef _MGARD_MIXED_PRECISION_HPP
+#define _MGARD_MIXED_PRECISION_HPP
+
+#include <vector>
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "metrics.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// mean of data, accumulated per chunk in double and reduced with compensation
+template <class T>
+double compute_mean(const T * data, size_t num_elements, ThreadPool * pool=NULL){
+    if(num_elements == 0) return 0;
+    const size_t chunk_size = 1 << 16;
+    size_t num_chunks = (num_elements + chunk_size - 1) / chunk_size;
+    vector<double> partial(num_chunks, 0);
+    auto chunk = [&](size_t c){
+        CompensatedSum sum;
+        size_t end = min((c + 1) * chunk_size, num_elements);
+        for(size_t i=c*chunk_size; i<end; i++){
+            sum.add(data[i]);
+        }
+        partial[c] = sum.result();
+    };
+    if(pool) pool->parallel_for(0, num_chunks, chunk);
+    else for(size_t c=0; c<num_chunks; c++) chunk(c);
+    CompensatedSum sum;
+    for(const auto& p:partial){
+        sum.add(p);
+    }
+    return sum.result() / num_elements;
+}
+
+// decompose double data into float coefficients, which halves the memory traffic
+// of every level for fields whose error bound is far above float precision
+// the mean is removed in double before the conversion: interpolation and correction
+// reproduce constants exactly, so the offset only moves the coarsest nodal values and
+// is added back by MixedRecomposer, while float keeps 24 bits relative to the
+// fluctuation of the field instead of its magnitude
+// the mass-matrix solves carry their values in double (Decomposer<float, double>), so
+// that only the storage of the levels rounds to float; the added error over a double
+// decomposition is a few float ulps of max|data - mean| per level (see get_conversion_error)
+class MixedDecomposer{
+public:
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+        decomposer.set_thread_pool(pool_);
+    }
+    void set_solver_mode(SolverMode mode){
+        decomposer.set_solver_mode(mode);
+    }
+    // decompose data (dense row-major) into coeff and return the number of levels
+    int decompose(const double * data, const vector<size_t>& dims, size_t target_level, float * coeff, bool hierarchical=false){
+        size_t num_elements = 1;
+        for(const auto& d:dims){
+            num_elements *= d;
+        }
+        offset = compute_mean(data, num_elements, pool);
+        // convert per chunk, keeping the largest conversion error and value of each
+        const size_t chunk_size = 1 << 16;
+        size_t num_chunks = (num_elements + chunk_size - 1) / chunk_size;
+        vector<double> partial(num_chunks, 0);
+        vector<double> partial_max(num_chunks, 0);
+        auto chunk = [&](size_t c){
+            double max_err = 0;
+            double max_abs = 0;
+            size_t end = min((c + 1) * chunk_size, num_elements);
+            for(size_t i=c*chunk_size; i<end; i++){
+                double x = data[i] - offset;
+                coeff[i] = (float) x;
+                max_err = max(max_err, fabs(x - (double) coeff[i]));
+                max_abs = max(max_abs, fabs(x));
+            }
+            partial[c] = max_err;
+            partial_max[c] = max_abs;
+        };
+        if(pool) pool->parallel_for(0, num_chunks, chunk);
+        else for(size_t c=0; c<num_chunks; c++) chunk(c);
+        conversion_error = 0;
+        double max_abs = 0;
+        for(size_t c=0; c<num_chunks; c++){
+            conversion_error = max(conversion_error, partial[c]);
+            max_abs = max(max_abs, partial_max[c]);
+        }
+        int levels = decomposer.decompose(coeff, dims, target_level, hierarchical);
+        // every level rounds its interpolant, load vector and nodal update to float
+        // in each dimension; 4 float ulps of max|data - mean| per level and dimension
+        // cover the measured difference to a double decomposition with a margin of 2
+        decomposition_error = 4 * levels * dims.size() * (FLT_EPSILON / 2) * max_abs;
+        return levels;
+    }
+    // value removed before the conversion, to be passed to MixedRecomposer
+    double get_offset() const{
+        return offset;
+    }
+    // rounding error of the coefficients of the last decompose over a double
+    // decomposition: the largest rounding error of the float input plus the bound of
+    // the float arithmetic of the levels (get_decomposition_error)
+    double get_conversion_error() const{
+        return conversion_error + decomposition_error;
+    }
+    double get_decomposition_error() const{
+        return decomposition_error;
+    }
+    // error of MixedRecomposer over the data after the last decompose: an exact round
+    // trip restores the float input, so its rounding enters once, while the float
+    // arithmetic of the levels rounds in decompose and again in the recompose that
+    // mirrors it level by level
+    double get_round_trip_error() const{
+        return conversion_error + 2 * decomposition_error;
+    }
+
+private:
+    ThreadPool * pool = NULL;
+    Decomposer<float, double> decomposer;
+    double offset = 0;
+    double conversion_error = 0;
+    double decomposition_error = 0;
+};
+
+class MixedRecomposer{
+public:
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+        recomposer.set_thread_pool(pool_);
+    }
+    // recompose coeff in place and write coeff + offset to data (dense row-major)
+    void recompose(float * coeff, const vector<size_t>& dims, size_t target_level, double offset, double * data, bool hierarchical=false){
+        size_t num_elements = 1;
+        for(const auto& d:dims){
+            num_elements *= d;
+        }
+        recomposer.recompose(coeff, dims, target_level, hierarchical);
+        const size_t chunk_size = 1 << 16;
+        size_t num_chunks = (num_elements + chunk_size - 1) / chunk_size;
+        auto chunk = [&](size_t c){
+            size_t end = min((c + 1) * chunk_size, num_elements);
+            for(size_t i=c*chunk_size; i<end; i++){
+                data[i] = coeff[i] + offset;
+            }
+        };
+        if(pool) pool->parallel_for(0, num_chunks, chunk);
+        else for(size_t c=0; c<num_chunks; c++) chunk(c);
+    }
+
+private:
+    ThreadPool * pool = NULL;
+    Recomposer<float, double> recomposer;
+};
+
+}
+#endif
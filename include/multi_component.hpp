@@ -0,0 +1,138 @@
+#ifndef _MGARD_MULTI_COMPONENT_HPP
+#define _MGARD_MULTI_COMPONENT_HPP
+
+#include <vector>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "lorenzo.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// the C components of one grid point of an interleaved (array-of-structs) field,
+// e.g. Components<float, 3> for velocities stored as u, v, w, u, v, w, ...
+// arithmetic is component-wise and constants are broadcast, so the kernels of
+// Decomposer and Recomposer run on all components of a point at once: every load
+// and store moves C contiguous values and the component loops, unrolled at compile
+// time, give the SIMD lanes
+/*
+    the interleaved data is used in place, with no copies or separate passes:
+        float * velocity;   // n1 x n2 x n3 points of 3 components
+        MultiComponentDecomposer<float, 3> decomposer;
+        decomposer.decompose(as_components<3>(velocity), {n1, n2, n3}, target_level);
+    each component gets the coefficients of its own scalar decomposition, up to
+    rounding: the component loops run the same operations as the scalar kernels, but
+    the compiler may fuse multiply-adds in one and not in the other (e.g. with
+    MGARDX_ENABLE_AVX512 or -mfma), so they agree bitwise only without FMA contraction
+    (-ffp-contract=off) and within a few ulp otherwise
+*/
+template <class T, int C>
+struct Components{
+    T v[C];
+    Components() = default;
+    Components(T x){
+        for(int c=0; c<C; c++) v[c] = x;
+    }
+    Components& operator+=(const Components& b){
+        for(int c=0; c<C; c++) v[c] += b.v[c];
+        return *this;
+    }
+    Components& operator-=(const Components& b){
+        for(int c=0; c<C; c++) v[c] -= b.v[c];
+        return *this;
+    }
+    Components& operator*=(const Components& b){
+        for(int c=0; c<C; c++) v[c] *= b.v[c];
+        return *this;
+    }
+    Components& operator/=(const Components& b){
+        for(int c=0; c<C; c++) v[c] /= b.v[c];
+        return *this;
+    }
+    Components operator-() const{
+        Components r;
+        for(int c=0; c<C; c++) r.v[c] = - v[c];
+        return r;
+    }
+    friend Components operator+(Components a, const Components& b){
+        return a += b;
+    }
+    friend Components operator-(Components a, const Components& b){
+        return a -= b;
+    }
+    friend Components operator*(Components a, const Components& b){
+        return a *= b;
+    }
+    friend Components operator/(Components a, const Components& b){
+        return a /= b;
+    }
+    // all components equal, used by the fixed-point tests of the solver tables
+    friend bool operator==(const Components& a, const Components& b){
+        for(int c=0; c<C; c++){
+            if(a.v[c] != b.v[c]) return false;
+        }
+        return true;
+    }
+    friend bool operator!=(const Components& a, const Components& b){
+        return !(a == b);
+    }
+};
+
+template <class T, int C>
+using MultiComponentDecomposer = Decomposer<Components<T, C>>;
+template <class T, int C>
+using MultiComponentRecomposer = Recomposer<Components<T, C>>;
+
+// view of an interleaved array of C components per point
+template <int C, class T>
+inline Components<T, C> * as_components(T * data){
+    static_assert(sizeof(Components<T, C>) == C * sizeof(T), "Components must not be padded");
+    return reinterpret_cast<Components<T, C> *>(data);
+}
+
+// Lorenzo stage of the coarsest nodal grid: one scalar set of codes per component,
+// each with its own error bound eb.v[c]
+template <class T, int C>
+struct LorenzoCodes<Components<T, C>>{
+    Components<T, C> eb = Components<T, C>(0);
+    LorenzoCodes<T> component[C];
+    void clear(){
+        for(int c=0; c<C; c++) component[c].clear();
+    }
+    bool enabled() const{
+        for(int c=0; c<C; c++){
+            if(eb.v[c] > 0) return true;
+        }
+        return false;
+    }
+};
+
+// strides of one component in units of T
+inline vector<size_t> component_strides(const vector<size_t>& strides, int num_components){
+    vector<size_t> scalar_strides(strides);
+    for(auto& s:scalar_strides){
+        s *= num_components;
+    }
+    return scalar_strides;
+}
+
+template <class T, int C>
+void lorenzo_quantize(Components<T, C> * data, const vector<size_t>& dims, const vector<size_t>& strides, LorenzoCodes<Components<T, C>>& codes){
+    auto scalar_strides = component_strides(strides, C);
+    for(int c=0; c<C; c++){
+        codes.component[c].eb = codes.eb.v[c];
+        if(codes.eb.v[c] > 0) lorenzo_quantize(data->v + c, dims, scalar_strides, codes.component[c]);
+    }
+}
+
+template <class T, int C>
+void lorenzo_dequantize(Components<T, C> * data, const vector<size_t>& dims, const vector<size_t>& strides, const LorenzoCodes<Components<T, C>>& codes){
+    auto scalar_strides = component_strides(strides, C);
+    for(int c=0; c<C; c++){
+        if(codes.component[c].eb > 0) lorenzo_dequantize(data->v + c, dims, scalar_strides, codes.component[c]);
+    }
+}
+
+}
+#endif
@@ -0,0 +1,528 @@
+#ifndef _MGARD_NONUNIFORM_HPP
+#define _MGARD_NONUNIFORM_HPP
+
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include "reorder.hpp"
+#include "utils.hpp"
+#include "memory.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+/*
+    decomposition of data on a tensor-product grid with arbitrary (e.g. stretched)
+    coordinates along each dimension
+    the operations of a level are those of Decomposer with the constants of the uniform
+    grid replaced by their values on the actual intervals:
+    - the interpolant of a coefficient weights its two nodal neighbors by distance
+    - the load vector is the L2 product of the piecewise linear interpolant difference
+      with the coarse hat functions, a 5-point stencil along each dimension
+    - the mass matrix of the coarse grid is tridiagonal with entries (H_l + H_r) / 3
+      and H / 6 of the adjacent coarse intervals
+    these are computed once per dimension and level from the coordinates into a
+    NonUniformStencil, so a level only reads tables, as the Thomas factors of Decomposer
+    for an even number of values the virtual nodal value is placed at the mirror image of
+    the second to last point, 2 x[n-1] - x[n-2], as on the uniform grid
+    the layout of the coefficients is the same as in Decomposer, and uniform coordinates
+    give its coefficients up to rounding
+*/
+
+// tables of one dimension from a level of n values to its coarse level
+template <class T>
+struct NonUniformStencil{
+    size_t n = 0;
+    // interpolant of coefficient i: left_weight[i] nodal[i] + right_weight[i] nodal[i+1]
+    vector<T> left_weight, right_weight;
+    // load vector of nodal value i from the fine values around it:
+    // left_nodal[i] N[i-1] + left_coeff[i] C[i-1] + center[i] N[i] + right_coeff[i] C[i] + right_nodal[i] N[i+1]
+    vector<T> left_nodal, left_coeff, center, right_coeff, right_nodal;
+    // Thomas factors of the coarse mass matrix: forward x[i] -= w[i] x[i-1],
+    // backward x[i] = (x[i] - upper[i] x[i+1]) * inv_b[i]
+    vector<T> w, inv_b, upper;
+};
+
+// compute the stencil of the level with coordinates x and return the coordinates of its
+// coarse level (n / 2 + 1 values)
+template <class T>
+vector<double> init_nonuniform_stencil(const vector<double>& x, NonUniformStencil<T>& stencil){
+    size_t n = x.size();
+    size_t n_nodal = (n >> 1) + 1;
+    size_t n_coeff = n - n_nodal;
+    stencil.n = n;
+    vector<double> coarse(n_nodal);
+    for(size_t i=0; i<n_nodal; i++){
+        coarse[i] = (2 * i < n) ? x[2 * i] : 2 * x[n - 1] - x[n - 2];
+    }
+    stencil.left_weight.resize(n_coeff);
+    stencil.right_weight.resize(n_coeff);
+    stencil.left_nodal.assign(n_nodal, 0);
+    stencil.left_coeff.assign(n_nodal, 0);
+    stencil.center.assign(n_nodal, 0);
+    stencil.right_coeff.assign(n_nodal, 0);
+    stencil.right_nodal.assign(n_nodal, 0);
+    // coarse interval i contains coefficient i, at distance a from its left end and b
+    // from its right end; the products of the fine and coarse hat functions on it
+    // give the load vector (the interval of a virtual node has no coefficient)
+    for(size_t i=0; i<n_coeff; i++){
+        double a = x[2 * i + 1] - x[2 * i];
+        double b = x[2 * i + 2] - x[2 * i + 1];
+        double H = a + b;
+        stencil.left_weight[i] = b / H;
+        stencil.right_weight[i] = a / H;
+        stencil.center[i] += a / 6 * (2 + b / H);
+        stencil.right_coeff[i] = a / 6 * (1 + 2 * b / H) + b * b / (3 * H);
+        stencil.right_nodal[i] = b * b / (6 * H);
+        stencil.left_nodal[i + 1] = a * a / (6 * H);
+        stencil.left_coeff[i + 1] = b / 6 * (1 + 2 * a / H) + a * a / (3 * H);
+        stencil.center[i + 1] += b / 6 * (2 + a / H);
+    }
+    // mass matrix of the coarse grid
+    stencil.w.assign(n_nodal, 0);
+    stencil.inv_b.resize(n_nodal);
+    stencil.upper.assign(n_nodal, 0);
+    double b_prev = (coarse[1] - coarse[0]) / 3;
+    stencil.inv_b[0] = 1 / b_prev;
+    for(size_t i=1; i<n_nodal; i++){
+        double H_left = coarse[i] - coarse[i - 1];
+        double H_right = (i + 1 < n_nodal) ? coarse[i + 1] - coarse[i] : 0;
+        double upper = H_left / 6;
+        double w = upper / b_prev;
+        double b = (H_left + H_right) / 3 - w * upper;
+        stencil.upper[i - 1] = upper;
+        stencil.w[i] = w;
+        stencil.inv_b[i] = 1 / b;
+        b_prev = b;
+    }
+    return coarse;
+}
+
+// interpolant of the coefficients of a level along one dimension, in place
+// lines of n values (nodal values first), inner values apart, [k0, k1) of the inner index
+template <class T>
+void nonuniform_interpolate(T * line, size_t n, size_t inner, size_t k0, size_t k1, const NonUniformStencil<T>& stencil){
+    size_t n_nodal = (n >> 1) + 1;
+    size_t n_coeff = n - n_nodal;
+    const T * lw = stencil.left_weight.data();
+    const T * rw = stencil.right_weight.data();
+    if(inner == 1){
+        for(size_t i=0; i<n_coeff; i++){
+            line[n_nodal + i] = lw[i] * line[i] + rw[i] * line[i + 1];
+        }
+        return;
+    }
+    for(size_t i=0; i<n_coeff; i++){
+        const T * left = line + i * inner;
+        const T * right = left + inner;
+        T * coeff = line + (n_nodal + i) * inner;
+        for(size_t k=k0; k<k1; k++){
+            coeff[k] = lw[i] * left[k] + rw[i] * right[k];
+        }
+    }
+}
+
+// load vector along one dimension: the n values of a line of src (nodal values first)
+// are restricted to the n / 2 + 1 values of the line of dst, same inner layout
+template <class T>
+void nonuniform_restrict(const T * src, T * dst, size_t n, size_t inner, size_t k0, size_t k1, const NonUniformStencil<T>& stencil){
+    size_t n_nodal = (n >> 1) + 1;
+    size_t n_coeff = n - n_nodal;
+    const T * ln = stencil.left_nodal.data();
+    const T * lc = stencil.left_coeff.data();
+    const T * c = stencil.center.data();
+    const T * rc = stencil.right_coeff.data();
+    const T * rn = stencil.right_nodal.data();
+    if(inner == 1){
+        const T * N = src;
+        const T * C = src + n_nodal;
+        dst[0] = c[0] * N[0] + rc[0] * C[0] + rn[0] * N[1];
+        for(size_t i=1; i<n_coeff; i++){
+            dst[i] = ln[i] * N[i - 1] + lc[i] * C[i - 1] + c[i] * N[i] + rc[i] * C[i] + rn[i] * N[i + 1];
+        }
+        dst[n_coeff] = ln[n_coeff] * N[n_coeff - 1] + lc[n_coeff] * C[n_coeff - 1] + c[n_coeff] * N[n_coeff];
+        // virtual node of an even n
+        if(n_nodal == n_coeff + 2) dst[n_coeff + 1] = 0;
+        return;
+    }
+    const T * N = src;
+    const T * C = src + n_nodal * inner;
+    for(size_t i=0; i<n_nodal; i++){
+        T * out = dst + i * inner;
+        if(i > n_coeff){
+            for(size_t k=k0; k<k1; k++) out[k] = 0;
+            continue;
+        }
+        const T * nodal = N + i * inner;
+        for(size_t k=k0; k<k1; k++) out[k] = c[i] * nodal[k];
+        if(i > 0){
+            const T * left_nodal = nodal - inner;
+            const T * left_coeff = C + (i - 1) * inner;
+            for(size_t k=k0; k<k1; k++) out[k] += ln[i] * left_nodal[k] + lc[i] * left_coeff[k];
+        }
+        if(i < n_coeff){
+            const T * right_nodal = nodal + inner;
+            const T * right_coeff = C + i * inner;
+            for(size_t k=k0; k<k1; k++) out[k] += rc[i] * right_coeff[k] + rn[i] * right_nodal[k];
+        }
+    }
+}
+
+// solve the coarse mass matrix along one dimension, lines of m values in place
+template <class T>
+void nonuniform_solve(T * line, size_t m, size_t inner, size_t k0, size_t k1, const NonUniformStencil<T>& stencil){
+    const T * w = stencil.w.data();
+    const T * inv_b = stencil.inv_b.data();
+    const T * upper = stencil.upper.data();
+    if(inner == 1){
+        for(size_t i=1; i<m; i++){
+            line[i] -= w[i] * line[i - 1];
+        }
+        line[m - 1] *= inv_b[m - 1];
+        for(int i=m-2; i>=0; i--){
+            line[i] = (line[i] - upper[i] * line[i + 1]) * inv_b[i];
+        }
+        return;
+    }
+    for(size_t i=1; i<m; i++){
+        T * cur = line + i * inner;
+        const T * prev = cur - inner;
+        for(size_t k=k0; k<k1; k++) cur[k] -= w[i] * prev[k];
+    }
+    T * last = line + (m - 1) * inner;
+    for(size_t k=k0; k<k1; k++) last[k] *= inv_b[m - 1];
+    for(int i=m-2; i>=0; i--){
+        T * cur = line + i * inner;
+        const T * next = cur + inner;
+        for(size_t k=k0; k<k1; k++) cur[k] = (cur[k] - upper[i] * next[k]) * inv_b[i];
+    }
+}
+
+/*
+    shared level loop of NonUniformDecomposer and NonUniformRecomposer
+    dims of up to 3 dimensions are padded to 3D with leading 1s; data is dense row-major
+    the interpolant is computed into a copy of the level (buffer), one dimension at a
+    time: the coefficients along a dimension are interpolated from the values next to
+    them, which are already the interpolant of the coarse nodal values, so after the last
+    dimension every coefficient holds the multilinear interpolant; the load vector and
+    the correction are applied one dimension at a time on dense copies as well
+*/
+template <class T>
+class NonUniformTransform{
+public:
+    ~NonUniformTransform(){
+        if(buffer) free(buffer);
+        if(thread_buffer) free(thread_buffer);
+    }
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+    }
+    // placement of the scratch buffers allocated from now on, see MemoryPolicy
+    void set_memory_policy(const MemoryPolicy& policy){
+        memory_policy = policy;
+    }
+    // coordinates of the grid points along each dimension (strictly increasing,
+    // dims[i] values for dimension i); the tables are built on the next call
+    void set_coordinates(const vector<vector<double>>& coords_){
+        coords = coords_;
+        tables_dims.clear();
+    }
+
+protected:
+    ThreadPool * pool = NULL;
+    MemoryPolicy memory_policy;
+    vector<vector<double>> coords;
+    // stencils[l][d]: dimension d (padded to 3D) of level l, for the active dimensions
+    vector<vector<NonUniformStencil<T>>> stencils;
+    vector<size_t> tables_dims;         // dims and target level the tables were built for
+    size_t tables_level = 0;
+    // three dense scratch areas of the size of the data: interpolant, load vector (twice)
+    T * buffer = NULL;
+    size_t buffer_capacity = 0;
+    // per-thread reorder scratch, indexed by pool->thread_index()
+    T * thread_buffer = NULL;
+    size_t thread_buffer_size = 0;
+    size_t thread_buffer_capacity = 0;
+
+    // apply (forward) or undo all levels of data; returns the number of levels
+    int run(T * data, const vector<size_t>& dims, size_t target_level, bool hierarchical, bool forward){
+        if((dims.size() == 0) || (dims.size() > 3)){
+            cerr << "non-uniform decomposition supports 1 to 3 dimensions\n";
+            return 0;
+        }
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        if(!init_tables(dims, target_level)) return 0;
+        auto level_dims = init_levels(dims, target_level);
+        vector<size_t> padded_dims(3 - dims.size(), 1);
+        padded_dims.insert(padded_dims.end(), dims.begin(), dims.end());
+        auto strides = init_strides(padded_dims);
+        init(padded_dims);
+        for(size_t i=0; i<target_level; i++){
+            size_t l = forward ? target_level - i : i + 1;
+            vector<size_t> n(3 - dims.size(), 1), next(3 - dims.size(), 1);
+            n.insert(n.end(), level_dims[l].begin(), level_dims[l].end());
+            next.insert(next.end(), level_dims[l - 1].begin(), level_dims[l - 1].end());
+            bool active[3];
+            for(int d=0; d<3; d++) active[d] = (n[d] != next[d]);
+            if(forward) decompose_level(data, n, next, active, strides, stencils[l], hierarchical);
+            else recompose_level(data, n, next, active, strides, stencils[l], hierarchical);
+        }
+        return target_level;
+    }
+
+private:
+    bool init_tables(const vector<size_t>& dims, size_t target_level){
+        if((tables_dims == dims) && (tables_level == target_level)) return true;
+        if(coords.size() != dims.size()){
+            cerr << "non-uniform decomposition needs the coordinates of every dimension\n";
+            return false;
+        }
+        for(size_t d=0; d<dims.size(); d++){
+            if(coords[d].size() != dims[d]){
+                cerr << "dimension " << d << " has " << dims[d] << " values but " << coords[d].size() << " coordinates\n";
+                return false;
+            }
+            for(size_t i=1; i<dims[d]; i++){
+                if(!(coords[d][i] > coords[d][i - 1])){
+                    cerr << "coordinates of dimension " << d << " are not strictly increasing\n";
+                    return false;
+                }
+            }
+        }
+        auto level_dims = init_levels(dims, target_level);
+        size_t offset = 3 - dims.size();
+        stencils.assign(target_level + 1, vector<NonUniformStencil<T>>(3));
+        for(size_t d=0; d<dims.size(); d++){
+            vector<double> x = coords[d];
+            for(size_t l=target_level; l>0; l--){
+                if(level_dims[l][d] != level_dims[l - 1][d]) x = init_nonuniform_stencil(x, stencils[l][offset + d]);
+            }
+        }
+        tables_dims = dims;
+        tables_level = target_level;
+        return true;
+    }
+    void init(const vector<size_t>& dims){
+        size_t num_elements = dims[0] * dims[1] * dims[2];
+        if(3 * num_elements > buffer_capacity){
+            if(buffer) free(buffer);
+            buffer_capacity = 3 * num_elements;
+            buffer = (T *) workspace_malloc(buffer_capacity * sizeof(T), memory_policy, pool);
+        }
+        // reordering a dimension moves the rows of its plane with the innermost one
+        thread_buffer_size = dims[2] * max(dims[0], dims[1]);
+        size_t num_slots = pool ? pool->num_threads() + 1 : 1;
+        if(num_slots * thread_buffer_size > thread_buffer_capacity){
+            if(thread_buffer) free(thread_buffer);
+            thread_buffer_capacity = num_slots * thread_buffer_size;
+            thread_buffer = (T *) workspace_malloc(thread_buffer_capacity * sizeof(T), memory_policy, pool, thread_buffer_size * sizeof(T));
+        }
+    }
+    T * get_thread_buffer(){
+        return pool ? thread_buffer + pool->thread_index() * thread_buffer_size : thread_buffer;
+    }
+    void parallel_for(size_t n, const function<void(size_t)>& func){
+        if(pool) pool->parallel_for(0, n, func);
+        else for(size_t i=0; i<n; i++) func(i);
+    }
+    // run func(line, k0, k1) over the lines along dimension d of a dense box n, seen as
+    // outer x n[d] x inner; lines of the outermost dimension are split along inner
+    void for_each_line(const size_t * n, int d, const function<void(size_t, size_t, size_t)>& func){
+        size_t outer = 1, inner = 1;
+        for(int i=0; i<d; i++) outer *= n[i];
+        for(int i=d+1; i<3; i++) inner *= n[i];
+        size_t chunks = 1;
+        if(pool && (outer < 4 * (size_t) pool->num_threads())){
+            chunks = min((4 * (size_t) pool->num_threads() + outer - 1) / outer, max(inner / 64, (size_t) 1));
+        }
+        parallel_for(outer * chunks, [&](size_t t){
+            size_t o = t / chunks, c = t % chunks;
+            func(o, inner * c / chunks, inner * (c + 1) / chunks);
+        });
+    }
+    // reorder dimension d of the box n of data: nodal values first, with the virtual
+    // nodal value of an even n
+    void reorder_dimension(T * data, const size_t * n, const vector<size_t>& strides, int d, bool forward){
+        size_t n_nodal = (n[d] >> 1) + 1;
+        size_t n_coeff = n[d] - n_nodal;
+        if(d == 2){
+            parallel_for(n[0], [&](size_t i0){
+                T * buf = get_thread_buffer();
+                for(size_t i1=0; i1<n[1]; i1++){
+                    T * row = data + i0 * strides[0] + i1 * strides[1];
+                    if(forward){
+                        data_reorder_1D(row, n_nodal, n_coeff, buf, buf + n_nodal);
+                        memcpy(row, buf, n[2] * sizeof(T));
+                    }
+                    else{
+                        memcpy(buf, row, n[2] * sizeof(T));
+                        data_reverse_reorder_1D(row, n_nodal, n_coeff, buf, buf + n_nodal);
+                    }
+                }
+            });
+            return;
+        }
+        // planes of dimension d and the innermost one
+        int other = 1 - d;
+        parallel_for(n[other], [&](size_t o){
+            T * plane = data + o * strides[other];
+            size_t stride = strides[d];
+            T * last = plane + (n_nodal - 1) * stride;
+            T * prev = last - stride;
+            if(forward){
+                switch_rows_2D_by_buffer(plane, get_thread_buffer(), n[d], n[2], stride);
+                if(!(n[d] & 1)){
+                    for(size_t k=0; k<n[2]; k++) last[k] = 2 * last[k] - prev[k];
+                }
+            }
+            else{
+                if(!(n[d] & 1)){
+                    for(size_t k=0; k<n[2]; k++) last[k] = (prev[k] + last[k]) / 2;
+                }
+                switch_rows_2D_by_buffer_reverse(plane, get_thread_buffer(), n[d], n[2], stride);
+            }
+        });
+    }
+    // whether row (i0, i1) of a level lies in the coarse nodal box of the first two
+    // dimensions, so that only its part from m[2] on is made of coefficients
+    static bool coarse_row(size_t i0, size_t i1, const size_t * m){
+        return (i0 < m[0]) && (i1 < m[1]);
+    }
+    // multilinear interpolant of the coarse nodal values at every point of the level, in p
+    void compute_interpolant(T * p, const size_t * n, const bool * active, const vector<NonUniformStencil<T>>& level_stencils){
+        for(int d=0; d<3; d++){
+            if(!active[d]) continue;
+            size_t inner = 1;
+            for(int i=d+1; i<3; i++) inner *= n[i];
+            for_each_line(n, d, [&](size_t o, size_t k0, size_t k1){
+                nonuniform_interpolate(p + o * n[d] * inner, n[d], inner, k0, k1, level_stencils[d]);
+            });
+        }
+    }
+    // load vector of the dense interpolant difference f (box n) into the coarse box m,
+    // followed by the solution of the mass matrix; returns the correction
+    T * compute_correction(T * f, const size_t * n, const size_t * m, const bool * active, const vector<NonUniformStencil<T>>& level_stencils){
+        size_t num_elements = n[0] * n[1] * n[2];
+        T * src = f;
+        T * dst = buffer + num_elements;
+        T * other = buffer + 2 * num_elements;
+        size_t cur[3] = {n[0], n[1], n[2]};
+        for(int d=0; d<3; d++){
+            if(!active[d]) continue;
+            size_t inner = 1;
+            for(int i=d+1; i<3; i++) inner *= cur[i];
+            for_each_line(cur, d, [&](size_t o, size_t k0, size_t k1){
+                nonuniform_restrict(src + o * cur[d] * inner, dst + o * m[d] * inner, cur[d], inner, k0, k1, level_stencils[d]);
+            });
+            cur[d] = m[d];
+            src = dst;
+            dst = (dst == other) ? buffer + num_elements : other;
+        }
+        for(int d=0; d<3; d++){
+            if(!active[d]) continue;
+            size_t inner = 1;
+            for(int i=d+1; i<3; i++) inner *= m[i];
+            for_each_line(m, d, [&](size_t o, size_t k0, size_t k1){
+                nonuniform_solve(src + o * m[d] * inner, m[d], inner, k0, k1, level_stencils[d]);
+            });
+        }
+        return src;
+    }
+    // add (sign 1) or subtract (sign -1) the dense correction of the coarse box m
+    void apply_correction(T * data, const T * correction, const size_t * m, const vector<size_t>& strides, T sign){
+        parallel_for(m[0], [&](size_t i0){
+            for(size_t i1=0; i1<m[1]; i1++){
+                T * row = data + i0 * strides[0] + i1 * strides[1];
+                const T * c = correction + (i0 * m[1] + i1) * m[2];
+                for(size_t k=0; k<m[2]; k++) row[k] += sign * c[k];
+            }
+        });
+    }
+    void decompose_level(T * data, const vector<size_t>& level, const vector<size_t>& next, const bool * active, const vector<size_t>& strides, const vector<NonUniformStencil<T>>& level_stencils, bool hierarchical){
+        size_t n[3] = {level[0], level[1], level[2]};
+        size_t m[3] = {next[0], next[1], next[2]};
+        for(int d=2; d>=0; d--){
+            if(active[d]) reorder_dimension(data, n, strides, d, true);
+        }
+        // interpolant in buffer, then the interpolant difference f in buffer
+        // (0 on the coarse nodal values) and in the coefficients of data
+        T * f = buffer;
+        parallel_for(n[0], [&](size_t i0){
+            for(size_t i1=0; i1<n[1]; i1++){
+                memcpy(f + (i0 * n[1] + i1) * n[2], data + i0 * strides[0] + i1 * strides[1], n[2] * sizeof(T));
+            }
+        });
+        compute_interpolant(f, n, active, level_stencils);
+        parallel_for(n[0], [&](size_t i0){
+            for(size_t i1=0; i1<n[1]; i1++){
+                T * row = data + i0 * strides[0] + i1 * strides[1];
+                T * f_row = f + (i0 * n[1] + i1) * n[2];
+                for(size_t k=0; k<n[2]; k++) f_row[k] = row[k] - f_row[k];
+                size_t begin = coarse_row(i0, i1, m) ? m[2] : 0;
+                memcpy(row + begin, f_row + begin, (n[2] - begin) * sizeof(T));
+            }
+        });
+        if(hierarchical) return;
+        T * correction = compute_correction(f, n, m, active, level_stencils);
+        apply_correction(data, correction, m, strides, 1);
+    }
+    void recompose_level(T * data, const vector<size_t>& level, const vector<size_t>& next, const bool * active, const vector<size_t>& strides, const vector<NonUniformStencil<T>>& level_stencils, bool hierarchical){
+        size_t n[3] = {level[0], level[1], level[2]};
+        size_t m[3] = {next[0], next[1], next[2]};
+        T * f = buffer;
+        if(!hierarchical){
+            // the interpolant difference f is given by the coefficients
+            parallel_for(n[0], [&](size_t i0){
+                for(size_t i1=0; i1<n[1]; i1++){
+                    T * f_row = f + (i0 * n[1] + i1) * n[2];
+                    memcpy(f_row, data + i0 * strides[0] + i1 * strides[1], n[2] * sizeof(T));
+                    if(coarse_row(i0, i1, m)) memset(f_row, 0, m[2] * sizeof(T));
+                }
+            });
+            T * correction = compute_correction(f, n, m, active, level_stencils);
+            apply_correction(data, correction, m, strides, -1);
+        }
+        parallel_for(n[0], [&](size_t i0){
+            for(size_t i1=0; i1<n[1]; i1++){
+                memcpy(f + (i0 * n[1] + i1) * n[2], data + i0 * strides[0] + i1 * strides[1], n[2] * sizeof(T));
+            }
+        });
+        compute_interpolant(f, n, active, level_stencils);
+        parallel_for(n[0], [&](size_t i0){
+            for(size_t i1=0; i1<n[1]; i1++){
+                T * row = data + i0 * strides[0] + i1 * strides[1];
+                const T * f_row = f + (i0 * n[1] + i1) * n[2];
+                size_t begin = coarse_row(i0, i1, m) ? m[2] : 0;
+                for(size_t k=begin; k<n[2]; k++) row[k] += f_row[k];
+            }
+        });
+        for(int d=0; d<3; d++){
+            if(active[d]) reorder_dimension(data, n, strides, d, false);
+        }
+    }
+};
+
+template <class T>
+class NonUniformDecomposer : public NonUniformTransform<T>{
+public:
+    // decompose data (dense row-major) in place and return the number of levels
+    int decompose(T * data, const vector<size_t>& dims, size_t target_level, bool hierarchical=false){
+        return this->run(data, dims, target_level, hierarchical, true);
+    }
+};
+
+template <class T>
+class NonUniformRecomposer : public NonUniformTransform<T>{
+public:
+    // recompose the output of NonUniformDecomposer in place, same coordinates
+    void recompose(T * data, const vector<size_t>& dims, size_t target_level, bool hierarchical=false){
+        this->run(data, dims, target_level, hierarchical, false);
+    }
+};
+
+}
+#endif
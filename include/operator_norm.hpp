@@ -0,0 +1,344 @@
+#ifndef _MGARD_OPERATOR_NORM_HPP
+#define _MGARD_OPERATOR_NORM_HPP
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include "utils.hpp"
+#include "misc.hpp"
+#include "correction.hpp"
+#include "recompose.hpp"
+#include "thread_pool.hpp"
+#include "memory.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// level norms of the multilevel decomposition in the s-norm
+//   norm[l] = 2^{-2sl} (||Q_l u||^2 - ||Q_{l-1} u||^2), norm[0] = ||Q_0 u||^2
+// where Q_l is the L2 projection onto the piecewise linear functions of level l
+// and u is the piecewise linear interpolant of the data (grid spacing 1 on the finest level)
+// levels follow init_levels; even dimensions are extended by the same virtual node as in decompose
+// these are energies of the projections, so they scale with the domain (the number of
+// elements) and with the square of the data; they are not the values of the draft
+// compute_operator_norm_3D formerly in test_operator_norm.cpp, which took the inner product
+// of the reordered data with the correction of compute_correction_3D (computed from the
+// coefficients only, with h = 1 on every level) and is orders of magnitude smaller
+// for s = 0 and dimensions of 2^k + 1 the level norms add up to ||u||^2
+// plan buffers are kept between calls, so an instance should be reused for repeated shapes;
+// an instance must not be used by several threads at the same time
+template <class T>
+class OperatorNorm{
+public:
+    OperatorNorm(){}
+    ~OperatorNorm(){
+        if(work_buffer) free(work_buffer);
+        if(load_buffer) free(load_buffer);
+        if(line_buffer) free(line_buffer);
+    }
+    // parallelize over lines and slabs on the given pool (NULL for serial execution)
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+        recomposer.set_thread_pool(pool_);
+    }
+    // placement of the plan buffers allocated from now on, see MemoryPolicy
+    void set_memory_policy(const MemoryPolicy& policy){
+        memory_policy = policy;
+        recomposer.set_memory_policy(policy);
+    }
+    // compute the level norms of data (dense row-major, dims of 1 to 3 dimensions)
+    // return target_level + 1 norms from the coarsest level 0 to the finest level
+    vector<double> compute(const T * data, const vector<size_t>& dims, size_t target_level, double s){
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        auto level_dims = init_levels(dims, target_level);
+        init(dims);
+        // the current level is stored densely in load_buffer
+        size_t n[3];
+        pad_dims(dims, n);
+        data_copy_strided(data, dense_strides(n), pad(n), load_buffer, dense_strides(n));
+        double h[3] = {1, 1, 1};
+        vector<double> norms(target_level + 1, 0);
+        for(int i=0; i<target_level; i++){
+            size_t fine[3], coarse[3];
+            pad_dims(level_dims[target_level - i], fine);
+            pad_dims(level_dims[target_level - i - 1], coarse);
+            // extended fine level in work_buffer, with strides of ext
+            size_t ext[3];
+            for(int k=0; k<3; k++){
+                ext[k] = fine[k] + ((fine[k] != coarse[k]) && !(fine[k] & 1));
+            }
+            vector<size_t> ext_strides = dense_strides(ext);
+            data_copy_strided(load_buffer, dense_strides(fine), pad(fine), work_buffer, ext_strides);
+            for(int k=0; k<3; k++){
+                if(ext[k] != fine[k]) extend(ext, ext_strides, k);
+            }
+            // energy of Q_l u = <u, M u>, with M u in load_buffer
+            data_copy_strided(work_buffer, ext_strides, pad(ext), load_buffer, ext_strides);
+            for(int k=0; k<3; k++){
+                if(ext[k] > 1) apply_mass(load_buffer, ext, ext_strides, k, h[k]);
+            }
+            double fine_norm = dot(work_buffer, load_buffer, ext, ext_strides);
+            // projection: solve M_{l-1} c = P^T M u in the leading box of load_buffer
+            size_t box[3] = {ext[0], ext[1], ext[2]};
+            for(int k=0; k<3; k++){
+                if(coarse[k] != fine[k]){
+                    restrict(load_buffer, box, ext_strides, k);
+                    box[k] = coarse[k];
+                }
+            }
+            data_copy_strided(load_buffer, ext_strides, pad(coarse), work_buffer, ext_strides);
+            for(int k=0; k<3; k++){
+                if(coarse[k] != fine[k]) h[k] *= 2;
+                if(coarse[k] > 1) solve_mass(load_buffer, coarse, ext_strides, k, h[k]);
+            }
+            // energy of Q_{l-1} u = <c, P^T M u>
+            double coarse_norm = dot(load_buffer, work_buffer, coarse, ext_strides);
+            norms[target_level - i] = pow(2, -2*s*(target_level - i)) * (fine_norm - coarse_norm);
+            norms[0] = coarse_norm;
+            // continue with the dense coarse level
+            data_copy_strided(load_buffer, ext_strides, pad(coarse), work_buffer, dense_strides(coarse));
+            memcpy(load_buffer, work_buffer, coarse[0] * coarse[1] * coarse[2] * sizeof(T));
+        }
+        if(target_level == 0){
+            data_copy_strided(load_buffer, dense_strides(n), pad(n), work_buffer, dense_strides(n));
+            for(int k=0; k<3; k++){
+                if(n[k] > 1) apply_mass(work_buffer, n, dense_strides(n), k, h[k]);
+            }
+            norms[0] = dot(load_buffer, work_buffer, n, dense_strides(n));
+        }
+        return norms;
+    }
+    // per-level weights of the recomposition operator
+    // weight[l]^2 is the mean of ||R z||_s^2 / ||z||^2 over unit random coefficients z
+    // supported on level l, where R is the recomposition and ||.||_s^2 the sum of the
+    // level norms of compute; an error e on the coefficients therefore contributes
+    // about sum_l weight[l]^2 ||e_l||^2 to the squared s-norm of the reconstruction error
+    // results are cached by (dims, levels, s, hierarchical)
+    const vector<double>& get_level_weights(const vector<size_t>& dims, size_t target_level, double s, bool hierarchical=false){
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        auto key = make_tuple(dims, target_level, s, hierarchical);
+        auto it = weight_cache.find(key);
+        if(it != weight_cache.end()) return it->second;
+        auto weights = probe_level_weights(dims, target_level, hierarchical, [&](const T * x){
+            auto norms = compute(x, dims, target_level, s);
+            double sum = 0;
+            for(const auto& norm:norms){
+                sum += norm;
+            }
+            return sum;
+        });
+        return weight_cache[key] = weights;
+    }
+    // same as get_level_weights with the discrete norm ||x||^2 = sum_i x_i^2 of the
+    // reconstructed values instead of the s-norm, e.g. for MSE and PSNR
+    const vector<double>& get_discrete_level_weights(const vector<size_t>& dims, size_t target_level, bool hierarchical=false){
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        auto key = make_tuple(dims, target_level, hierarchical);
+        auto it = discrete_weight_cache.find(key);
+        if(it != discrete_weight_cache.end()) return it->second;
+        size_t num_elements = 1;
+        for(const auto& d:dims){
+            num_elements *= d;
+        }
+        auto weights = probe_level_weights(dims, target_level, hierarchical, [&](const T * x){
+            return dot_product(x, x, num_elements);
+        });
+        return discrete_weight_cache[key] = weights;
+    }
+    void clear_cache(){
+        weight_cache.clear();
+        discrete_weight_cache.clear();
+    }
+    // random coefficients drawn per level in get_level_weights
+    size_t min_probe_samples = 4096;
+    size_t max_probes = 16;
+
+private:
+    ThreadPool * pool = NULL;
+    MemoryPolicy memory_policy;
+    Recomposer<T> recomposer;
+    T * work_buffer = NULL;
+    T * load_buffer = NULL;
+    T * line_buffer = NULL;     // one line per thread, see line_scratch
+    size_t buffer_capacity = 0;
+    size_t line_capacity = 0;
+    size_t max_line = 0;
+    // Thomas factors w and b of the mass matrix keyed by the line length; they do
+    // not depend on h, which only scales the right-hand side in solve_mass
+    map<size_t, pair<vector<T>, vector<T>>> thomas_tables;
+    map<tuple<vector<size_t>, size_t, double, bool>, vector<double>> weight_cache;
+    map<tuple<vector<size_t>, size_t, bool>, vector<double>> discrete_weight_cache;
+
+    // weight[l] = sqrt(mean of norm(R z) / ||z||^2) over random sign probes z of level l
+    vector<double> probe_level_weights(const vector<size_t>& dims, size_t target_level, bool hierarchical, const function<double(const T *)>& norm){
+        auto level_dims = init_levels(dims, target_level);
+        size_t n[3];
+        pad_dims(dims, n);
+        vector<T> probe(n[0] * n[1] * n[2]);
+        vector<double> weights(target_level + 1, 0);
+        for(int l=0; l<=target_level; l++){
+            size_t box[3], inner[3] = {0, 0, 0};
+            pad_dims(level_dims[l], box);
+            if(l > 0) pad_dims(level_dims[l - 1], inner);
+            size_t num_coeff = box[0] * box[1] * box[2] - inner[0] * inner[1] * inner[2];
+            // enough probes for a stable estimate on the small coarse levels
+            size_t num_probes = min(max_probes, (min_probe_samples + num_coeff - 1) / num_coeff);
+            double sum = 0;
+            for(int p=0; p<num_probes; p++){
+                fill_probe(probe.data(), n, box, inner, l * max_probes + p);
+                recomposer.recompose(probe.data(), dims, target_level, hierarchical);
+                sum += norm(probe.data());
+            }
+            weights[l] = sqrt(sum / (num_probes * num_coeff));
+        }
+        return weights;
+    }
+    // pad to 3 dimensions with leading dimensions of size 1
+    static void pad_dims(const vector<size_t>& dims, size_t * n){
+        n[0] = n[1] = n[2] = 1;
+        int offset = 3 - dims.size();
+        for(int i=0; i<dims.size(); i++){
+            n[offset + i] = dims[i];
+        }
+    }
+    static vector<size_t> pad(const size_t * n){
+        return vector<size_t>(n, n + 3);
+    }
+    static vector<size_t> dense_strides(const size_t * n){
+        return init_strides(pad(n));
+    }
+    void init(const vector<size_t>& dims){
+        size_t n[3];
+        pad_dims(dims, n);
+        // room for the virtual nodes of even dimensions
+        size_t size = (n[0] + 1) * (n[1] + 1) * (n[2] + 1);
+        if(size > buffer_capacity){
+            if(work_buffer) free(work_buffer);
+            if(load_buffer) free(load_buffer);
+            work_buffer = (T *) workspace_malloc(size * sizeof(T), memory_policy, pool);
+            load_buffer = (T *) workspace_malloc(size * sizeof(T), memory_policy, pool);
+            buffer_capacity = size;
+        }
+        max_line = *max_element(n, n + 3) + 1;
+        int num_threads = pool ? pool->num_threads() + 1 : 1;
+        if(num_threads * max_line > line_capacity){
+            if(line_buffer) free(line_buffer);
+            line_capacity = num_threads * max_line;
+            line_buffer = (T *) workspace_malloc(line_capacity * sizeof(T), memory_policy, pool, max_line * sizeof(T));
+        }
+    }
+    T * line_scratch(){
+        return line_buffer + (pool ? pool->thread_index() : 0) * max_line;
+    }
+    // run func(line, stride) on all lines of box along dimension k
+    void for_each_line(T * data, const size_t * box, const vector<size_t>& strides, int k, const function<void(T *, size_t)>& func){
+        int a = (k == 0) ? 1 : 0;
+        int b = (k == 2) ? 1 : 2;
+        size_t num_lines = box[a] * box[b];
+        auto line = [&](size_t i){
+            func(data + (i / box[b]) * strides[a] + (i % box[b]) * strides[b], strides[k]);
+        };
+        if(pool) pool->parallel_for(0, num_lines, line, max((size_t) 1, num_lines / (8 * pool->num_threads())));
+        else for(size_t i=0; i<num_lines; i++) line(i);
+    }
+    // set the virtual node of dimension k to 2 x[n-1] - x[n-2], as in data_reorder_1D
+    void extend(const size_t * ext, const vector<size_t>& strides, int k){
+        size_t n = ext[k];
+        for_each_line(work_buffer, ext, strides, k, [n](T * x, size_t stride){
+            x[(n - 1) * stride] = 2 * x[(n - 2) * stride] - x[(n - 3) * stride];
+        });
+    }
+    // x = M x along dimension k, M = h tridiag(1/6, 2/3, 1/6) with 1/3 at both ends
+    void apply_mass(T * data, const size_t * box, const vector<size_t>& strides, int k, double h){
+        size_t n = box[k];
+        for_each_line(data, box, strides, k, [this, n, h](T * x, size_t stride){
+            T * line = line_scratch();
+            for(size_t i=0; i<n; i++) line[i] = x[i * stride];
+            x[0] = h * (line[0] / 3 + line[1] / 6);
+            for(size_t i=1; i<n-1; i++){
+                x[i * stride] = h * ((line[i - 1] + line[i + 1]) / 6 + line[i] * 2 / 3);
+            }
+            x[(n - 1) * stride] = h * (line[n - 2] / 6 + line[n - 1] / 3);
+        });
+    }
+    // x = P^T x along dimension k, the result is stored in the leading (n >> 1) + 1 entries
+    void restrict(T * data, const size_t * box, const vector<size_t>& strides, int k){
+        size_t n = box[k];
+        for_each_line(data, box, strides, k, [this, n](T * x, size_t stride){
+            T * line = line_scratch();
+            for(size_t i=0; i<n; i++) line[i] = x[i * stride];
+            size_t n_nodal = (n >> 1) + 1;
+            x[0] = line[0] + line[1] / 2;
+            for(size_t i=1; i<n_nodal-1; i++){
+                x[i * stride] = line[2*i] + (line[2*i - 1] + line[2*i + 1]) / 2;
+            }
+            x[(n_nodal - 1) * stride] = line[n - 1] + line[n - 2] / 2;
+        });
+    }
+    // x = M^{-1} x along dimension k
+    void solve_mass(T * data, const size_t * box, const vector<size_t>& strides, int k, double h){
+        size_t n = box[k];
+        // the factors are of 2/h M
+        T scale = 2 / h;
+        const T * w_pos = NULL;
+        const T * b_pos = NULL;
+        get_thomas_tables(n, w_pos, b_pos);
+        for_each_line(data, box, strides, k, [=](T * x, size_t stride){
+            T * line = line_scratch();
+            for(size_t i=0; i<n; i++) line[i] = x[i * stride] * scale;
+            compute_correction_precomputed(line, n, w_pos, b_pos, (T) h, line);
+            for(size_t i=0; i<n; i++) x[i * stride] = line[i];
+        });
+    }
+    void get_thomas_tables(size_t n, const T *& w, const T *& b){
+        auto it = thomas_tables.find(n);
+        if(it == thomas_tables.end()){
+            auto& tables = thomas_tables[n];
+            tables.first.resize(n);
+            tables.second.resize(n);
+            precompute_w_and_b(tables.first.data(), tables.second.data(), n);
+            it = thomas_tables.find(n);
+        }
+        w = it->second.first.data();
+        b = it->second.second.data();
+    }
+    // sum of A[i] B[i] over box, partial sums per slab for a deterministic result
+    double dot(const T * A, const T * B, const size_t * box, const vector<size_t>& strides){
+        vector<double> partial(box[0] * box[1], 0);
+        auto slab = [&](size_t i){
+            size_t offset = (i / box[1]) * strides[0] + (i % box[1]) * strides[1];
+            partial[i] = dot_product(A + offset, B + offset, box[2]);
+        };
+        if(pool) pool->parallel_for(0, partial.size(), slab, max((size_t) 1, partial.size() / (8 * pool->num_threads())));
+        else for(size_t i=0; i<partial.size(); i++) slab(i);
+        double sum = 0;
+        for(const auto& p:partial){
+            sum += p;
+        }
+        return sum;
+    }
+    // random signs on the coefficients of one level (box minus inner), zero elsewhere
+    void fill_probe(T * probe, const size_t * n, const size_t * box, const size_t * inner, size_t seed){
+        memset(probe, 0, n[0] * n[1] * n[2] * sizeof(T));
+        uint64_t state = 0x9E3779B97F4A7C15ULL * (seed + 1);
+        for(size_t i=0; i<box[0]; i++){
+            for(size_t j=0; j<box[1]; j++){
+                for(size_t k=0; k<box[2]; k++){
+                    if((i < inner[0]) && (j < inner[1]) && (k < inner[2])) continue;
+                    // xorshift64
+                    state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+                    probe[(i * n[1] + j) * n[2] + k] = (state & 1) ? 1 : -1;
+                }
+            }
+        }
+    }
+};
+
+}
+#endif
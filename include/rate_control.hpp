@@ -0,0 +1,232 @@
+#ifndef _MGARD_RATE_CONTROL_HPP
+#define _MGARD_RATE_CONTROL_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include "utils.hpp"
+#include "error_estimator.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// quantizer of each level chosen by RateController
+struct RateAllocation{
+    vector<double> bin_width;   // 0 if the level is dropped (all values set to 0)
+    vector<double> bits;        // bits per value of each level
+    double bits_per_value = 0;  // over all values
+    int passes = 0;             // number of quantization passes over the data
+};
+
+// replace codes by the dequantized coefficients code * bin_width of their level
+template <class T>
+void dequantize_levels(const int * codes, const vector<size_t>& dims, size_t target_level, const vector<double>& bin_width, T * coeff, ThreadPool * pool=NULL){
+    if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+    for_each_level_value(dims, init_levels(dims, target_level), pool, [&](size_t b, size_t p, int l){
+        coeff[p] = codes[p] * bin_width[l];
+    });
+}
+
+// fixed-rate quantization of decomposed coefficients
+// the bin widths follow reverse water-filling: every level gets the same weighted
+// distortion theta = w_l^2 D_l (w_l the level weights of ErrorEstimator, D_l = bin_width^2 / 12);
+// a level is dropped once its bin width exceeds twice its largest coefficient, where all
+// its codes are 0 anyway; dropping it as soon as D_l reaches its energy would take away
+// the rate of a whole level at once (about 0.5 bits per value) and leave the targets in
+// between out of reach
+// theta is searched on a sample of each level, whose code entropy predicts the rate, and
+// the full data is quantized once, plus once more if the measured rate misses the target
+// by more than tolerance (the second search corrects the sample model by the measured offset)
+// the rate is the zeroth-order entropy of the codes of each level, i.e. the size
+// reached by a per-level entropy coder; codes beyond escape_radius cost 32 extra bits
+template <class T>
+class RateController{
+public:
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+        estimator.set_thread_pool(pool_);
+    }
+    // quantize coeff (dense decomposed data) to about target_bits per value
+    // codes receives one quantization index per value and coeff the dequantized values
+    RateAllocation quantize(T * coeff, const vector<size_t>& dims, size_t target_level, double target_bits, vector<int>& codes, bool hierarchical=false){
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        auto level_dims = init_levels(dims, target_level);
+        size_t num_levels = target_level + 1;
+        size_t num_elements = 1;
+        for(const auto& d:dims){
+            num_elements *= d;
+        }
+        vector<size_t> count(num_levels);
+        for(size_t l=0; l<num_levels; l++){
+            size_t box = 1, inner = (l > 0);
+            for(int k=0; k<dims.size(); k++){
+                box *= level_dims[l][k];
+                if(l > 0) inner *= level_dims[l - 1][k];
+            }
+            count[l] = box - inner;
+        }
+        collect_samples(coeff, dims, level_dims, count);
+        weights = estimator.get_level_weights(dims, target_level, hierarchical);
+        // theta for which every level is dropped
+        theta_max = 0;
+        for(size_t l=0; l<num_levels; l++){
+            theta_max = max(theta_max, weights[l] * weights[l] * max_abs[l] * max_abs[l] / 3);
+        }
+        RateAllocation allocation;
+        if(theta_max == 0){
+            // all coefficients are zero: every level is dropped, at rate 0
+            allocation.bin_width.assign(num_levels, 0);
+            quantize_codes(coeff, dims, level_dims, count, allocation, codes);
+            allocation.passes = 1;
+            return allocation;
+        }
+        double model_target = target_bits;
+        for(int pass=0; pass<max_passes; pass++){
+            double theta = search_theta(count, num_elements, model_target);
+            allocation.bin_width = get_bin_width(theta);
+            quantize_codes(coeff, dims, level_dims, count, allocation, codes);
+            allocation.passes = pass + 1;
+            if(fabs(allocation.bits_per_value - target_bits) <= tolerance * target_bits) break;
+            // shift the target of the sample model by its measured offset
+            model_target += target_bits - allocation.bits_per_value;
+            if(model_target <= 0) break;
+        }
+        dequantize_levels(codes.data(), dims, target_level, allocation.bin_width, coeff, pool);
+        return allocation;
+    }
+    // relative deviation from the target rate accepted after a pass
+    double tolerance = 0.02;
+    int max_passes = 2;
+    // values per level used to model the rate
+    size_t max_samples = 1 << 15;
+    size_t escape_radius = 1 << 12;
+
+private:
+    ThreadPool * pool = NULL;
+    ErrorEstimator<T> estimator;
+    vector<double> weights;
+    vector<double> max_abs;
+    vector<vector<T>> samples;
+    double theta_max = 0;
+
+    // largest magnitude of all values and a hashed subset of at most about max_samples per level
+    void collect_samples(const T * coeff, const vector<size_t>& dims, const vector<vector<size_t>>& level_dims, const vector<size_t>& count){
+        size_t num_levels = count.size();
+        size_t num_blocks = get_num_level_blocks(dims);
+        vector<size_t> period(num_levels);
+        for(size_t l=0; l<num_levels; l++){
+            period[l] = max((size_t) 1, count[l] / max_samples);
+        }
+        vector<double> block_max_abs(num_blocks * num_levels, 0);
+        vector<vector<T>> block_samples(num_blocks * num_levels);
+        for_each_level_value(dims, level_dims, pool, [&](size_t b, size_t p, int l){
+            block_max_abs[b * num_levels + l] = max(block_max_abs[b * num_levels + l], (double) fabs(coeff[p]));
+            // multiplicative hash, so that the sample does not alias with the grid
+            if((((uint64_t) p * 0x9E3779B97F4A7C15ULL) >> 32) % period[l] == 0){
+                block_samples[b * num_levels + l].push_back(coeff[p]);
+            }
+        });
+        max_abs.assign(num_levels, 0);
+        samples.assign(num_levels, vector<T>());
+        for(size_t b=0; b<num_blocks; b++){
+            for(size_t l=0; l<num_levels; l++){
+                max_abs[l] = max(max_abs[l], block_max_abs[b * num_levels + l]);
+                samples[l].insert(samples[l].end(), block_samples[b * num_levels + l].begin(), block_samples[b * num_levels + l].end());
+            }
+        }
+    }
+    vector<double> get_bin_width(double theta){
+        vector<double> bin_width(weights.size(), 0);
+        for(size_t l=0; l<weights.size(); l++){
+            double width = sqrt(12 * theta / (weights[l] * weights[l]));
+            if(width <= 2 * max_abs[l]) bin_width[l] = width;
+        }
+        return bin_width;
+    }
+    // entropy in bits of the codes of values with the given bin width
+    double sample_entropy(const vector<T>& values, double bin_width){
+        if((bin_width == 0) || values.empty()) return 0;
+        vector<int64_t> q(values.size());
+        for(size_t i=0; i<values.size(); i++){
+            q[i] = llround(values[i] / bin_width);
+        }
+        sort(q.begin(), q.end());
+        double entropy = 0;
+        double n = q.size();
+        for(size_t i=0; i<q.size(); ){
+            size_t j = i;
+            while((j < q.size()) && (q[j] == q[i])) j ++;
+            double prob = (j - i) / n;
+            entropy -= prob * log2(prob);
+            // escaped codes are stored with 32 extra bits
+            if((size_t) llabs(q[i]) > escape_radius) entropy += prob * 32;
+            i = j;
+        }
+        return entropy;
+    }
+    // bisection on log theta for the sample model rate target_bits
+    double search_theta(const vector<size_t>& count, size_t num_elements, double target_bits){
+        double lo = log(theta_max) - 80, hi = log(theta_max);
+        for(int i=0; i<60; i++){
+            double mid = (lo + hi) / 2;
+            auto bin_width = get_bin_width(exp(mid));
+            double bits = 0;
+            for(size_t l=0; l<count.size(); l++){
+                bits += count[l] * sample_entropy(samples[l], bin_width[l]);
+            }
+            // the rate decreases with theta
+            if(bits / num_elements > target_bits) lo = mid;
+            else hi = mid;
+        }
+        return exp(hi);
+    }
+    // quantize all values and measure the entropy of their codes
+    void quantize_codes(const T * coeff, const vector<size_t>& dims, const vector<vector<size_t>>& level_dims, const vector<size_t>& count, RateAllocation& allocation, vector<int>& codes){
+        size_t num_levels = count.size();
+        size_t num_elements = 0;
+        for(const auto& c:count){
+            num_elements += c;
+        }
+        codes.resize(num_elements);
+        // histograms of codes in [-escape_radius, escape_radius] per thread and level,
+        // escaped codes are counted in one extra bin
+        size_t num_bins = 2 * escape_radius + 2;
+        int num_threads = pool ? pool->num_threads() + 1 : 1;
+        vector<uint64_t> histograms(num_threads * num_levels * num_bins, 0);
+        vector<double> inv_bin_width(num_levels, 0);
+        for(size_t l=0; l<num_levels; l++){
+            if(allocation.bin_width[l] > 0) inv_bin_width[l] = 1 / allocation.bin_width[l];
+        }
+        int64_t radius = escape_radius;
+        for_each_level_value(dims, level_dims, pool, [&](size_t b, size_t p, int l){
+            int64_t q = llround(coeff[p] * inv_bin_width[l]);
+            q = max((int64_t) INT32_MIN, min((int64_t) INT32_MAX, q));
+            codes[p] = (int) q;
+            uint64_t * histogram = histograms.data() + ((pool ? pool->thread_index() : 0) * num_levels + l) * num_bins;
+            histogram[(llabs(q) <= radius) ? q + radius : num_bins - 1] ++;
+        });
+        allocation.bits.assign(num_levels, 0);
+        double total_bits = 0;
+        for(size_t l=0; l<num_levels; l++){
+            double bits = 0;
+            for(size_t i=0; i<num_bins; i++){
+                uint64_t c = 0;
+                for(int t=0; t<num_threads; t++){
+                    c += histograms[(t * num_levels + l) * num_bins + i];
+                }
+                if(c == 0) continue;
+                bits -= c * log2((double) c / count[l]);
+                if(i == num_bins - 1) bits += c * 32.0;
+            }
+            allocation.bits[l] = bits / count[l];
+            total_bits += bits;
+        }
+        allocation.bits_per_value = total_bits / num_elements;
+    }
+};
+
+}
+#endif
@@ -2,11 +2,162 @@
 #define _MGARD_REORDER_HPP
 
 #include <vector>
+#include <cstring>
+#include <algorithm>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
 
 namespace MGARD{
 
 using namespace std;
 
+// split n pairs of contiguous values into even[i] = x[2i] and odd[i] = x[2i + 1]
+template <class T>
+inline void deinterleave_scalar(const T * x, size_t n, T * even, T * odd){
+    for(size_t i=0; i<n; i++){
+        even[i] = x[2 * i];
+        odd[i] = x[2 * i + 1];
+    }
+}
+// inverse of deinterleave: x[2i] = even[i], x[2i + 1] = odd[i]
+template <class T>
+inline void interleave_scalar(const T * even, const T * odd, size_t n, T * x){
+    for(size_t i=0; i<n; i++){
+        x[2 * i] = even[i];
+        x[2 * i + 1] = odd[i];
+    }
+}
+template <class T>
+inline void deinterleave(const T * x, size_t n, T * even, T * odd){
+    deinterleave_scalar(x, n, even, odd);
+}
+template <class T>
+inline void interleave(const T * even, const T * odd, size_t n, T * x){
+    interleave_scalar(even, odd, n, x);
+}
+// vectorized versions for float and double, enabled by the compiler flags
+// (-mavx2 or -mavx512f, see the MGARDX_ENABLE_AVX2/AVX512 options), with a scalar tail
+#if defined(__AVX512F__)
+template <>
+inline void deinterleave(const float * x, size_t n, float * even, float * odd){
+    const __m512i even_index = _mm512_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30);
+    const __m512i odd_index = _mm512_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31);
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m512 a = _mm512_loadu_ps(x + 2 * i);
+        __m512 b = _mm512_loadu_ps(x + 2 * i + 16);
+        _mm512_storeu_ps(even + i, _mm512_permutex2var_ps(a, even_index, b));
+        _mm512_storeu_ps(odd + i, _mm512_permutex2var_ps(a, odd_index, b));
+    }
+    deinterleave_scalar(x + 2 * i, n - i, even + i, odd + i);
+}
+template <>
+inline void deinterleave(const double * x, size_t n, double * even, double * odd){
+    const __m512i even_index = _mm512_setr_epi64(0, 2, 4, 6, 8, 10, 12, 14);
+    const __m512i odd_index = _mm512_setr_epi64(1, 3, 5, 7, 9, 11, 13, 15);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m512d a = _mm512_loadu_pd(x + 2 * i);
+        __m512d b = _mm512_loadu_pd(x + 2 * i + 8);
+        _mm512_storeu_pd(even + i, _mm512_permutex2var_pd(a, even_index, b));
+        _mm512_storeu_pd(odd + i, _mm512_permutex2var_pd(a, odd_index, b));
+    }
+    deinterleave_scalar(x + 2 * i, n - i, even + i, odd + i);
+}
+template <>
+inline void interleave(const float * even, const float * odd, size_t n, float * x){
+    const __m512i low_index = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    const __m512i high_index = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    size_t i = 0;
+    for(; i + 16 <= n; i += 16){
+        __m512 e = _mm512_loadu_ps(even + i);
+        __m512 o = _mm512_loadu_ps(odd + i);
+        _mm512_storeu_ps(x + 2 * i, _mm512_permutex2var_ps(e, low_index, o));
+        _mm512_storeu_ps(x + 2 * i + 16, _mm512_permutex2var_ps(e, high_index, o));
+    }
+    interleave_scalar(even + i, odd + i, n - i, x + 2 * i);
+}
+template <>
+inline void interleave(const double * even, const double * odd, size_t n, double * x){
+    const __m512i low_index = _mm512_setr_epi64(0, 8, 1, 9, 2, 10, 3, 11);
+    const __m512i high_index = _mm512_setr_epi64(4, 12, 5, 13, 6, 14, 7, 15);
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m512d e = _mm512_loadu_pd(even + i);
+        __m512d o = _mm512_loadu_pd(odd + i);
+        _mm512_storeu_pd(x + 2 * i, _mm512_permutex2var_pd(e, low_index, o));
+        _mm512_storeu_pd(x + 2 * i + 8, _mm512_permutex2var_pd(e, high_index, o));
+    }
+    interleave_scalar(even + i, odd + i, n - i, x + 2 * i);
+}
+#elif defined(__AVX2__)
+template <>
+inline void deinterleave(const float * x, size_t n, float * even, float * odd){
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m256 a = _mm256_loadu_ps(x + 2 * i);
+        __m256 b = _mm256_loadu_ps(x + 2 * i + 8);
+        // per 128-bit lane: a0 a2 b0 b2 | a4 a6 b4 b6, then reorder the 64-bit quarters
+        __m256 e = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m256 o = _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm256_storeu_ps(even + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(e), _MM_SHUFFLE(3, 1, 2, 0))));
+        _mm256_storeu_ps(odd + i, _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(o), _MM_SHUFFLE(3, 1, 2, 0))));
+    }
+    deinterleave_scalar(x + 2 * i, n - i, even + i, odd + i);
+}
+template <>
+inline void deinterleave(const double * x, size_t n, double * even, double * odd){
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256d a = _mm256_loadu_pd(x + 2 * i);
+        __m256d b = _mm256_loadu_pd(x + 2 * i + 4);
+        // per 128-bit lane: a0 b0 | a2 b2, then reorder the quarters
+        _mm256_storeu_pd(even + i, _mm256_permute4x64_pd(_mm256_unpacklo_pd(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_pd(odd + i, _mm256_permute4x64_pd(_mm256_unpackhi_pd(a, b), _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    deinterleave_scalar(x + 2 * i, n - i, even + i, odd + i);
+}
+template <>
+inline void interleave(const float * even, const float * odd, size_t n, float * x){
+    size_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m256 e = _mm256_loadu_ps(even + i);
+        __m256 o = _mm256_loadu_ps(odd + i);
+        // per 128-bit lane: e0 o0 e1 o1 | e4 o4 e5 o5 and e2 o2 e3 o3 | e6 o6 e7 o7
+        __m256 low = _mm256_unpacklo_ps(e, o);
+        __m256 high = _mm256_unpackhi_ps(e, o);
+        _mm256_storeu_ps(x + 2 * i, _mm256_permute2f128_ps(low, high, 0x20));
+        _mm256_storeu_ps(x + 2 * i + 8, _mm256_permute2f128_ps(low, high, 0x31));
+    }
+    interleave_scalar(even + i, odd + i, n - i, x + 2 * i);
+}
+template <>
+inline void interleave(const double * even, const double * odd, size_t n, double * x){
+    size_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m256d e = _mm256_loadu_pd(even + i);
+        __m256d o = _mm256_loadu_pd(odd + i);
+        __m256d low = _mm256_unpacklo_pd(e, o);
+        __m256d high = _mm256_unpackhi_pd(e, o);
+        _mm256_storeu_pd(x + 2 * i, _mm256_permute2f128_pd(low, high, 0x20));
+        _mm256_storeu_pd(x + 2 * i + 4, _mm256_permute2f128_pd(low, high, 0x31));
+    }
+    interleave_scalar(even + i, odd + i, n - i, x + 2 * i);
+}
+#endif
+// the kernels above may write the even values over their input (even = x) and read the
+// odd values from behind the output (odd at x + n + 1 or later for interleave): every block
+// is loaded before it is stored and lands at or before the blocks still to be read;
+// this saves a pass in data_reorder_1D_rows and data_reverse_reorder_1D_rows, which for
+// the split only pays off where the kernels are vectorized: the compiler does not
+// vectorize the scalar loop over overlapping arrays
+#if defined(__AVX512F__) || defined(__AVX2__)
+const bool deinterleave_in_place = true;
+#else
+const bool deinterleave_in_place = false;
+#endif
+
 // switch the rows in the data for coherent memory access
 /*
 @params data_pos: starting position of data
@@ -90,16 +241,27 @@ void switch_rows_2D_by_buffer_reverse(T * data_pos, T * data_buffer, size_t n1,
 }
 
 // reorder the data to put all the coefficient to the back
+// stride: distance between adjacent data values
 template <class T>
-void data_reorder_1D(const T * data_pos, size_t n_nodal, size_t n_coeff, T * nodal_buffer, T * coeff_buffer){
+void data_reorder_1D(const T * data_pos, size_t n_nodal, size_t n_coeff, T * nodal_buffer, T * coeff_buffer, size_t stride=1){
     T * nodal_pos = nodal_buffer;
     T * coeff_pos = coeff_buffer;
     T const * cur_data_pos = data_pos;
-    for(int i=0; i<n_coeff; i++){
-        *(nodal_pos++) = *(cur_data_pos++);
-        *(coeff_pos++) = *(cur_data_pos++);
+    if(stride == 1){
+        deinterleave(data_pos, n_coeff, nodal_buffer, coeff_buffer);
+        nodal_pos += n_coeff;
+        coeff_pos += n_coeff;
+        cur_data_pos += 2 * n_coeff;
+    }
+    else{
+        for(int i=0; i<n_coeff; i++){
+            *(nodal_pos++) = cur_data_pos[0];
+            *(coeff_pos++) = cur_data_pos[stride];
+            cur_data_pos += 2 * stride;
+        }
     }
-    *(nodal_pos++) = *(cur_data_pos++);
+    *(nodal_pos++) = cur_data_pos[0];
+    cur_data_pos += stride;
     if(n_nodal == n_coeff + 2){
         // if even, add a nodal value such that the interpolant
         // of the last two nodal values equal to the last coefficient
@@ -107,41 +269,72 @@ void data_reorder_1D(const T * data_pos, size_t n_nodal, size_t n_coeff, T * nod
     }
 }
 
-// reorder the data to put all the coefficient to the back
-/*
-    oxoxo       oooxx       oooxx
-    xxxxx   (1) xxxxx   (2) oooxx
-    oxoxo   =>  oooxx   =>  oooxx
-    xxxxx       xxxxx       xxxxx
-    oxoxo       oooxx       xxxxx
-*/
+// rows reordered per call of data_reorder_1D_rows in data_reorder_2D
+const size_t reorder_batch_rows = 8;
+// reorder num_rows contiguous rows of n values (stride apart) in place, with num_rows x n
+// elements in buffer: the nodal values of every row are compacted at its front and the
+// coefficients gathered in buffer, then appended to all rows (with deinterleave_in_place;
+// otherwise whole rows are split into buffer and copied back)
 template <class T>
-void data_reorder_2D(T * data_pos, T * data_buffer, size_t n1, size_t n2, size_t stride){
-    size_t n1_nodal = (n1 >> 1) + 1;
-    size_t n1_coeff = n1 - n1_nodal;
-    size_t n2_nodal = (n2 >> 1) + 1;
-    size_t n2_coeff = n2 - n2_nodal;
-    T * cur_data_pos = data_pos;
-    T * nodal_pos = data_buffer;
-    T * coeff_pos = data_buffer + n2_nodal;
-    // do reorder (1)
-    for(int i=0; i<n1; i++){
-        data_reorder_1D(cur_data_pos, n2_nodal, n2_coeff, nodal_pos, coeff_pos);
-        memcpy(cur_data_pos, data_buffer, n2 * sizeof(T));
-        cur_data_pos += stride;
+void data_reorder_1D_rows(T * data_pos, T * buffer, size_t n, size_t num_rows, size_t stride){
+    size_t n_nodal = (n >> 1) + 1;
+    size_t n_coeff = n - n_nodal;
+    if(!deinterleave_in_place){
+        for(size_t i=0; i<num_rows; i++){
+            data_reorder_1D(data_pos + i * stride, n_nodal, n_coeff, buffer + i * n, buffer + i * n + n_nodal);
+        }
+        for(size_t i=0; i<num_rows; i++){
+            memcpy(data_pos + i * stride, buffer + i * n, n * sizeof(T));
+        }
+        return;
+    }
+    for(size_t i=0; i<num_rows; i++){
+        data_reorder_1D(data_pos + i * stride, n_nodal, n_coeff, data_pos + i * stride, buffer + i * n_coeff);
+    }
+    for(size_t i=0; i<num_rows; i++){
+        memcpy(data_pos + i * stride + n_nodal, buffer + i * n_coeff, n_coeff * sizeof(T));
+    }
+}
+
+// reorder (1) of data_reorder_2D: every row on its own
+// the n1 rows are stride apart, so this also reorders the rows of one index
+// across the planes of a 3D block (stride = dim0_stride)
+template <class T>
+void data_reorder_2D_rows(T * data_pos, T * data_buffer, size_t n1, size_t n2, size_t stride){
+    for(size_t i=0; i<n1; i+=reorder_batch_rows){
+        size_t num_rows = min(reorder_batch_rows, n1 - i);
+        data_reorder_1D_rows(data_pos + i * stride, data_buffer, n2, num_rows, stride);
     }
+}
+
+// reorder (2) of data_reorder_2D, after data_reorder_2D_rows
+template <class T>
+void data_reorder_2D_columns(T * data_pos, T * data_buffer, size_t n1, size_t n2, size_t stride){
     if(!(n1 & 1)){
         // n1 is even, change the last coeff row into nodal row
-        cur_data_pos -= stride;
+        T * cur_data_pos = data_pos + (n1 - 1) * stride;
         for(int j=0; j<n2; j++){
             cur_data_pos[j] = 2 * cur_data_pos[j] - cur_data_pos[-stride + j];
         }
     }
-    // do reorder (2)
     // TODO: change to online processing for memory saving
     switch_rows_2D_by_buffer(data_pos, data_buffer, n1, n2, stride);
 }
 
+// reorder the data to put all the coefficient to the back
+/*
+    oxoxo       oooxx       oooxx
+    xxxxx   (1) xxxxx   (2) oooxx
+    oxoxo   =>  oooxx   =>  oooxx
+    xxxxx       xxxxx       xxxxx
+    oxoxo       oooxx       xxxxx
+*/
+template <class T>
+void data_reorder_2D(T * data_pos, T * data_buffer, size_t n1, size_t n2, size_t stride){
+    data_reorder_2D_rows(data_pos, data_buffer, n1, n2, stride);
+    data_reorder_2D_columns(data_pos, data_buffer, n1, n2, stride);
+}
+
 /*
     2D reorder + vertical reorder
 */
@@ -178,16 +371,27 @@ void data_reorder_3D(T * data_pos, T * data_buffer, size_t n1, size_t n2, size_t
 }
 
 // reorder the data to original order (insert coeffcients between nodal values)
+// stride: distance between adjacent data values
 template <class T>
-void data_reverse_reorder_1D(T * data_pos, int n_nodal, int n_coeff, const T * nodal_buffer, const T * coeff_buffer){
+void data_reverse_reorder_1D(T * data_pos, int n_nodal, int n_coeff, const T * nodal_buffer, const T * coeff_buffer, size_t stride=1){
     const T * nodal_pos = nodal_buffer;
     const T * coeff_pos = coeff_buffer;
     T * cur_data_pos = data_pos;
-    for(int i=0; i<n_coeff; i++){
-        *(cur_data_pos++) = *(nodal_pos++);
-        *(cur_data_pos++) = *(coeff_pos++);
+    if(stride == 1){
+        interleave(nodal_buffer, coeff_buffer, n_coeff, data_pos);
+        nodal_pos += n_coeff;
+        coeff_pos += n_coeff;
+        cur_data_pos += 2 * n_coeff;
+    }
+    else{
+        for(int i=0; i<n_coeff; i++){
+            cur_data_pos[0] = *(nodal_pos++);
+            cur_data_pos[stride] = *(coeff_pos++);
+            cur_data_pos += 2 * stride;
+        }
     }
-    *(cur_data_pos++) = *(nodal_pos++);
+    cur_data_pos[0] = *(nodal_pos++);
+    cur_data_pos += stride;
     if(n_nodal == n_coeff + 2){
         // if even, the last coefficient equals to the interpolant
         // of the last two nodal values
@@ -195,6 +399,20 @@ void data_reverse_reorder_1D(T * data_pos, int n_nodal, int n_coeff, const T * n
     }
 }
 
+// inverse of data_reorder_1D_rows: the nodal values of all rows are saved in buffer,
+// and every row is interleaved from them and its own coefficients, in place
+template <class T>
+void data_reverse_reorder_1D_rows(T * data_pos, T * buffer, size_t n, size_t num_rows, size_t stride){
+    size_t n_nodal = (n >> 1) + 1;
+    size_t n_coeff = n - n_nodal;
+    for(size_t i=0; i<num_rows; i++){
+        memcpy(buffer + i * n_nodal, data_pos + i * stride, n_nodal * sizeof(T));
+    }
+    for(size_t i=0; i<num_rows; i++){
+        data_reverse_reorder_1D(data_pos + i * stride, n_nodal, n_coeff, buffer + i * n_nodal, data_pos + i * stride + n_nodal);
+    }
+}
+
 /*
     oooxx       oooxx       oxoxo
     oooxx   (1) xxxxx   (2) xxxxo
@@ -209,16 +427,14 @@ void data_reverse_reorder_2D(T * data_pos, T * data_buffer, size_t n1, size_t n2
     size_t n2_nodal = (n2 >> 1) + 1;
     size_t n2_coeff = n2 - n2_nodal;
     T * cur_data_pos = data_pos;
-    T * nodal_pos = data_buffer;
-    T * coeff_pos = data_buffer + n2_nodal;
     // do reorder (1)
     // TODO: change to online processing for memory saving
     switch_rows_2D_by_buffer_reverse(data_pos, data_buffer, n1, n2, stride);
     // do reorder (2)
-    for(int i=0; i<n1; i++){
-        memcpy(data_buffer, cur_data_pos, n2 * sizeof(T));
-        data_reverse_reorder_1D(cur_data_pos, n2_nodal, n2_coeff, nodal_pos, coeff_pos);
-        cur_data_pos += stride;
+    for(size_t i=0; i<n1; i+=reorder_batch_rows){
+        size_t num_rows = min(reorder_batch_rows, n1 - i);
+        data_reverse_reorder_1D_rows(cur_data_pos, data_buffer, n2, num_rows, stride);
+        cur_data_pos += num_rows * stride;
     }
     if(!(n1 & 1)){
         // n1 is even, recover the coefficients
@@ -264,5 +480,37 @@ void data_reverse_reorder_3D(T * data_pos, T * data_buffer, size_t n1, size_t n2
     }
 }
 
+// copy num_lines lines of n values (line_stride apart) into block, with entry i of
+// line j at block[i * num_lines + j], so that the lines can be processed as columns
+template <class T>
+void interleave_lines(const T * data_pos, size_t n, size_t num_lines, size_t line_stride, T * block){
+    // in tiles of rows, so that the rows written stay in cache across lines
+    const size_t tile = 64;
+    for(size_t i0=0; i0<n; i0+=tile){
+        size_t i1 = min(n, i0 + tile);
+        for(size_t j=0; j<num_lines; j++){
+            const T * line = data_pos + j * line_stride;
+            for(size_t i=i0; i<i1; i++){
+                block[i * num_lines + j] = line[i];
+            }
+        }
+    }
+}
+
+// inverse operation for interleave_lines
+template <class T>
+void deinterleave_lines(const T * block, size_t n, size_t num_lines, size_t line_stride, T * data_pos){
+    const size_t tile = 64;
+    for(size_t i0=0; i0<n; i0+=tile){
+        size_t i1 = min(n, i0 + tile);
+        for(size_t j=0; j<num_lines; j++){
+            T * line = data_pos + j * line_stride;
+            for(size_t i=i0; i<i1; i++){
+                line[i] = block[i * num_lines + j];
+            }
+        }
+    }
+}
+
 }
-#endif
\ No newline at end of file
+#endif
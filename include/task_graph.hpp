@@ -0,0 +1,137 @@
+#ifndef _MGARD_TASK_GRAPH_HPP
+#define _MGARD_TASK_GRAPH_HPP
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// the tasks that finish one level of a multilevel task graph: slabs[s] finishes
+// slab s of [0, n) along the dimension the next level starts with (as split by
+// Decomposer::add_slab_tasks), so that each slab of the next level only waits for
+// the slabs it reads; a single task (n = 0) finishes the whole level
+// shared (if >= 0) is the task after which the level no longer uses the workspaces
+// shared by all slabs, for slabs of the next level that read none of [0, n);
+// without it, such slabs wait for all of slabs
+struct LevelTasks{
+    vector<int> slabs;
+    size_t n = 0;
+    int shared = -1;
+    LevelTasks() = default;
+    LevelTasks(int task) : slabs(1, task), shared(task){}
+    LevelTasks(const vector<int>& slabs_, size_t n_, int shared_) : slabs(slabs_), n(n_), shared(shared_){}
+};
+
+// directed acyclic graph of tasks executed on a ThreadPool
+// a task is released as soon as all its predecessors are finished, so
+// independent chains proceed without global barriers
+class TaskGraph{
+public:
+    // add a task and return its id
+    int add_task(function<void()> func){
+        nodes.push_back(Node());
+        nodes.back().func = func;
+        return nodes.size() - 1;
+    }
+    // task after cannot start before task before is finished
+    void add_dependency(int before, int after){
+        nodes[before].successors.push_back(after);
+        nodes[after].num_predecessors ++;
+    }
+    // add an empty task that depends on all given tasks and return its id
+    // used to express all-to-all dependencies with a linear number of edges
+    int add_join(const vector<int>& tasks){
+        int join = add_task(function<void()>());
+        for(const auto& t:tasks){
+            add_dependency(t, join);
+        }
+        return join;
+    }
+    size_t size() const{
+        return nodes.size();
+    }
+    // execute all tasks and return when they are finished
+    // without a pool the tasks run in insertion order, which must be a topological order
+    // the calling thread only executes tasks of this graph, so run may be called from a task
+    void run(ThreadPool * pool){
+        if(!pool){
+            for(auto& node:nodes){
+                if(node.func) node.func();
+            }
+            return;
+        }
+        auto state = make_shared<RunState>(nodes.size());
+        for(int i=0; i<nodes.size(); i++){
+            state->remaining[i] = nodes[i].num_predecessors;
+        }
+        for(int i=0; i<nodes.size(); i++){
+            if(nodes[i].num_predecessors == 0) release(*pool, state, i);
+        }
+        // run ready tasks, and sleep while the workers hold all of them
+        while(state->num_finished.load() < nodes.size()){
+            if(run_one(*pool, state)) continue;
+            unique_lock<mutex> lock(state->ready_mutex);
+            state->ready_cv.wait(lock, [&]{ return !state->ready.empty() || (state->num_finished.load() == state->remaining.size()); });
+        }
+    }
+    void clear(){
+        nodes.clear();
+    }
+
+private:
+    struct Node{
+        function<void()> func;
+        vector<int> successors;
+        int num_predecessors = 0;
+    };
+    struct RunState{
+        mutex ready_mutex;
+        condition_variable ready_cv;     // signaled on new ready tasks and on the last finished one
+        deque<int> ready;
+        vector<atomic<int>> remaining;
+        atomic<size_t> num_finished{0};
+        RunState(size_t n) : remaining(n){}
+    };
+    vector<Node> nodes;
+
+    // push a task to the ready queue and wake a worker for it
+    void release(ThreadPool& pool, const shared_ptr<RunState>& state, int id){
+        {
+            unique_lock<mutex> lock(state->ready_mutex);
+            state->ready.push_back(id);
+        }
+        state->ready_cv.notify_one();
+        pool.submit([this, &pool, state]{ run_one(pool, state); });
+    }
+    bool run_one(ThreadPool& pool, const shared_ptr<RunState>& state){
+        int id = -1;
+        {
+            unique_lock<mutex> lock(state->ready_mutex);
+            if(state->ready.empty()) return false;
+            id = state->ready.back();
+            state->ready.pop_back();
+        }
+        Node& node = nodes[id];
+        if(node.func) node.func();
+        for(const auto& s:node.successors){
+            if(-- state->remaining[s] == 0) release(pool, state, s);
+        }
+        if(++ state->num_finished == state->remaining.size()){
+            unique_lock<mutex> lock(state->ready_mutex);
+            state->ready_cv.notify_all();
+        }
+        return true;
+    }
+};
+
+}
+#endif
@@ -0,0 +1,177 @@
+#ifndef _MGARD_TEMPORAL_HPP
+#define _MGARD_TEMPORAL_HPP
+
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "error_estimator.hpp"
+#include "thread_pool.hpp"
+
+namespace MGARD{
+
+using namespace std;
+
+// quantized coefficients of one timestep, see TemporalDecomposer
+// codes[p] = q + radius for |q| < radius, and 0 for coefficients stored as is in
+// unpredictable (in index order), as in LorenzoCodes
+template <class T>
+struct TemporalFrame{
+    size_t step = 0;
+    bool key_frame = true;      // codes of the coefficients themselves, not of residuals
+    int radius = 1 << 20;
+    vector<int> codes;
+    vector<T> unpredictable;
+};
+
+// bin width 2 eb[l] of each level; the last bound applies to the levels beyond eb
+inline vector<double> get_temporal_bin_width(const vector<double>& eb, size_t target_level){
+    vector<double> bin_width(target_level + 1);
+    for(size_t l=0; l<=target_level; l++){
+        bin_width[l] = 2 * eb[min(l, eb.size() - 1)];
+    }
+    return bin_width;
+}
+
+/*
+    decomposition of a time series of fields with the same shape
+    the coefficients of a step are quantized as residuals against the reconstructed
+    coefficients of the previous step, per level with bin width 2 eb[l]; the reference
+    is what the decoder reconstructs, not the exact previous step, so quantization
+    errors do not accumulate: every step has coefficient errors <= eb[l] on level l
+    (see ErrorEstimator for the resulting reconstruction error)
+    levels with eb[l] <= 0 (the default) are lossless: their coefficients are stored as is
+    every key_frame_interval steps the reference is reset to 0 (a key frame), so that
+    step t is recomposed from the frames of the last key frame up to t
+    the only state kept across steps is the reference, one field of coefficients
+*/
+template <class T>
+class TemporalDecomposer{
+public:
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+        decomposer.set_thread_pool(pool_);
+    }
+    void set_solver_mode(SolverMode mode){
+        decomposer.set_solver_mode(mode);
+    }
+    // coefficient error bound of each level, from the coarsest level 0; the last bound
+    // applies to the levels beyond the vector, and bounds <= 0 store the level as is
+    void set_error_bounds(const vector<double>& eb_){
+        eb = eb_;
+    }
+    void set_error_bound(double eb_){
+        eb.assign(1, eb_);
+    }
+    // number of steps from one key frame to the next (1: every step is a key frame)
+    void set_key_frame_interval(size_t interval){
+        key_frame_interval = max((size_t) 1, interval);
+    }
+    // start a new series: the next step is a key frame
+    void reset(){
+        step = 0;
+    }
+    // decompose the next step in place and quantize its coefficients into frame
+    // data (dense row-major) receives the reconstructed coefficients
+    int decompose(T * data, const vector<size_t>& dims, size_t target_level, TemporalFrame<T>& frame, bool hierarchical=false){
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        size_t num_elements = 1;
+        for(const auto& d:dims){
+            num_elements *= d;
+        }
+        int levels = decomposer.decompose(data, dims, target_level, hierarchical);
+        frame.step = step;
+        frame.key_frame = (step % key_frame_interval == 0) || (reference.size() != num_elements);
+        if(frame.key_frame) reference.assign(num_elements, 0);
+        auto level_dims = init_levels(dims, target_level);
+        vector<double> bin_width = get_temporal_bin_width(eb, target_level);
+        frame.codes.resize(num_elements);
+        double radius = frame.radius;
+        for_each_level_value(dims, level_dims, pool, [&](size_t b, size_t p, int l){
+            frame.codes[p] = 0;
+            if(bin_width[l] > 0){
+                double q = round((data[p] - reference[p]) / bin_width[l]);
+                T recon = reference[p] + (T) (q * bin_width[l]);
+                if((fabs(q) < radius) && (fabs(data[p] - recon) <= bin_width[l] / 2)){
+                    frame.codes[p] = (int) q + frame.radius;
+                    data[p] = recon;
+                }
+            }
+            reference[p] = data[p];
+        });
+        frame.unpredictable.clear();
+        for(size_t p=0; p<num_elements; p++){
+            if(frame.codes[p] == 0) frame.unpredictable.push_back(data[p]);
+        }
+        step ++;
+        return levels;
+    }
+
+private:
+    ThreadPool * pool = NULL;
+    Decomposer<T> decomposer;
+    vector<double> eb = vector<double>(1, 0);
+    size_t key_frame_interval = 16;
+    size_t step = 0;
+    vector<T> reference;    // reconstructed coefficients of the previous step
+};
+
+template <class T>
+class TemporalRecomposer{
+public:
+    void set_thread_pool(ThreadPool * pool_){
+        pool = pool_;
+        recomposer.set_thread_pool(pool_);
+    }
+    void set_solver_mode(SolverMode mode){
+        recomposer.set_solver_mode(mode);
+    }
+    // same bounds as given to TemporalDecomposer
+    void set_error_bounds(const vector<double>& eb_){
+        eb = eb_;
+    }
+    void set_error_bound(double eb_){
+        eb.assign(1, eb_);
+    }
+    // recompose frame into data (dense row-major)
+    // frames must be given in order from a key frame; returns false (and leaves data
+    // unchanged) for a frame that does not follow the previous one
+    bool recompose(const TemporalFrame<T>& frame, const vector<size_t>& dims, size_t target_level, T * data, bool hierarchical=false){
+        if(target_level > get_max_level(dims)) target_level = get_max_level(dims);
+        size_t num_elements = 1;
+        for(const auto& d:dims){
+            num_elements *= d;
+        }
+        if(!frame.key_frame && ((reference.size() != num_elements) || (frame.step != step + 1))){
+            cerr << "temporal frame " << frame.step << " does not follow the previous frame\n";
+            return false;
+        }
+        if(frame.key_frame) reference.assign(num_elements, 0);
+        // coefficients stored as is
+        const T * unpredictable = frame.unpredictable.data();
+        for(size_t p=0; p<num_elements; p++){
+            if(frame.codes[p] == 0) reference[p] = *(unpredictable ++);
+        }
+        auto level_dims = init_levels(dims, target_level);
+        vector<double> bin_width = get_temporal_bin_width(eb, target_level);
+        int radius = frame.radius;
+        for_each_level_value(dims, level_dims, pool, [&](size_t b, size_t p, int l){
+            if(frame.codes[p]) reference[p] = reference[p] + (T) ((double) (frame.codes[p] - radius) * bin_width[l]);
+            data[p] = reference[p];
+        });
+        step = frame.step;
+        recomposer.recompose(data, dims, target_level, hierarchical);
+        return true;
+    }
+
+private:
+    ThreadPool * pool = NULL;
+    Recomposer<T> recomposer;
+    vector<double> eb = vector<double>(1, 0);
+    size_t step = 0;
+    vector<T> reference;    // reconstructed coefficients of the previous frame
+};
+
+}
+#endif
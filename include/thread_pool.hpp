@@ -0,0 +1,224 @@
+#ifndef _MGARD_THREAD_POOL_HPP
+#define _MGARD_THREAD_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace MGARD{
+
+using namespace std;
+
+// fixed-size work-stealing pool
+// each worker owns a deque: it pops its own tasks from the back and
+// steals from the front of the other deques when it runs dry
+class ThreadPool{
+public:
+    ThreadPool(int num_threads_=1){
+        if(num_threads_ < 1) num_threads_ = 1;
+        for(int i=0; i<num_threads_; i++){
+            queues.push_back(unique_ptr<WorkQueue>(new WorkQueue()));
+        }
+        for(int i=0; i<num_threads_; i++){
+            workers.push_back(thread(&ThreadPool::worker_loop, this, i));
+        }
+    }
+    ~ThreadPool(){
+        {
+            unique_lock<mutex> lock(sleep_mutex);
+            stop = true;
+        }
+        sleep_cv.notify_all();
+        for(auto& w:workers){
+            w.join();
+        }
+    }
+    // enqueue a task, returns immediately
+    // tasks submitted by a worker go to its own deque, others are spread round-robin
+    void submit(function<void()> task){
+        int index = thread_index();
+        if(index == num_threads()) index = (next_queue ++) % num_threads();
+        num_unfinished ++;
+        {
+            unique_lock<mutex> lock(queues[index]->queue_mutex);
+            queues[index]->tasks.push_back(task);
+        }
+        {
+            unique_lock<mutex> lock(sleep_mutex);
+            num_queued ++;
+        }
+        sleep_cv.notify_one();
+    }
+    // block until all submitted tasks are finished
+    void wait(){
+        unique_lock<mutex> lock(sleep_mutex);
+        idle_cv.wait(lock, [this]{ return num_unfinished == 0; });
+    }
+    // run func(i) for i in [begin, end) in chunks of grain iterations
+    // the calling thread takes part and only ever executes chunks of this loop,
+    // so it is safe to call from inside a task (nested parallelism)
+    void parallel_for(size_t begin, size_t end, const function<void(size_t)>& func, size_t grain=1){
+        if(end <= begin) return;
+        if(grain < 1) grain = 1;
+        size_t num_chunks = (end - begin + grain - 1) / grain;
+        if(num_chunks == 1){
+            for(size_t i=begin; i<end; i++) func(i);
+            return;
+        }
+        auto loop = make_shared<LoopState>();
+        loop->begin = begin, loop->end = end, loop->grain = grain;
+        loop->num_chunks = num_chunks;
+        loop->func = &func;
+        int num_helpers = min((size_t) num_threads(), num_chunks - 1);
+        for(int i=0; i<num_helpers; i++){
+            submit([loop]{ run_chunks(*loop); });
+        }
+        run_chunks(*loop);
+        // chunks claimed by helpers may still be running: sleep until the last one is done
+        unique_lock<mutex> lock(loop->done_mutex);
+        loop->done_cv.wait(lock, [&]{ return loop->num_finished.load() == num_chunks; });
+    }
+    // run func(i) on worker i for every worker and return when all are done, e.g. to
+    // place memory by first touch; called from a worker of this pool, it falls back to
+    // parallel_for, as waiting for a busy worker could deadlock
+    void run_on_workers(const function<void(int)>& func){
+        int n = num_threads();
+        if(thread_index() < n){
+            parallel_for(0, n, [&](size_t i){ func(i); });
+            return;
+        }
+        auto done = make_shared<PinnedState>();
+        for(int i=0; i<n; i++){
+            num_unfinished ++;
+            {
+                unique_lock<mutex> lock(sleep_mutex);
+                queues[i]->pinned.push_back([done, &func, i, n]{
+                    func(i);
+                    if(++ done->num_finished == n){
+                        unique_lock<mutex> lock(done->done_mutex);
+                        done->done_cv.notify_all();
+                    }
+                });
+            }
+        }
+        // the condition variable is shared, so wake every worker to find its task
+        sleep_cv.notify_all();
+        unique_lock<mutex> lock(done->done_mutex);
+        done->done_cv.wait(lock, [&]{ return done->num_finished.load() == n; });
+    }
+    int num_threads() const{
+        return workers.size();
+    }
+    // index of the calling thread: [0, num_threads()) for workers, num_threads() otherwise
+    int thread_index() const{
+        return (current_pool() == this) ? current_index() : num_threads();
+    }
+
+private:
+    struct WorkQueue{
+        mutex queue_mutex;
+        deque<function<void()>> tasks;
+        deque<function<void()>> pinned;     // only run by the owner, protected by sleep_mutex
+    };
+    struct PinnedState{
+        atomic<int> num_finished{0};
+        mutex done_mutex;
+        condition_variable done_cv;
+    };
+    struct LoopState{
+        size_t begin, end, grain, num_chunks;
+        atomic<size_t> next_chunk{0};
+        atomic<size_t> num_finished{0};
+        const function<void(size_t)> * func;
+        mutex done_mutex;
+        condition_variable done_cv;
+    };
+    vector<thread> workers;
+    vector<unique_ptr<WorkQueue>> queues;
+    mutex sleep_mutex;
+    condition_variable sleep_cv;
+    condition_variable idle_cv;
+    size_t num_queued = 0;              // tasks sitting in a deque, protected by sleep_mutex
+    atomic<size_t> num_unfinished{0};   // tasks submitted but not finished
+    atomic<size_t> next_queue{0};
+    bool stop = false;
+
+    static ThreadPool *& current_pool(){
+        static thread_local ThreadPool * pool = NULL;
+        return pool;
+    }
+    static int& current_index(){
+        static thread_local int index = -1;
+        return index;
+    }
+    static void run_chunks(LoopState& loop){
+        while(true){
+            size_t chunk = loop.next_chunk ++;
+            if(chunk >= loop.num_chunks) return;
+            size_t chunk_begin = loop.begin + chunk * loop.grain;
+            size_t chunk_end = min(chunk_begin + loop.grain, loop.end);
+            for(size_t i=chunk_begin; i<chunk_end; i++){
+                (*loop.func)(i);
+            }
+            if(++ loop.num_finished == loop.num_chunks){
+                // taking the mutex orders the notification after the check of the waiter
+                unique_lock<mutex> lock(loop.done_mutex);
+                loop.done_cv.notify_all();
+            }
+        }
+    }
+    // pop from the back of the own deque, otherwise steal from the front of others
+    bool take_task(int index, function<void()>& task){
+        int n = num_threads();
+        for(int k=0; k<n; k++){
+            WorkQueue& queue = *queues[(index + k) % n];
+            unique_lock<mutex> lock(queue.queue_mutex);
+            if(queue.tasks.empty()) continue;
+            if(k == 0){
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            else{
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+    void worker_loop(int index){
+        current_pool() = this;
+        current_index() = index;
+        WorkQueue& own = *queues[index];
+        while(true){
+            function<void()> task;
+            {
+                unique_lock<mutex> lock(sleep_mutex);
+                sleep_cv.wait(lock, [&]{ return stop || (num_queued > 0) || !own.pinned.empty(); });
+                if(!own.pinned.empty()){
+                    task = own.pinned.front();
+                    own.pinned.pop_front();
+                }
+                else if(stop && num_queued == 0) return;
+            }
+            if(!task){
+                if(!take_task(index, task)) continue;
+                unique_lock<mutex> lock(sleep_mutex);
+                num_queued --;
+            }
+            task();
+            if(-- num_unfinished == 0){
+                unique_lock<mutex> lock(sleep_mutex);
+                idle_cv.notify_all();
+            }
+        }
+    }
+};
+
+}
+#endif
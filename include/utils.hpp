@@ -5,6 +5,10 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <iostream>
+#include <cmath>
+#include <algorithm>
+#include "metrics.hpp"
 
 namespace MGARD{
 
@@ -69,54 +73,138 @@ void print(const vector<vector<T>>& data){
     }
     cout << endl;
 }
+// see compute_metrics in metrics.hpp for the values without printing
 template <class T>
 void print_statistics(const T * data_ori, const T * data_dec, size_t data_size){
-    double max_val = data_ori[0];
-    double min_val = data_ori[0];
-    double max_abs = fabs(data_ori[0]);
-    for(int i=0; i<data_size; i++){
-        if(data_ori[i] > max_val) max_val = data_ori[i];
-        if(data_ori[i] < min_val) min_val = data_ori[i];
-        if(fabs(data_ori[i]) > max_abs) max_abs = fabs(data_ori[i]);
-    }
-    double max_err = 0;
-    int pos = 0;
-    double mse = 0;
-    for(int i=0; i<data_size; i++){
-        double err = data_ori[i] - data_dec[i];
-        mse += err * err;
-        if(fabs(err) > max_err){
-            pos = i;
-            max_err = fabs(err);
-        }
-    }
-    mse /= data_size;
-    double psnr = 20 * log10((max_val - min_val) / sqrt(mse));
-    cout << "Max value = " << max_val << ", min value = " << min_val << endl;
-    cout << "Max error = " << max_err << ", pos = " << pos << endl;
-    cout << "MSE = " << mse << ", PSNR = " << psnr << endl;
+    print_metrics(compute_metrics(data_ori, data_dec, data_size));
+}
+// same as above with the metrics reduced in parallel on pool
+template <class T>
+void print_statistics_parallel(const T * data_ori, const T * data_dec, size_t data_size, ThreadPool * pool){
+    print_metrics(compute_metrics(data_ori, data_dec, data_size, pool));
 }
 template <class T>
 void print_statistics(const T * data_ori, const T * data_dec, size_t data_size, size_t compressed_size){
     print_statistics(data_ori, data_dec, data_size);
     cout << "Compression ratio = " << data_size * sizeof(T) * 1.0 / compressed_size << endl;
 }
+// strides of a dense row-major array (last dimension contiguous)
+// for a subarray, e.g. the interior of a ghost-cell padded buffer, pass the
+// strides of the padded dimensions and a pointer to the first interior value
+inline vector<size_t> init_strides(const vector<size_t>& dims){
+    vector<size_t> strides(dims.size());
+    size_t stride = 1;
+    for(int i=dims.size()-1; i>=0; i--){
+        strides[i] = stride;
+        stride *= dims[i];
+    }
+    return strides;
+}
+// strides of a dense column-major (Fortran order) array, first dimension contiguous
+inline vector<size_t> init_column_major_strides(const vector<size_t>& dims){
+    vector<size_t> strides(dims.size());
+    size_t stride = 1;
+    for(int i=0; i<dims.size(); i++){
+        strides[i] = stride;
+        stride *= dims[i];
+    }
+    return strides;
+}
+// order of dimensions by decreasing stride (ties keep their order)
+inline vector<size_t> get_stride_order(const vector<size_t>& strides){
+    vector<size_t> order(strides.size());
+    for(int i=0; i<order.size(); i++) order[i] = i;
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){
+        return strides[a] > strides[b];
+    });
+    return order;
+}
+inline vector<size_t> permute(const vector<size_t>& v, const vector<size_t>& order){
+    vector<size_t> result(order.size());
+    for(int i=0; i<order.size(); i++) result[i] = v[order[i]];
+    return result;
+}
+// copy n contiguous values to positions dst[i * stride]
+template <class T>
+void copy_to_strided(const T * src, size_t n, T * dst, size_t stride){
+    if(stride == 1){
+        memcpy(dst, src, n * sizeof(T));
+        return;
+    }
+    for(size_t i=0; i<n; i++){
+        dst[i * stride] = src[i];
+    }
+}
+// copy values src[i * stride] to n contiguous positions
+template <class T>
+void copy_from_strided(const T * src, size_t stride, size_t n, T * dst){
+    if(stride == 1){
+        memcpy(dst, src, n * sizeof(T));
+        return;
+    }
+    for(size_t i=0; i<n; i++){
+        dst[i] = src[i * stride];
+    }
+}
+// copy an array of up to 3 dimensions between two strided layouts
+template <class T>
+void data_copy_strided(const T * src, const vector<size_t>& src_strides, const vector<size_t>& dims, T * dst, const vector<size_t>& dst_strides){
+    // pad to 3 dimensions with leading dimensions of size 1
+    size_t n[3] = {1, 1, 1}, s[3] = {0, 0, 0}, d[3] = {0, 0, 0};
+    int offset = 3 - dims.size();
+    for(int i=0; i<dims.size(); i++){
+        n[offset + i] = dims[i];
+        s[offset + i] = src_strides[i];
+        d[offset + i] = dst_strides[i];
+    }
+    for(size_t i=0; i<n[0]; i++){
+        for(size_t j=0; j<n[1]; j++){
+            const T * src_pos = src + i * s[0] + j * s[1];
+            T * dst_pos = dst + i * d[0] + j * d[1];
+            if((s[2] == 1) && (d[2] == 1)){
+                memcpy(dst_pos, src_pos, n[2] * sizeof(T));
+            }
+            else{
+                for(size_t k=0; k<n[2]; k++){
+                    dst_pos[k * d[2]] = src_pos[k * s[2]];
+                }
+            }
+        }
+    }
+}
+// number of levels a dimension of size n can be coarsened
+inline size_t get_max_level(size_t n){
+    return (n > 2) ? (size_t) log2(n) : 0;
+}
+// number of levels of a decomposition, limited by the largest dimension
+inline size_t get_max_level(const vector<size_t>& dims){
+    size_t max_level = 0;
+    for(const auto& d:dims){
+        max_level = max(max_level, get_max_level(d));
+    }
+    return max_level;
+}
 // compute dimensions for each level
+// each dimension is coarsened in the first min(target_level, get_max_level(n))
+// levels and kept afterwards, so thin dimensions stop being coarsened once
+// they are exhausted while the others keep going
 /*
 @params dims: dimensions
-@params target_level: number of levels to perform
+@params target_level: number of levels to perform, at most get_max_level(dims)
+return dimensions of level 0 (coarsest) to target_level (original)
 */
-vector<vector<size_t>> init_levels(const vector<size_t>& dims, size_t target_level){
+inline vector<vector<size_t>> init_levels(const vector<size_t>& dims, size_t target_level){
     vector<vector<size_t>> level_dims;
     // compute n_nodal in each level
     for(int i=0; i<=target_level; i++){
         level_dims.push_back(vector<size_t>(dims.size()));
     }
     for(int i=0; i<dims.size(); i++){
-        int n = dims[i];
+        size_t n = dims[i];
+        size_t num_levels = min(target_level, get_max_level(n));
         for(int j=0; j<=target_level; j++){
             level_dims[target_level - j][i] = n;
-            n = (n >> 1) + 1;
+            if(j < num_levels) n = (n >> 1) + 1;
         }
     }
     return level_dims;
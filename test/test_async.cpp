@@ -0,0 +1,72 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <future>
+#include <atomic>
+#include "decompose.hpp"
+#include "async.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+vector<float> make_field(const vector<size_t>& dims, int seed){
+    size_t num_elements = get_num_elements(dims);
+    vector<float> field(num_elements);
+    for(size_t i=0; i<num_elements; i++){
+        field[i] = sin(0.01 * i + seed) + 0.1 * seed;
+    }
+    return field;
+}
+
+int main(int argc, char ** argv){
+    const vector<size_t> dims = {17, 20, 33};
+    const size_t target_level = 3;
+    const size_t depth = 2;
+    MGARD::AsyncDecomposer<float> async_decomposer(1, depth);
+    // the callback of the first field holds the only worker until released,
+    // so that every snapshot buffer is in use
+    promise<void> release;
+    shared_future<void> released = release.get_future().share();
+    atomic<int> callbacks(0);
+    vector<vector<float>> results(depth + 1);
+    auto callback = [&](const float * coeff, const vector<size_t>& d, int levels){
+        size_t n = get_num_elements(d);
+        int index = callbacks ++;
+        results[index].assign(coeff, coeff + n);
+        if(index == 0) released.wait();
+    };
+    vector<vector<float>> fields;
+    for(size_t i=0; i<=depth; i++){
+        fields.push_back(make_field(dims, i));
+    }
+    vector<future<int>> futures(depth + 1);
+    for(size_t i=0; i<depth; i++){
+        check(async_decomposer.try_submit(fields[i].data(), dims, target_level, futures[i], callback), "try_submit with a free slot succeeds");
+    }
+    check(async_decomposer.queue_depth() == depth, "queue_depth counts every queued field");
+    check(!async_decomposer.try_submit(fields[depth].data(), dims, target_level, futures[depth], callback), "try_submit fails when all slots are in use");
+    release.set_value();
+    async_decomposer.wait();
+    check(async_decomposer.queue_depth() == 0, "queue_depth is 0 after wait");
+    // the zero-copy path rejects a field that does not match dims
+    vector<float> short_field(fields[depth].begin(), fields[depth].end() - 1);
+    vector<float> short_copy(short_field);
+    future<int> rejected = async_decomposer.submit(short_field, dims, target_level, callback);
+    check(!rejected.valid() && (short_field == short_copy), "submit of a short vector is rejected and leaves it unchanged");
+    vector<float> moved(fields[depth]);
+    futures[depth] = async_decomposer.submit(moved, dims, target_level, callback);
+    for(size_t i=0; i<=depth; i++){
+        check(futures[i].get() == target_level, "future returns the number of levels");
+    }
+    check(callbacks == depth + 1, "callback runs once per field");
+    // fields are decomposed in submission order on the single worker
+    bool match = true;
+    for(size_t i=0; i<=depth; i++){
+        vector<float> expected(fields[i]);
+        MGARD::Decomposer<float> decomposer;
+        decomposer.decompose(expected.data(), dims, target_level);
+        match = match && (results[i] == expected);
+    }
+    check(match, "coefficients match the synchronous Decomposer");
+    return report();
+}
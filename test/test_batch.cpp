@@ -0,0 +1,75 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "decompose.hpp"
+#include "batch.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+// BatchDecomposer against one Decomposer per field: every field gets the levels and,
+// bitwise, the coefficients of its own decomposition, serial or, if it is nested on the
+// pool (min_nested_elements), on the same pool (long 1D lines then take the partitioned
+// solver, which differs by rounding), and the statistics add up; each batch runs twice
+// on the same decomposer, which keeps its per-thread workspaces
+template <class T>
+void test_batch(const vector<vector<size_t>>& shapes, bool hierarchical, int num_threads, size_t min_nested_elements){
+    string name = to_string(8 * sizeof(T)) + "-bit, " + to_string(shapes.size()) + " fields" + (hierarchical ? ", hierarchical" : "") + ", " + to_string(num_threads) + " threads, nested from " + to_string(min_nested_elements) + " values";
+    const size_t target_level = 10;
+    MGARD::ThreadPool pool(num_threads);
+    vector<vector<T>> data, expected, pooled_expected;
+    vector<int> expected_levels;
+    size_t num_elements = 0;
+    for(size_t i=0; i<shapes.size(); i++){
+        data.push_back(generate_data<T>(get_num_elements(shapes[i]), i + 1));
+        num_elements += data.back().size();
+        expected.push_back(data.back());
+        MGARD::Decomposer<T> decomposer;
+        expected_levels.push_back(decomposer.decompose(expected.back().data(), shapes[i], target_level, hierarchical));
+        pooled_expected.push_back(data.back());
+        MGARD::Decomposer<T> pooled_decomposer;
+        pooled_decomposer.set_thread_pool(&pool);
+        pooled_decomposer.decompose(pooled_expected.back().data(), shapes[i], target_level, hierarchical);
+    }
+    MGARD::BatchDecomposer<T> batch_decomposer(pool);
+    batch_decomposer.min_nested_elements = min_nested_elements;
+    for(int run=0; run<2; run++){
+        auto coeff = data;
+        vector<MGARD::BatchField<T>> fields;
+        for(size_t i=0; i<shapes.size(); i++){
+            fields.push_back(MGARD::BatchField<T>(coeff[i].data(), shapes[i], target_level));
+        }
+        auto stats = batch_decomposer.decompose(fields, hierarchical);
+        bool same = true;
+        double field_time = 0;
+        for(size_t i=0; i<shapes.size(); i++){
+            bool nested = (coeff[i].size() >= min_nested_elements) && (coeff[i] == pooled_expected[i]);
+            same = same && (fields[i].levels == expected_levels[i]) && ((coeff[i] == expected[i]) || nested);
+            field_time += fields[i].time;
+        }
+        check(same, name + ", run " + to_string(run) + ": fields equal their own decompositions");
+        check((stats.num_fields == shapes.size()) && (stats.num_elements == num_elements) && (stats.num_bytes == num_elements * sizeof(T)) && (stats.field_time == field_time) && (stats.min_field_time <= stats.max_field_time), name + ", run " + to_string(run) + ": statistics add up");
+    }
+}
+
+int main(int argc, char ** argv){
+    // mixed dimensions, repeated shapes and a field much larger than the others
+    vector<vector<size_t>> shapes = {{65, 64, 33}, {1000}, {33, 17, 9}, {129, 100}, {33, 17, 9}, {16, 16, 16}, {200003}, {64, 48}, {33, 17, 9}};
+    for(bool hierarchical:{false, true}){
+        for(int num_threads:{1, 3, 4}){
+            // no field nested, and every field above an even share of the batch nested
+            for(size_t min_nested_elements:{(size_t) 1 << 20, (size_t) 1}){
+                test_batch<float>(shapes, hierarchical, num_threads, min_nested_elements);
+                test_batch<double>(shapes, hierarchical, num_threads, min_nested_elements);
+            }
+        }
+    }
+    MGARD::ThreadPool pool(2);
+    MGARD::BatchDecomposer<float> batch_decomposer(pool);
+    vector<MGARD::BatchField<float>> fields;
+    auto stats = batch_decomposer.decompose(fields);
+    check((stats.num_fields == 0) && (stats.num_elements == 0), "empty batch");
+    return report();
+}
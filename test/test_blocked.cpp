@@ -0,0 +1,121 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "blocked.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+// position in the domain of value i of the dense row-major array of block
+size_t get_domain_position(const MGARD::Block& block, const vector<size_t>& strides, size_t i){
+    size_t pos = 0;
+    for(int k=block.dims.size()-1; k>=0; k--){
+        pos += (block.origin[k] + i % block.dims[k]) * strides[k];
+        i /= block.dims[k];
+    }
+    return pos;
+}
+
+// BlockedDecomposer and BlockedRecomposer with block_dims that do not divide dims:
+// the blocks cover the domain once, each block is the decomposition of its values
+// on their own, the pooled run equals the serial one and the round trip restores
+// the data up to rounding
+template <class T>
+void test_blocked(const vector<size_t>& dims, const vector<size_t>& block_dims, bool hierarchical, MGARD::ThreadPool * pool){
+    size_t num_elements = get_num_elements(dims);
+    auto data = generate_data<T>(num_elements, num_elements, 0.05);
+    string name = to_string(8 * sizeof(T)) + "-bit " + describe(dims) + ", blocks of " + describe(block_dims) + (hierarchical ? ", hierarchical" : "");
+    const size_t target_level = 10;
+    vector<T> coeff(num_elements);
+    MGARD::BlockedDecomposer<T> decomposer(block_dims);
+    auto index = decomposer.decompose(data.data(), dims, target_level, coeff.data(), hierarchical);
+    // every value in exactly one block, which find returns
+    auto strides = MGARD::init_strides(dims);
+    vector<int> count(num_elements, 0);
+    bool found = true;
+    size_t size = 0;
+    for(size_t id=0; id<index.blocks.size(); id++){
+        const auto& block = index.blocks[id];
+        found = found && (block.offset == size);
+        size_t block_size = get_num_elements(block.dims);
+        for(size_t i=0; i<block_size; i++){
+            size_t pos = get_domain_position(block, strides, i);
+            count[pos] ++;
+            vector<size_t> position(dims.size());
+            size_t rest = pos;
+            for(int k=dims.size()-1; k>=0; k--){
+                position[k] = rest % dims[k];
+                rest /= dims[k];
+            }
+            found = found && (index.find(position) == id);
+        }
+        size += block_size;
+    }
+    bool covered = (size == num_elements);
+    for(const auto& c:count) covered = covered && (c == 1);
+    check(covered && found, name + ": " + to_string(index.blocks.size()) + " blocks cover the domain once and are found by position");
+    // each block against a decomposition of its values alone
+    bool same_blocks = true;
+    for(const auto& block:index.blocks){
+        size_t block_size = get_num_elements(block.dims);
+        vector<T> block_data(block_size);
+        for(size_t i=0; i<block_size; i++){
+            block_data[i] = data[get_domain_position(block, strides, i)];
+        }
+        MGARD::Decomposer<T> block_decomposer;
+        int levels = block_decomposer.decompose(block_data.data(), block.dims, target_level, hierarchical);
+        same_blocks = same_blocks && (levels == block.levels) && equal(block_data.begin(), block_data.end(), coeff.begin() + block.offset);
+    }
+    check(same_blocks, name + ": blocks equal the decompositions of their values");
+    vector<T> pooled_coeff(num_elements);
+    MGARD::BlockedDecomposer<T> pooled_decomposer(block_dims);
+    pooled_decomposer.set_thread_pool(pool);
+    pooled_decomposer.decompose(data.data(), dims, target_level, pooled_coeff.data(), hierarchical);
+    check(pooled_coeff == coeff, name + ": pooled decomposition equals the serial one");
+    // recomposition of the whole domain and of single blocks
+    vector<T> recomposed(num_elements), pooled_recomposed(num_elements);
+    MGARD::BlockedRecomposer<T> recomposer;
+    recomposer.recompose(coeff.data(), index, recomposed.data());
+    MGARD::BlockedRecomposer<T> pooled_recomposer;
+    pooled_recomposer.set_thread_pool(pool);
+    pooled_recomposer.recompose(coeff.data(), index, pooled_recomposed.data());
+    check(pooled_recomposed == recomposed, name + ": pooled recomposition equals the serial one");
+    double error = 0, max_value = 0;
+    for(size_t i=0; i<num_elements; i++){
+        error = max(error, (double) fabs(recomposed[i] - data[i]));
+        max_value = max(max_value, (double) fabs(data[i]));
+    }
+    double ulps = error / (max_value * numeric_limits<T>::epsilon());
+    check(ulps <= 32, name + ": round trip within " + format(ulps) + " eps max|data|");
+    bool same_block_recomposition = true;
+    for(size_t id=0; id<index.blocks.size(); id+=3){
+        const auto& block = index.blocks[id];
+        vector<T> block_data(get_num_elements(block.dims));
+        recomposer.recompose_block(coeff.data(), index, id, block_data.data());
+        for(size_t i=0; i<block_data.size(); i++){
+            if(block_data[i] != recomposed[get_domain_position(block, strides, i)]) same_block_recomposition = false;
+        }
+    }
+    check(same_block_recomposition, name + ": single blocks recompose to their part of the domain");
+}
+
+int main(int argc, char ** argv){
+    MGARD::ThreadPool pool(3);
+    // remainders merged into the last tile (1000 = 15 * 64 + 40 is not, 100 = 3 * 32 + 4 is),
+    // and a domain smaller than one block
+    vector<pair<vector<size_t>, vector<size_t>>> cases = {
+        {{1000}, {64}}, {{130, 90}, {32, 32}}, {{20, 5}, {64, 64}},
+        {{100, 90, 45}, {32, 32, 32}}, {{33, 70, 17}, {16, 24, 8}}};
+    for(const auto& c:cases){
+        for(bool hierarchical:{false, true}){
+            test_blocked<float>(c.first, c.second, hierarchical, &pool);
+            test_blocked<double>(c.first, c.second, hierarchical, &pool);
+        }
+    }
+    return report();
+}
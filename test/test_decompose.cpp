@@ -4,8 +4,10 @@
 #include <vector>
 #include <iomanip>
 #include <cmath>
+#include <cstdint>
 #include "decompose.hpp"
 #include "recompose.hpp"
+#include "integer_lifting.hpp"
 
 using namespace std;
 
@@ -41,9 +43,30 @@ void test(string filename, const vector<size_t>& dims, int target_level){
     MGARD::print_statistics(data_ori.data(), data.data(), num_elements);
 }
 
+// lossless path for integer fields: reversible lifting, checked bit for bit
+template <class T>
+void test_integer(string filename, const vector<size_t>& dims, int target_level){
+    size_t num_elements = 0;
+    auto data = MGARD::readfile<T>(filename.c_str(), num_elements);
+    auto data_ori(data);
+    struct timespec start, end;
+    int err = 0;
+    err = clock_gettime(CLOCK_REALTIME, &start);
+    MGARD::IntegerDecomposer<T> decomposer;
+    int levels = decomposer.decompose(data.data(), dims, target_level);
+    err = clock_gettime(CLOCK_REALTIME, &end);
+    cout << "Decomposition time: " << (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000 << "s" << endl;
+    err = clock_gettime(CLOCK_REALTIME, &start);
+    MGARD::IntegerRecomposer<T> recomposer;
+    recomposer.recompose(data.data(), dims, levels);
+    err = clock_gettime(CLOCK_REALTIME, &end);
+    cout << "Recomposition time: " << (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000 << "s" << endl;
+    cout << "Lossless round trip: " << ((data == data_ori) ? "yes" : "no") << endl;
+}
+
 int main(int argc, char ** argv){
     string filename = string(argv[1]);
-    int type = atoi(argv[2]); // 0 for float, 1 for double
+    int type = atoi(argv[2]); // 0 for float, 1 for double, 2 for int16, 3 for int32
     int target_level = atoi(argv[3]);
     const int num_dims = atoi(argv[4]);
     vector<size_t> dims(num_dims);
@@ -63,8 +86,18 @@ int main(int argc, char ** argv){
                 test<double>(filename, dims, target_level);
                 break;
             }
+        case 2:
+            {
+                test_integer<int16_t>(filename, dims, target_level);
+                break;
+            }
+        case 3:
+            {
+                test_integer<int32_t>(filename, dims, target_level);
+                break;
+            }
         default:
-            cerr << "Only 0 (float) and 1 (double) are implemented in this test\n";
+            cerr << "Only 0 (float), 1 (double), 2 (int16) and 3 (int32) are implemented in this test\n";
             exit(0);
     }
     return 0;
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "error_estimator.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+// quantize the coefficients of level l to multiples of 2 eb[l] and recompose: the
+// estimate from the coefficient errors against the actual L2 and Linf errors
+/*
+@params l2_tolerance, linf_tolerance: largest relative deviation of the estimates from
+    the actual errors
+*/
+template <class T>
+void test_estimate(const vector<size_t>& dims, size_t target_level, bool hierarchical, bool calibrate, double l2_tolerance, double linf_tolerance, MGARD::ThreadPool * pool){
+    size_t num_elements = get_num_elements(dims);
+    auto data = generate_data<T>(num_elements, num_elements, 0.05);
+    vector<T> coeff(data);
+    MGARD::Decomposer<T> decomposer;
+    decomposer.set_thread_pool(pool);
+    size_t levels = decomposer.decompose(coeff.data(), dims, target_level, hierarchical);
+    // coarser levels get tighter bounds, as for a target rate
+    vector<double> eb(levels + 1);
+    for(size_t l=0; l<=levels; l++){
+        eb[l] = 1e-3 * pow(0.7, (double) (levels - l));
+    }
+    auto level_dims = MGARD::init_levels(dims, levels);
+    vector<T> approx(num_elements);
+    MGARD::for_each_level_value(dims, level_dims, NULL, [&](size_t b, size_t p, int l){
+        approx[p] = 2 * eb[l] * round(coeff[p] / (2 * eb[l]));
+    });
+    auto errors = MGARD::compute_level_errors(coeff.data(), approx.data(), dims, levels, pool);
+    MGARD::ErrorEstimator<T> estimator;
+    estimator.set_thread_pool(pool);
+    auto estimate = estimator.estimate(dims, levels, errors, hierarchical, calibrate);
+    MGARD::Recomposer<T> recomposer;
+    recomposer.set_thread_pool(pool);
+    recomposer.recompose(approx.data(), dims, levels, hierarchical);
+    double sum_squares = 0, linf = 0;
+    for(size_t i=0; i<num_elements; i++){
+        double err = (double) data[i] - approx[i];
+        sum_squares += err * err;
+        linf = max(linf, fabs(err));
+    }
+    double l2 = sqrt(sum_squares);
+    string name = to_string(8 * sizeof(T)) + "-bit " + describe(dims) + (hierarchical ? ", hierarchical" : ", orthogonal") + (calibrate ? ", calibrated" : "");
+    check(fabs(estimate.l2 - l2) <= l2_tolerance * l2, name + ": L2 estimate " + format(estimate.l2) + " within " + format(l2_tolerance) + " of the actual " + format(l2));
+    check(fabs(estimate.linf - linf) <= linf_tolerance * linf, name + ": Linf estimate " + format(estimate.linf) + " within " + format(linf_tolerance) + " of the actual " + format(linf));
+    if(hierarchical){
+        check((linf <= estimate.linf_bound) && (estimate.is_bound == (estimate.linf == estimate.linf_bound)), name + ": actual Linf within the hierarchical bound " + format(estimate.linf_bound));
+    }
+    else{
+        check((estimate.linf_bound == 0) && !estimate.is_bound, name + ": no bound in the orthogonal basis");
+    }
+}
+
+int main(int argc, char ** argv){
+    MGARD::ThreadPool pool(3);
+    // the 3D grid is larger than the surrogate grid, whose weights are extrapolated
+    vector<vector<size_t>> shapes = {{100000}, {513, 300}, {129, 129, 65}, {60, 50, 40}};
+    // the L2 estimate is within 1% here; the Linf estimate rmse * sqrt(2 ln N) is up to
+    // 50% above the actual maximum, and within 20% of it once calibrated
+    for(const auto& dims:shapes){
+        for(bool hierarchical:{false, true}){
+            test_estimate<double>(dims, 10, hierarchical, false, 0.05, 0.6, &pool);
+            test_estimate<double>(dims, 10, hierarchical, true, 0.05, 0.25, &pool);
+        }
+    }
+    test_estimate<float>({513, 300}, 10, false, true, 0.05, 0.25, &pool);
+    test_estimate<float>({60, 50, 40}, 10, true, true, 0.05, 0.25, NULL);
+    return report();
+}
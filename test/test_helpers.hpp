@@ -0,0 +1,64 @@
+#ifndef _MGARD_TEST_HELPERS_HPP
+#define _MGARD_TEST_HELPERS_HPP
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+// scaffolding of the self-checking tests run by ctest: every check prints one
+// passed/FAILED line, and main returns report()
+
+using namespace std;
+
+// number of failed checks so far
+inline int& failures(){
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool condition, const string& what){
+    cout << (condition ? "passed: " : "FAILED: ") << what << endl;
+    if(!condition) failures() ++;
+}
+
+// exit status of the test
+inline int report(){
+    if(failures()) cerr << failures() << " checks failed" << endl;
+    return failures() ? 1 : 0;
+}
+
+inline size_t get_num_elements(const vector<size_t>& dims){
+    size_t num_elements = 1;
+    for(const auto& d:dims) num_elements *= d;
+    return num_elements;
+}
+
+// e.g. "3D 17 16 9"
+inline string describe(const vector<size_t>& dims){
+    string name = to_string(dims.size()) + "D";
+    for(const auto& d:dims) name += " " + to_string(d);
+    return name;
+}
+
+// shortest representation of x, unlike to_string
+inline string format(double x){
+    ostringstream out;
+    out << x;
+    return out.str();
+}
+
+// sin(frequency * i) plus uniform noise in [0, 1], reproducible for a given seed
+template <class T>
+vector<T> generate_data(size_t num_elements, unsigned int seed, double frequency=0.1){
+    vector<T> data(num_elements);
+    srand(seed);
+    for(size_t i=0; i<num_elements; i++){
+        data[i] = sin(frequency * i) + (T) rand() / RAND_MAX;
+    }
+    return data;
+}
+
+#endif
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "decompose.hpp"
+#include "incremental.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+string describe(const vector<size_t>& dims, const vector<size_t>& origin, const vector<size_t>& box_dims, bool hierarchical){
+    string name = describe(dims) + ", box";
+    for(size_t k=0; k<dims.size(); k++) name += " " + to_string(origin[k]) + "+" + to_string(box_dims[k]);
+    return name + (hierarchical ? ", hierarchical" : "");
+}
+
+// change a box of a decomposed field with IncrementalDecomposer::update (both forms)
+// and compare with a full decomposition of the new field
+template <class T>
+void test_update(const vector<size_t>& dims, const vector<size_t>& origin, const vector<size_t>& box_dims, bool hierarchical, double tolerance){
+    size_t num_elements = get_num_elements(dims), box_elements = get_num_elements(box_dims);
+    auto strides = MGARD::init_strides(dims);
+    auto old_data = generate_data<T>(num_elements, 3, 0.02);
+    vector<T> new_data(old_data), delta(box_elements);
+    for(size_t b=0; b<box_elements; b++){
+        size_t index = b, p = 0;
+        for(int k=dims.size()-1; k>=0; k--){
+            p += (origin[k] + index % box_dims[k]) * strides[k];
+            index /= box_dims[k];
+        }
+        delta[b] = 2 * (T) rand() / RAND_MAX - 1;
+        new_data[p] += delta[b];
+    }
+    const size_t target_level = 10;
+    vector<T> coeff(old_data);
+    MGARD::Decomposer<T> decomposer;
+    decomposer.decompose(coeff.data(), dims, target_level, hierarchical);
+    vector<T> expected(new_data);
+    decomposer.decompose(expected.data(), dims, target_level, hierarchical);
+    vector<T> updated(coeff);
+    MGARD::IncrementalDecomposer<T> incremental;
+    incremental.update(updated.data(), dims, target_level, origin, box_dims, delta.data(), hierarchical);
+    double error = 0, max_value = 0;
+    for(size_t i=0; i<num_elements; i++){
+        error = max(error, (double) fabs(updated[i] - expected[i]));
+        max_value = max(max_value, (double) fabs(expected[i]));
+    }
+    check(error <= tolerance * max_value, describe(dims, origin, box_dims, hierarchical) + ": update from delta matches a full decomposition");
+    // the change given as old and new data
+    incremental.update(coeff.data(), dims, target_level, old_data.data(), new_data.data(), origin, box_dims, hierarchical);
+    error = 0;
+    for(size_t i=0; i<num_elements; i++){
+        error = max(error, (double) fabs(coeff[i] - expected[i]));
+    }
+    check(error <= tolerance * max_value, describe(dims, origin, box_dims, hierarchical) + ": update from old and new data matches a full decomposition");
+}
+
+int main(int argc, char ** argv){
+    for(bool hierarchical:{false, true}){
+        // odd and even 1D, interior boxes and boxes at either boundary
+        test_update<double>({129}, {40}, {5}, hierarchical, 1e-12);
+        test_update<double>({128}, {0}, {7}, hierarchical, 1e-12);
+        test_update<double>({128}, {121}, {7}, hierarchical, 1e-12);
+        test_update<float>({257}, {100}, {1}, hierarchical, 1e-5);
+        // 2D and 3D, odd and even
+        test_update<double>({65, 65}, {20, 31}, {6, 9}, hierarchical, 1e-12);
+        test_update<double>({64, 64}, {60, 0}, {4, 3}, hierarchical, 1e-12);
+        test_update<double>({33, 33, 33}, {10, 11, 12}, {4, 4, 4}, hierarchical, 1e-12);
+        test_update<double>({32, 32, 32}, {0, 28, 15}, {3, 4, 2}, hierarchical, 1e-12);
+        test_update<float>({33, 32, 17}, {9, 9, 9}, {5, 5, 5}, hierarchical, 1e-5);
+        // anisotropic: the levels stop refining the short dimensions first
+        test_update<double>({5, 200}, {1, 90}, {3, 10}, hierarchical, 1e-12);
+        test_update<double>({3, 96, 17}, {0, 40, 8}, {3, 8, 2}, hierarchical, 1e-12);
+        test_update<double>({130, 6, 9}, {64, 5, 0}, {3, 1, 9}, hierarchical, 1e-12);
+    }
+    return report();
+}
@@ -0,0 +1,72 @@
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include "integer_lifting.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+template <class T>
+string type_name(){
+    return string(numeric_limits<T>::is_signed ? "int" : "uint") + to_string(8 * sizeof(T));
+}
+
+// random values over the whole range of T, so that the differences wrap,
+// or a smooth ramp within a small part of the range
+template <class T>
+vector<T> generate_integers(size_t num_elements, bool full_range){
+    vector<T> data(num_elements);
+    uint64_t state = 0x9E3779B97F4A7C15ULL * (num_elements + full_range);
+    for(size_t i=0; i<num_elements; i++){
+        // xorshift64
+        state ^= state << 13, state ^= state >> 7, state ^= state << 17;
+        data[i] = full_range ? (T) state : (T) (i / 3 + (state & 3));
+    }
+    return data;
+}
+
+// IntegerDecomposer then IntegerRecomposer restores the data bit-exactly, and the
+// pooled coefficients equal the serial ones
+template <class T>
+void test_round_trip(const vector<size_t>& dims, bool full_range, MGARD::ThreadPool * pool){
+    auto data = generate_integers<T>(get_num_elements(dims), full_range);
+    string name = type_name<T>() + " " + describe(dims) + (full_range ? ", full range" : ", ramp") + (pool ? ", pooled" : "");
+    vector<T> serial_coeff(data);
+    MGARD::IntegerDecomposer<T> serial_decomposer;
+    int serial_levels = serial_decomposer.decompose(serial_coeff.data(), dims, 10);
+    vector<T> coeff(data);
+    MGARD::IntegerDecomposer<T> decomposer;
+    decomposer.set_thread_pool(pool);
+    int levels = decomposer.decompose(coeff.data(), dims, 10);
+    check((levels == serial_levels) && (coeff == serial_coeff), name + ": coefficients match the serial decomposition");
+    MGARD::IntegerRecomposer<T> recomposer;
+    recomposer.set_thread_pool(pool);
+    recomposer.recompose(coeff.data(), dims, levels);
+    check(coeff == data, name + ": exact round trip over " + to_string(levels) + " levels");
+}
+
+template <class T>
+void test_type(MGARD::ThreadPool * pool){
+    // odd, even and degenerate sizes
+    vector<vector<size_t>> shapes = {{1}, {2}, {3}, {65}, {64}, {1000},
+        {1, 7}, {2, 2}, {17, 33}, {16, 30}, {3, 100},
+        {1, 1, 1}, {2, 3, 2}, {17, 9, 33}, {16, 8, 12}, {5, 1, 40}};
+    for(const auto& dims:shapes){
+        for(bool full_range:{true, false}){
+            test_round_trip<T>(dims, full_range, NULL);
+            test_round_trip<T>(dims, full_range, pool);
+        }
+    }
+}
+
+int main(int argc, char ** argv){
+    MGARD::ThreadPool pool(3);
+    test_type<int8_t>(&pool);
+    test_type<int32_t>(&pool);
+    test_type<int64_t>(&pool);
+    test_type<uint16_t>(&pool);
+    return report();
+}
@@ -0,0 +1,165 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+// index of entry r of a dimension of size n after one level of reordering:
+// nodal values (even indices) come first; if n is even, the last nodal value is
+// a virtual node at index n, extrapolated from the values at n - 1 and n - 2
+size_t get_extended_index(size_t r, size_t n){
+    size_t n_nodal = (n >> 1) + 1;
+    return (r < n_nodal) ? 2 * r : 2 * (r - n_nodal) + 1;
+}
+
+bool is_coefficient(size_t r, size_t n){
+    return r >= (n >> 1) + 1;
+}
+
+// data extended by the virtual nodes of the even dimensions, computed in T and in
+// the order of the reordering (last dimension first) as the kernels do
+template <class T>
+vector<T> extend_data(const vector<T>& data, const vector<size_t>& dims, vector<size_t>& extended_dims){
+    extended_dims = dims;
+    for(auto& d:extended_dims) d += !(d & 1);
+    auto strides = MGARD::init_strides(dims);
+    auto extended_strides = MGARD::init_strides(extended_dims);
+    vector<T> extended(get_num_elements(extended_dims));
+    for(size_t i=0; i<data.size(); i++){
+        size_t pos = 0, rem = i;
+        for(int d=dims.size()-1; d>=0; d--){
+            pos += (rem % dims[d]) * extended_strides[d];
+            rem /= dims[d];
+        }
+        extended[pos] = data[i];
+    }
+    for(int d=dims.size()-1; d>=0; d--){
+        if(dims[d] & 1) continue;
+        for(size_t i=0; i<extended.size(); i++){
+            // all entries at index dims[d] of dimension d, within the part computed so far
+            size_t rem = i;
+            bool virtual_node = true;
+            for(int k=dims.size()-1; k>=0; k--){
+                size_t index = rem % extended_dims[k];
+                if(((k == d) && (index != dims[k])) || ((k < d) && (index >= dims[k]))) virtual_node = false;
+                rem /= extended_dims[k];
+            }
+            if(virtual_node) extended[i] = 2 * extended[i - extended_strides[d]] - extended[i - 2 * extended_strides[d]];
+        }
+    }
+    return extended;
+}
+
+// interpolant of one level at original index (i, j, k), between index - 1 and index + 1
+// in the dimensions where it is a coefficient, exact (long double) and
+// in the former formulation: the sum of the 2, 4 or 8 nodal neighbors divided by
+// their number, added in the order of the former kernels (dim 1 before dim 0 in 2D,
+// dim 0 before dim 2 before dim 1 in 3D)
+template <class T>
+void get_interpolants(const vector<T>& data, const vector<size_t>& extended_dims, const size_t * index, const bool * coefficient, long double& exact, T& former){
+    const vector<int> order = (extended_dims.size() == 2) ? vector<int>{1, 0} : vector<int>{0, 2, 1};
+    vector<int> coeff_dims;
+    for(int d:order){
+        if(coefficient[d]) coeff_dims.push_back(d);
+    }
+    auto strides = MGARD::init_strides(extended_dims);
+    size_t num_neighbors = 1 << coeff_dims.size();
+    T sum = 0;
+    long double exact_sum = 0;
+    for(size_t b=0; b<num_neighbors; b++){
+        size_t pos = 0;
+        for(size_t d=0; d<extended_dims.size(); d++){
+            pos += (coefficient[d] ? index[d] - 1 : index[d]) * strides[d];
+        }
+        for(size_t c=0; c<coeff_dims.size(); c++){
+            if(b & (1 << c)) pos += 2 * strides[coeff_dims[c]];
+        }
+        sum += data[pos];
+        exact_sum += data[pos];
+    }
+    former = sum / num_neighbors;
+    exact = exact_sum / num_neighbors;
+}
+
+// one hierarchical level (no mass-matrix correction) against the former 2-, 4- and
+// 8-point sums, within the bounds documented at compute_interpolant_difference_3D_coeff_plane
+template <class T>
+void test_level(const vector<size_t>& dims){
+    const double eps = numeric_limits<T>::epsilon();
+    size_t num_elements = get_num_elements(dims);
+    auto data = generate_data<T>(num_elements, num_elements, 0.3);
+    vector<T> coeff(data);
+    MGARD::Decomposer<T> decomposer;
+    decomposer.decompose(coeff.data(), dims, 1, true);
+    vector<size_t> extended_dims;
+    auto extended = extend_data(data, dims, extended_dims);
+    auto strides = MGARD::init_strides(dims);
+    auto extended_strides = MGARD::init_strides(extended_dims);
+    double max_value = 0, max_coeff = 0;
+    for(const auto& x:extended) max_value = max(max_value, (double) fabs(x));
+    vector<T> former_data(num_elements);
+    double nodal_error = 0, interpolant_error = 0, coeff_difference = 0;
+    for(size_t r=0; r<num_elements; r++){
+        // r is the reordered position, index the one in the extended data
+        size_t index[3], pos = 0, rem = r;
+        bool coefficient[3], nodal = true;
+        for(int d=dims.size()-1; d>=0; d--){
+            index[d] = get_extended_index(rem % dims[d], dims[d]);
+            coefficient[d] = is_coefficient(rem % dims[d], dims[d]);
+            if(coefficient[d]) nodal = false;
+            pos += index[d] * extended_strides[d];
+            rem /= dims[d];
+        }
+        max_coeff = max(max_coeff, (double) fabs(coeff[r]));
+        if(nodal){
+            nodal_error = max(nodal_error, (double) fabs(coeff[r] - extended[pos]));
+            former_data[r] = extended[pos];
+            continue;
+        }
+        long double exact;
+        T former;
+        get_interpolants(extended, extended_dims, index, coefficient, exact, former);
+        // the interpolant used by the kernel, up to the rounding of the subtraction
+        interpolant_error = max(interpolant_error, (double) fabsl((long double) extended[pos] - coeff[r] - exact));
+        T former_coeff = extended[pos] - former;
+        coeff_difference = max(coeff_difference, (double) fabs(coeff[r] - former_coeff));
+        former_data[r] = coeff[r] + former;
+    }
+    check(nodal_error == 0, describe(dims) + ": nodal values are kept");
+    // 3/2 eps max|nodal| for the interpolant, eps max|data| for the subtraction
+    check(interpolant_error <= 2.5 * eps * max_value, describe(dims) + ": interpolant within " + format(interpolant_error / (eps * max_value)) + " eps max|data| of the exact average");
+    // 3/2 + 35/16 for the two interpolants, 2 for the two subtractions
+    check(coeff_difference <= 6 * eps * max_value, describe(dims) + ": coefficients within " + format(coeff_difference / (eps * max_value)) + " eps max|data| of the former formulation");
+    // the recomposition adds the interpolant to the same coefficients; the values
+    // next to a virtual node are recovered from it and are left out
+    MGARD::Recomposer<T> recomposer;
+    recomposer.recompose(coeff.data(), dims, 1, true);
+    double data_difference = 0;
+    for(size_t r=0; r<num_elements; r++){
+        size_t pos = 0, rem = r;
+        bool recovered = true;
+        for(int d=dims.size()-1; d>=0; d--){
+            size_t index = get_extended_index(rem % dims[d], dims[d]);
+            if(index >= dims[d]) recovered = false;
+            pos += index * strides[d];
+            rem /= dims[d];
+        }
+        if(recovered) data_difference = max(data_difference, (double) fabs(coeff[pos] - former_data[r]));
+    }
+    double recompose_max = max(max_value, max_coeff);
+    check(data_difference <= 6 * eps * recompose_max, describe(dims) + ": recomposition within " + format(data_difference / (eps * recompose_max)) + " eps max|data| of the former formulation");
+}
+
+int main(int argc, char ** argv){
+    vector<vector<size_t>> shapes = {{129, 100}, {65, 65}, {64, 64}, {6, 33}, {33, 33, 33}, {32, 17, 20}, {65, 64, 33}, {6, 9, 8}};
+    for(const auto& dims:shapes){
+        test_level<float>(dims);
+        test_level<double>(dims);
+    }
+    return report();
+}
@@ -0,0 +1,95 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "utils.hpp"
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+// the number of levels of a dimension: sizes up to 2 are never coarsened
+void test_max_level(){
+    vector<pair<size_t, size_t>> expected = {{1, 0}, {2, 0}, {3, 1}, {4, 2}, {5, 2}, {8, 3}, {9, 3}, {16, 4}, {17, 4}, {1025, 10}};
+    bool same = true;
+    for(const auto& e:expected){
+        same = same && (MGARD::get_max_level(e.first) == e.second);
+    }
+    check(same, "levels of a dimension of size 1 to 1025");
+    // a decomposition is clamped by its largest dimension, not by the smallest
+    check((MGARD::get_max_level({2, 1025}) == 10) && (MGARD::get_max_level({1, 1, 1}) == 0) && (MGARD::get_max_level({5, 129, 9}) == 7), "levels of a grid are those of its largest dimension");
+}
+
+// each dimension is coarsened in the first levels it can take and kept afterwards
+void test_init_levels(){
+    auto level_dims = MGARD::init_levels({5, 129, 2}, 7);
+    vector<vector<size_t>> expected = {{2, 2, 2}, {2, 3, 2}, {2, 5, 2}, {2, 9, 2}, {2, 17, 2}, {2, 33, 2}, {3, 65, 2}, {5, 129, 2}};
+    check(level_dims == expected, "3D 5 129 2: the thin dimension stops after 2 levels, the one of size 2 is kept");
+    level_dims = MGARD::init_levels({5, 129, 2}, 3);
+    expected = {{2, 17, 2}, {2, 33, 2}, {3, 65, 2}, {5, 129, 2}};
+    check(level_dims == expected, "3D 5 129 2, 3 levels: every dimension is coarsened from the finest level");
+}
+
+// decompose clamps target_level to get_max_level(dims) and returns the number of
+// levels performed; Recomposer applies the same clamp, so the round trip holds
+// with the requested target_level; dimensions of size 1 or 2 are kept on all levels,
+// so the decomposition of a grid with such dimensions equals the decompositions of
+// its slices along them
+template <class T>
+void test_clamp(const vector<size_t>& dims, const vector<size_t>& slice_dims, size_t target_level, bool hierarchical, MGARD::ThreadPool * pool){
+    size_t num_elements = get_num_elements(dims);
+    size_t slice_size = get_num_elements(slice_dims);
+    auto data = generate_data<T>(num_elements, num_elements);
+    string name = to_string(8 * sizeof(T)) + "-bit " + describe(dims) + ", target level " + to_string(target_level) + (hierarchical ? ", hierarchical" : "") + (pool ? ", pooled" : "");
+    vector<T> coeff(data);
+    MGARD::Decomposer<T> decomposer;
+    decomposer.set_thread_pool(pool);
+    size_t levels = decomposer.decompose(coeff.data(), dims, target_level, hierarchical);
+    size_t expected_levels = min(target_level, MGARD::get_max_level(dims));
+    check(levels == expected_levels, name + ": " + to_string(levels) + " levels performed");
+    if(levels == 0) check(coeff == data, name + ": no level leaves the data unchanged");
+    // slices along the kept dimensions, one after the other in memory
+    bool same_slices = true;
+    for(size_t s=0; s<num_elements/slice_size; s++){
+        vector<T> slice(data.begin() + s * slice_size, data.begin() + (s + 1) * slice_size);
+        MGARD::Decomposer<T> slice_decomposer;
+        size_t slice_levels = slice_decomposer.decompose(slice.data(), slice_dims, target_level, hierarchical);
+        same_slices = same_slices && (slice_levels == levels) && equal(slice.begin(), slice.end(), coeff.begin() + s * slice_size);
+    }
+    check(same_slices, name + ": equal to the decompositions of the " + describe(slice_dims) + " slices");
+    MGARD::Recomposer<T> recomposer;
+    recomposer.set_thread_pool(pool);
+    recomposer.recompose(coeff.data(), dims, target_level, hierarchical);
+    double error = 0, max_value = 0;
+    for(size_t i=0; i<num_elements; i++){
+        error = max(error, (double) fabs(coeff[i] - data[i]));
+        max_value = max(max_value, (double) fabs(data[i]));
+    }
+    double ulps = error / (max_value * numeric_limits<T>::epsilon());
+    check(ulps <= 32, name + ": round trip with the requested target level within " + format(ulps) + " eps max|data|");
+}
+
+int main(int argc, char ** argv){
+    test_max_level();
+    test_init_levels();
+    MGARD::ThreadPool pool(3);
+    for(bool hierarchical:{false, true}){
+        for(MGARD::ThreadPool * p:{(MGARD::ThreadPool *) NULL, &pool}){
+            // target levels above the largest dimension are clamped
+            test_clamp<float>({129}, {129}, 20, hierarchical, p);
+            test_clamp<double>({2, 65}, {65}, 20, hierarchical, p);
+            test_clamp<float>({1, 33, 1}, {33}, 20, hierarchical, p);
+            test_clamp<double>({2, 2, 40}, {40}, 3, hierarchical, p);
+            test_clamp<float>({2, 17, 33}, {17, 33}, 20, hierarchical, p);
+            // grids that cannot be coarsened
+            test_clamp<double>({2}, {2}, 5, hierarchical, p);
+            test_clamp<float>({1, 2, 2}, {1, 2, 2}, 5, hierarchical, p);
+            // target level 0
+            test_clamp<double>({17, 16}, {17, 16}, 0, hierarchical, p);
+        }
+    }
+    return report();
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "lorenzo.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+string describe(const vector<size_t>& dims, bool column_major, double eb){
+    return describe(dims) + (column_major ? ", column-major" : ", row-major") + ", eb " + format(eb);
+}
+
+// data of dims in the given layout, from the row-major values
+template <class T>
+vector<T> to_layout(const vector<T>& data, const vector<size_t>& dims, const vector<size_t>& strides){
+    vector<T> result(data.size());
+    for(size_t i=0; i<data.size(); i++){
+        size_t pos = 0, rest = i;
+        for(int k=dims.size()-1; k>=0; k--){
+            pos += (rest % dims[k]) * strides[k];
+            rest /= dims[k];
+        }
+        result[pos] = data[i];
+    }
+    return result;
+}
+
+// lorenzo_quantize replaces every value by a reconstruction within eb, and
+// lorenzo_dequantize rebuilds exactly these values from the codes alone; a small
+// radius sends the larger prediction errors to the unpredictable values
+template <class T>
+void test_codes(const vector<size_t>& dims, bool column_major, double eb, int radius){
+    size_t num_elements = get_num_elements(dims);
+    auto strides = column_major ? MGARD::init_column_major_strides(dims) : MGARD::init_strides(dims);
+    auto data = to_layout(generate_data<T>(num_elements, num_elements, 0.2), dims, strides);
+    string name = to_string(8 * sizeof(T)) + "-bit " + describe(dims, column_major, eb) + ", radius " + to_string(radius);
+    vector<T> quantized(data);
+    MGARD::LorenzoCodes<T> codes;
+    codes.eb = eb;
+    codes.radius = radius;
+    MGARD::lorenzo_quantize(quantized.data(), dims, strides, codes);
+    double error = 0;
+    for(size_t i=0; i<num_elements; i++){
+        error = max(error, fabs((double) quantized[i] - data[i]));
+    }
+    check((codes.codes.size() == num_elements) && (error <= eb), name + ": quantization error " + format(error) + " within eb, " + to_string(codes.unpredictable.size()) + " unpredictable values");
+    vector<T> dequantized(num_elements, 0);
+    MGARD::lorenzo_dequantize(dequantized.data(), dims, strides, codes);
+    check(dequantized == quantized, name + ": codes reconstruct the quantized values");
+}
+
+// decompose with a nodal error bound and recompose from the coefficients and codes:
+// recomposition is linear and the coefficients are exact, so the error is the
+// interpolation of the nodal errors, within eb up to the rounding of the round trip
+template <class T>
+void test_decomposition(const vector<size_t>& dims, bool column_major, double eb, bool hierarchical){
+    size_t num_elements = get_num_elements(dims);
+    auto strides = column_major ? MGARD::init_column_major_strides(dims) : MGARD::init_strides(dims);
+    auto data = to_layout(generate_data<T>(num_elements, num_elements + 1, 0.05), dims, strides);
+    string name = to_string(8 * sizeof(T)) + "-bit " + describe(dims, column_major, eb) + (hierarchical ? ", hierarchical" : "");
+    const size_t target_level = 3;
+    vector<T> coeff(data);
+    MGARD::Decomposer<T> decomposer;
+    decomposer.set_nodal_error_bound(eb);
+    int levels = decomposer.decompose(coeff.data(), dims, target_level, hierarchical, strides);
+    const auto& codes = decomposer.get_nodal_codes();
+    MGARD::Recomposer<T> recomposer;
+    recomposer.set_nodal_codes(&codes);
+    recomposer.recompose(coeff.data(), dims, levels, hierarchical, strides);
+    double error = 0, max_value = 0;
+    for(size_t i=0; i<num_elements; i++){
+        error = max(error, fabs((double) coeff[i] - data[i]));
+        max_value = max(max_value, (double) fabs(data[i]));
+    }
+    double tolerance = eb + 32 * numeric_limits<T>::epsilon() * max_value;
+    check(!codes.codes.empty() && (error <= tolerance), name + ": recomposition error " + format(error) + " within eb");
+}
+
+int main(int argc, char ** argv){
+    vector<vector<size_t>> shapes = {{1000}, {65, 40}, {64, 33}, {17, 16, 9}, {33, 20, 12}};
+    for(const auto& dims:shapes){
+        for(bool column_major:{false, true}){
+            for(double eb:{1e-2, 1e-4}){
+                test_codes<float>(dims, column_major, eb, 32768);
+                test_codes<double>(dims, column_major, eb, 32768);
+                test_codes<double>(dims, column_major, eb, 4);
+                for(bool hierarchical:{false, true}){
+                    test_decomposition<float>(dims, column_major, eb, hierarchical);
+                    test_decomposition<double>(dims, column_major, eb, hierarchical);
+                }
+            }
+        }
+    }
+    return report();
+}
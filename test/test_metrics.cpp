@@ -0,0 +1,167 @@
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "utils.hpp"
+#include "metrics.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+// the metrics of compute_metrics, one value at a time in long double
+template <class T>
+MGARD::Metrics compute_naive_metrics(const T * data_ori, const T * data_dec, size_t num_elements){
+    MGARD::Metrics metrics;
+    metrics.num_elements = num_elements;
+    metrics.min_value = metrics.max_value = data_ori[0];
+    metrics.max_error = -1;
+    long double error_sum = 0, squared_error_sum = 0;
+    for(size_t i=0; i<num_elements; i++){
+        double error = (double) data_ori[i] - (double) data_dec[i];
+        metrics.min_value = min(metrics.min_value, (double) data_ori[i]);
+        metrics.max_value = max(metrics.max_value, (double) data_ori[i]);
+        metrics.max_abs_value = max(metrics.max_abs_value, fabs((double) data_ori[i]));
+        if(fabs(error) > metrics.max_error){
+            metrics.max_error = fabs(error);
+            metrics.max_error_pos = i;
+        }
+        error_sum += error;
+        squared_error_sum += (long double) error * error;
+    }
+    metrics.value_range = metrics.max_value - metrics.min_value;
+    metrics.mean_error = error_sum / num_elements;
+    metrics.mse = squared_error_sum / num_elements;
+    metrics.rmse = sqrt(metrics.mse);
+    metrics.nrmse = metrics.rmse / metrics.value_range;
+    metrics.psnr = 20 * log10(metrics.value_range / metrics.rmse);
+    return metrics;
+}
+
+// also true for equal infinities, e.g. the PSNR of a single value
+bool close(double a, double b, double tolerance){
+    return (a == b) || (fabs(a - b) <= tolerance * max(fabs(a), fabs(b)));
+}
+
+// decompressed data: the original plus errors of up to 1e-3, with a few larger ones
+template <class T>
+vector<T> generate_decompressed(const vector<T>& data_ori){
+    vector<T> data_dec(data_ori);
+    srand(11);
+    for(size_t i=0; i<data_dec.size(); i++){
+        data_dec[i] += 2e-3 * ((T) rand() / RAND_MAX - 0.5);
+        if(rand() % 1000 == 0) data_dec[i] += 0.05;
+    }
+    return data_dec;
+}
+
+// compute_metrics against the naive computation, serial and pooled, across the
+// chunk boundaries (num_elements above and not a multiple of the chunk size)
+template <class T>
+void test_metrics(size_t num_elements, MGARD::ThreadPool * pool, double tolerance){
+    auto data_ori = generate_data<T>(num_elements, num_elements);
+    auto data_dec = generate_decompressed(data_ori);
+    string name = to_string(num_elements) + " values";
+    auto expected = compute_naive_metrics(data_ori.data(), data_dec.data(), num_elements);
+    auto metrics = MGARD::compute_metrics(data_ori.data(), data_dec.data(), num_elements);
+    check((metrics.min_value == expected.min_value) && (metrics.max_value == expected.max_value) && (metrics.value_range == expected.value_range) && (metrics.max_abs_value == expected.max_abs_value), name + ": value range");
+    check((metrics.max_error == expected.max_error) && (metrics.max_error_pos == expected.max_error_pos), name + ": max error and its first position");
+    check(close(metrics.mean_error, expected.mean_error, tolerance) && close(metrics.mse, expected.mse, tolerance) && close(metrics.rmse, expected.rmse, tolerance) && close(metrics.nrmse, expected.nrmse, tolerance) && close(metrics.psnr, expected.psnr, tolerance), name + ": mean error, MSE, RMSE, NRMSE and PSNR");
+    auto pooled = MGARD::compute_metrics(data_ori.data(), data_dec.data(), num_elements, pool);
+    check((pooled.max_error_pos == metrics.max_error_pos) && (pooled.mean_error == metrics.mean_error) && (pooled.mse == metrics.mse) && (pooled.psnr == metrics.psnr), name + ": pooled metrics equal the serial ones");
+    // print_statistics_parallel prints the naive metrics
+    ostringstream naive_output, output;
+    auto cout_buffer = cout.rdbuf(naive_output.rdbuf());
+    MGARD::print_metrics(expected);
+    cout.rdbuf(output.rdbuf());
+    MGARD::print_statistics_parallel(data_ori.data(), data_dec.data(), num_elements, pool);
+    cout.rdbuf(cout_buffer);
+    check(output.str() == naive_output.str(), name + ": print_statistics_parallel output");
+    // histogram over [-2e-3, 2e-3]: the larger errors (original - decompressed = -0.05) go to the first bin
+    const size_t num_bins = 10;
+    const double range = 2e-3;
+    auto histogram = MGARD::compute_error_histogram(data_ori.data(), data_dec.data(), num_elements, num_bins, range, pool);
+    const double scale = num_bins / (2 * range);
+    vector<size_t> counts(num_bins, 0);
+    for(size_t i=0; i<num_elements; i++){
+        double bin = floor(((double) data_ori[i] - (double) data_dec[i] + range) * scale);
+        counts[(size_t) min(max(bin, 0.0), num_bins - 1.0)] ++;
+    }
+    check((histogram.counts == counts) && (histogram.min_error == - range) && (histogram.max_error == range), name + ": error histogram");
+    check(MGARD::compute_error_histogram(data_ori.data(), data_dec.data(), num_elements, 0, range, pool).counts.empty(), name + ": no bins give an empty histogram");
+}
+
+// mean SSIM over the windows of compute_ssim, with two-pass means and variances
+template <class T>
+double compute_naive_ssim(const T * data_ori, const T * data_dec, const vector<size_t>& dims, size_t window, size_t step){
+    size_t n[3] = {1, 1, 1}, w[3] = {1, 1, 1};
+    int offset = 3 - dims.size();
+    for(int k=0; k<dims.size(); k++){
+        n[offset + k] = dims[k];
+        w[offset + k] = min(window, dims[k]);
+    }
+    double min_value = data_ori[0], max_value = data_ori[0];
+    for(size_t i=0; i<n[0]*n[1]*n[2]; i++){
+        min_value = min(min_value, (double) data_ori[i]);
+        max_value = max(max_value, (double) data_ori[i]);
+    }
+    double range = max_value - min_value;
+    double c1 = (0.01 * range) * (0.01 * range);
+    double c2 = (0.03 * range) * (0.03 * range);
+    double sum = 0;
+    size_t num_windows = 0;
+    for(size_t a=0; a+w[0]<=n[0]; a+=step){
+        for(size_t b=0; b+w[1]<=n[1]; b+=step){
+            for(size_t c=0; c+w[2]<=n[2]; c+=step){
+                vector<double> x, y;
+                for(size_t i=0; i<w[0]; i++){
+                    for(size_t j=0; j<w[1]; j++){
+                        for(size_t k=0; k<w[2]; k++){
+                            size_t index = ((a + i) * n[1] + b + j) * n[2] + c + k;
+                            x.push_back(data_ori[index]);
+                            y.push_back(data_dec[index]);
+                        }
+                    }
+                }
+                double mx = 0, my = 0;
+                for(size_t i=0; i<x.size(); i++) mx += x[i], my += y[i];
+                mx /= x.size(), my /= y.size();
+                double vx = 0, vy = 0, cxy = 0;
+                for(size_t i=0; i<x.size(); i++){
+                    vx += (x[i] - mx) * (x[i] - mx);
+                    vy += (y[i] - my) * (y[i] - my);
+                    cxy += (x[i] - mx) * (y[i] - my);
+                }
+                vx /= x.size(), vy /= x.size(), cxy /= x.size();
+                sum += ((2 * mx * my + c1) * (2 * cxy + c2)) / ((mx * mx + my * my + c1) * (vx + vy + c2));
+                num_windows ++;
+            }
+        }
+    }
+    return sum / num_windows;
+}
+
+template <class T>
+void test_ssim(const vector<size_t>& dims, size_t window, size_t step, MGARD::ThreadPool * pool, double tolerance){
+    auto data_ori = generate_data<T>(get_num_elements(dims), 5, 0.05);
+    auto data_dec = generate_decompressed(data_ori);
+    double expected = compute_naive_ssim(data_ori.data(), data_dec.data(), dims, window, step);
+    double ssim = MGARD::compute_ssim(data_ori.data(), data_dec.data(), dims, window, step);
+    double pooled = MGARD::compute_ssim(data_ori.data(), data_dec.data(), dims, window, step, pool);
+    check(close(ssim, expected, tolerance) && (pooled == ssim), describe(dims) + ", window " + to_string(window) + ", step " + to_string(step) + ": SSIM " + format(ssim) + " matches the naive computation");
+}
+
+int main(int argc, char ** argv){
+    MGARD::ThreadPool pool(3);
+    for(size_t num_elements:{1, 7, 1000, 65536, 200003}){
+        test_metrics<double>(num_elements, &pool, 1e-12);
+        test_metrics<float>(num_elements, &pool, 1e-9);
+    }
+    test_ssim<double>({1000}, 7, 2, &pool, 1e-9);
+    test_ssim<double>({65, 40}, 7, 2, &pool, 1e-9);
+    test_ssim<float>({33, 17, 20}, 7, 3, &pool, 1e-6);
+    // dimensions shorter than the window
+    test_ssim<double>({5, 30, 4}, 7, 2, &pool, 1e-9);
+    return report();
+}
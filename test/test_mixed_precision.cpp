@@ -0,0 +1,73 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "decompose.hpp"
+#include "mixed_precision.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+// smooth field on a large offset (kind 0) or uniform noise (kind 1)
+vector<double> make_field(size_t num_elements, int kind){
+    vector<double> field(num_elements);
+    srand(7);
+    for(size_t i=0; i<num_elements; i++){
+        field[i] = (kind == 0) ? 1000 + sin(0.001 * i) + 0.3 * cos(0.07 * i) : (double) rand() / RAND_MAX;
+    }
+    return field;
+}
+
+// double data through float coefficients: the coefficients against a double
+// decomposition within get_conversion_error, and the round trip against the data
+// within get_round_trip_error
+void test(const vector<size_t>& dims, int kind, MGARD::SolverMode mode, MGARD::ThreadPool * pool){
+    size_t num_elements = get_num_elements(dims);
+    string name = describe(dims);
+    name += (kind == 0) ? ", smooth" : ", noise";
+    name += (mode == MGARD::SOLVER_DECAY) ? ", decay" : ", thomas";
+    name += pool ? ", pool" : "";
+    auto data = make_field(num_elements, kind);
+    vector<float> coeff(num_elements);
+    MGARD::MixedDecomposer decomposer;
+    decomposer.set_thread_pool(pool);
+    decomposer.set_solver_mode(mode);
+    int levels = decomposer.decompose(data.data(), dims, 20, coeff.data());
+    double offset = decomposer.get_offset();
+    double bound = decomposer.get_conversion_error();
+    // coefficients of the same offset data in double
+    vector<double> expected(data);
+    for(auto& x:expected) x -= offset;
+    MGARD::Decomposer<double> reference;
+    reference.set_solver_mode(mode);
+    reference.decompose(expected.data(), dims, 20);
+    double coeff_error = 0;
+    for(size_t i=0; i<num_elements; i++){
+        coeff_error = max(coeff_error, fabs(expected[i] - (double) coeff[i]));
+    }
+    check((bound > 0) && (coeff_error <= bound), name + ": coefficient error " + format(coeff_error) + " within get_conversion_error " + format(bound));
+    vector<double> result(num_elements);
+    MGARD::MixedRecomposer recomposer;
+    recomposer.set_thread_pool(pool);
+    recomposer.recompose(coeff.data(), dims, levels, offset, result.data());
+    double error = 0;
+    for(size_t i=0; i<num_elements; i++){
+        error = max(error, fabs(result[i] - data[i]));
+    }
+    double round_trip_bound = decomposer.get_round_trip_error();
+    check((round_trip_bound >= bound) && (error <= round_trip_bound), name + ": round trip error " + format(error) + " within get_round_trip_error " + format(round_trip_bound));
+}
+
+int main(int argc, char ** argv){
+    MGARD::ThreadPool pool(3);
+    const vector<vector<size_t>> shapes = {{100001}, {1000, 999}, {129, 128, 65}, {7, 1000, 3}};
+    for(const auto& dims:shapes){
+        for(int kind=0; kind<2; kind++){
+            test(dims, kind, MGARD::SOLVER_THOMAS, NULL);
+        }
+    }
+    test({257, 256, 33}, 1, MGARD::SOLVER_DECAY, NULL);
+    test({257, 256, 33}, 1, MGARD::SOLVER_THOMAS, &pool);
+    test({100001}, 0, MGARD::SOLVER_DECAY, &pool);
+    return report();
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "multi_component.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+string describe(const vector<size_t>& dims, bool lorenzo){
+    return describe(dims) + (lorenzo ? ", Lorenzo codes" : "");
+}
+
+// interleaved field of C components, each a different smooth function with noise
+template <class T, int C>
+vector<T> generate_components(size_t num_points){
+    vector<T> data(num_points * C);
+    srand(7);
+    for(size_t i=0; i<num_points; i++){
+        for(int c=0; c<C; c++){
+            data[i*C + c] = (c + 1) * sin(0.03 * (c + 1) * i) + (T) rand() / RAND_MAX;
+        }
+    }
+    return data;
+}
+
+// largest difference between the interleaved values and the scalar ones of each
+// component, in units of the machine epsilon times the largest value of the component
+template <int C, class T>
+double get_max_ulps(const vector<T>& interleaved, const vector<vector<T>>& components){
+    size_t num_points = interleaved.size() / C;
+    double max_ulps = 0;
+    for(int c=0; c<C; c++){
+        double max_value = 0, error = 0;
+        for(size_t i=0; i<num_points; i++){
+            max_value = max(max_value, (double) fabs(components[c][i]));
+            error = max(error, fabs((double) interleaved[i*C + c] - components[c][i]));
+        }
+        max_ulps = max(max_ulps, error / (max_value * numeric_limits<T>::epsilon()));
+    }
+    return max_ulps;
+}
+
+// MultiComponentDecomposer<T, C> against C scalar decompositions of the
+// deinterleaved components: coefficients, nodal codes and recomposition
+// the component loops run the same operations as the scalar kernel, but the compiler
+// may fuse multiply-adds (e.g. with -mfma or MGARDX_ENABLE_AVX512) in one and not in
+// the other, so the results agree up to a few ulp instead of bitwise
+const double max_ulps = 8;
+template <class T, int C>
+void test_components(const vector<size_t>& dims, int target_level, bool lorenzo){
+    size_t num_points = get_num_elements(dims);
+    auto data = generate_components<T, C>(num_points);
+    vector<vector<T>> expected(C, vector<T>(num_points));
+    for(size_t i=0; i<num_points; i++){
+        for(int c=0; c<C; c++){
+            expected[c][i] = data[i*C + c];
+        }
+    }
+    // component c gets its own error bound, component 1 none
+    MGARD::Components<T, C> eb;
+    for(int c=0; c<C; c++){
+        eb.v[c] = (lorenzo && (c != 1)) ? 1e-3 * (c + 1) : 0;
+    }
+    vector<MGARD::LorenzoCodes<T>> scalar_codes(C);
+    for(int c=0; c<C; c++){
+        MGARD::Decomposer<T> decomposer;
+        decomposer.set_nodal_error_bound(eb.v[c]);
+        decomposer.decompose(expected[c].data(), dims, target_level);
+        scalar_codes[c] = decomposer.get_nodal_codes();
+    }
+    vector<T> coeff(data);
+    MGARD::MultiComponentDecomposer<T, C> decomposer;
+    decomposer.set_nodal_error_bound(eb);
+    int levels = decomposer.decompose(MGARD::as_components<C>(coeff.data()), dims, target_level);
+    double coefficient_ulps = get_max_ulps<C>(coeff, expected);
+    check(coefficient_ulps <= max_ulps, describe(dims, lorenzo) + ": coefficients within " + format(coefficient_ulps) + " ulp of the scalar decompositions");
+    if(lorenzo){
+        const auto& codes = decomposer.get_nodal_codes();
+        bool same_codes = true;
+        for(int c=0; c<C; c++){
+            if((codes.component[c].codes != scalar_codes[c].codes) || (codes.component[c].unpredictable != scalar_codes[c].unpredictable)) same_codes = false;
+        }
+        check(same_codes && scalar_codes[1].codes.empty() && !scalar_codes[0].codes.empty(), describe(dims, lorenzo) + ": per-component codes match the scalar ones");
+    }
+    // recomposition from the coefficients (and codes), against the scalar recompositions
+    for(int c=0; c<C; c++){
+        MGARD::Recomposer<T> recomposer;
+        recomposer.set_nodal_codes(lorenzo ? &scalar_codes[c] : NULL);
+        recomposer.recompose(expected[c].data(), dims, levels);
+    }
+    MGARD::MultiComponentRecomposer<T, C> recomposer;
+    recomposer.set_nodal_codes(lorenzo ? &decomposer.get_nodal_codes() : NULL);
+    recomposer.recompose(MGARD::as_components<C>(coeff.data()), dims, levels);
+    double error = 0;
+    for(size_t i=0; i<num_points; i++){
+        for(int c=0; c<C; c++){
+            error = max(error, fabs((double) coeff[i*C + c] - data[i*C + c]) - eb.v[c]);
+        }
+    }
+    double value_ulps = get_max_ulps<C>(coeff, expected);
+    check(value_ulps <= max_ulps, describe(dims, lorenzo) + ": recomposition within " + format(value_ulps) + " ulp of the scalar recompositions");
+    // the Lorenzo stage is the only loss, up to rounding
+    check(error <= 1e-4, describe(dims, lorenzo) + ": recomposition within the nodal error bounds");
+}
+
+int main(int argc, char ** argv){
+    vector<vector<size_t>> shapes = {{65}, {64}, {17, 33}, {16, 32}, {9, 16, 7}, {8, 8, 8}, {3, 40, 12}};
+    for(const auto& dims:shapes){
+        test_components<float, 3>(dims, 3, false);
+        test_components<float, 3>(dims, 3, true);
+    }
+    test_components<double, 3>({33, 17, 9}, 4, true);
+    test_components<double, 2>({31, 32}, 4, false);
+    return report();
+}
@@ -0,0 +1,113 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "decompose.hpp"
+#include "nonuniform.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+string describe(const vector<size_t>& dims, bool hierarchical){
+    return describe(dims) + (hierarchical ? ", hierarchical" : "");
+}
+
+// coordinates x[d][i] of point i along dimension d: uniform (0, 1, 2, ...) or stretched
+// with a spacing that grows by 5% per point, as for a boundary layer
+vector<vector<double>> init_coordinates(const vector<size_t>& dims, bool stretched){
+    vector<vector<double>> coords(dims.size());
+    for(size_t d=0; d<dims.size(); d++){
+        coords[d].resize(dims[d]);
+        double x = 0, spacing = 1;
+        for(size_t i=0; i<dims[d]; i++){
+            coords[d][i] = x;
+            x += spacing;
+            if(stretched) spacing *= 1.05;
+        }
+    }
+    return coords;
+}
+
+// uniform coordinates reproduce the coefficients of Decomposer
+template <class T>
+void test_uniform(const vector<size_t>& dims, bool hierarchical, MGARD::ThreadPool * pool, double tolerance){
+    auto data = generate_data<T>(get_num_elements(dims), 9, 0.07);
+    vector<T> expected(data);
+    MGARD::Decomposer<T> decomposer;
+    int levels = decomposer.decompose(expected.data(), dims, 10, hierarchical);
+    MGARD::NonUniformDecomposer<T> nonuniform;
+    nonuniform.set_thread_pool(pool);
+    nonuniform.set_coordinates(init_coordinates(dims, false));
+    int nonuniform_levels = nonuniform.decompose(data.data(), dims, 10, hierarchical);
+    double error = 0, max_value = 0;
+    for(size_t i=0; i<data.size(); i++){
+        error = max(error, (double) fabs(data[i] - expected[i]));
+        max_value = max(max_value, (double) fabs(expected[i]));
+    }
+    check((levels == nonuniform_levels) && (error <= tolerance * max_value), describe(dims, hierarchical) + ": uniform coordinates give the coefficients of Decomposer");
+}
+
+// stretched coordinates: exact round trip, and no coefficients for a multilinear field
+template <class T>
+void test_stretched(const vector<size_t>& dims, bool hierarchical, MGARD::ThreadPool * pool, double tolerance){
+    auto coords = init_coordinates(dims, true);
+    auto data = generate_data<T>(get_num_elements(dims), 9, 0.07);
+    vector<T> coeff(data);
+    MGARD::NonUniformDecomposer<T> decomposer;
+    decomposer.set_thread_pool(pool);
+    decomposer.set_coordinates(coords);
+    int levels = decomposer.decompose(coeff.data(), dims, 10, hierarchical);
+    MGARD::NonUniformRecomposer<T> recomposer;
+    recomposer.set_thread_pool(pool);
+    recomposer.set_coordinates(coords);
+    recomposer.recompose(coeff.data(), dims, levels, hierarchical);
+    double error = 0, max_value = 0;
+    for(size_t i=0; i<data.size(); i++){
+        error = max(error, (double) fabs(coeff[i] - data[i]));
+        max_value = max(max_value, (double) fabs(data[i]));
+    }
+    check((levels > 0) && (error <= tolerance * max_value), describe(dims, hierarchical) + ": stretched grid round trip");
+    // f = prod_d (1 + x_d) is multilinear, so it is its own interpolant on every level
+    // and all coefficients vanish, which fails for stencils built on the wrong coordinates
+    vector<T> linear(data.size());
+    max_value = 0;
+    for(size_t i=0; i<linear.size(); i++){
+        size_t index = i;
+        double value = 1;
+        for(int d=dims.size()-1; d>=0; d--){
+            value *= 1 + coords[d][index % dims[d]];
+            index /= dims[d];
+        }
+        linear[i] = value;
+        max_value = max(max_value, value);
+    }
+    decomposer.decompose(linear.data(), dims, levels, hierarchical);
+    auto level_dims = MGARD::init_levels(dims, levels);
+    double coefficient = 0;
+    for(size_t i=0; i<linear.size(); i++){
+        // values inside the coarsest level box are the nodal values of level 0
+        size_t index = i;
+        bool nodal_value = true;
+        for(int d=dims.size()-1; d>=0; d--){
+            if(index % dims[d] >= level_dims[0][d]) nodal_value = false;
+            index /= dims[d];
+        }
+        if(!nodal_value) coefficient = max(coefficient, (double) fabs(linear[i]));
+    }
+    check(coefficient <= tolerance * max_value, describe(dims, hierarchical) + ": multilinear field has no coefficients on a stretched grid");
+}
+
+int main(int argc, char ** argv){
+    MGARD::ThreadPool pool(3);
+    vector<vector<size_t>> shapes = {{65}, {64}, {33, 17}, {32, 16}, {17, 9, 33}, {16, 8, 12}, {5, 40, 9}};
+    for(const auto& dims:shapes){
+        for(bool hierarchical:{false, true}){
+            test_uniform<double>(dims, hierarchical, NULL, 1e-12);
+            test_stretched<double>(dims, hierarchical, NULL, 1e-12);
+        }
+        test_uniform<float>(dims, false, &pool, 1e-5);
+        test_stretched<float>(dims, false, &pool, 1e-5);
+    }
+    return report();
+}
@@ -4,77 +4,107 @@
 #include <vector>
 #include <iomanip>
 #include <cmath>
+#include <limits>
 #include "utils.hpp"
-#include "reorder.hpp"
-#include "misc.hpp"
-#include "correction.hpp"
+#include "operator_norm.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
 
 using namespace MGARD;
 
-template<class T>
-std::vector<double> compute_operator_norm_3D(T * Q, const vector<size_t>& dims, size_t target_level, double s){
-    const int default_batch_size = 32;
-    size_t n1 = dims[0];
-    size_t n2 = dims[1];
-    size_t n3 = dims[2];
-    size_t dim0_stride = dims[1] * dims[2];
-    size_t dim1_stride = dims[2];
-    size_t n1_nodal = (n1 >> 1) + 1;
-    size_t n = n1 * n2 * n3;
-    const T h = 1;
-    T * data_buffer = (T *) malloc(n * sizeof(T));
-    T * Q_copy = (T *) malloc(n * sizeof(T));
-    T * load_v_buffer = (T *) malloc(default_batch_size * (*max_element(dims.begin(), dims.end())) * sizeof(T));
-    vector<double> operater_norm(target_level + 1, 0);
-    // compute eta_L
-    data_reorder_3D(Q, data_buffer, n1, n2, n3, dim0_stride, dim1_stride);
-    data_copy_3D(Q_copy, Q, n1, n2, n3, dim0_stride, dim1_stride);
-    compute_correction_3D(Q, data_buffer, load_v_buffer, n1, n2, n3, n1_nodal, h, dim0_stride, dim1_stride, default_batch_size);
-    double prev_level_norm = dot_product_3D(Q, Q_copy, n1, n2, n3, dim0_stride, dim1_stride);
-    for(int i=0; i<target_level; i++){
-        restriction_3D(Q, n1, n2, n3, dim0_stride, dim1_stride);
-        data_reorder_3D(Q, data_buffer, n1, n2, n3, dim0_stride, dim1_stride);
-        data_copy_3D(Q_copy, Q, n1, n2, n3, dim0_stride, dim1_stride);    
-        compute_correction_3D(Q, data_buffer, load_v_buffer, n1, n2, n3, n1_nodal, h, dim0_stride, dim1_stride, default_batch_size);
-        n1 = (n1 >> 1) + 1;
-        n2 = (n2 >> 1) + 1;
-        n3 = (n3 >> 1) + 1;
-        double level_norm = dot_product_3D(Q, Q_copy, n1, n2, n3, dim0_stride, dim1_stride);
-        operater_norm[target_level - i] = pow(2, -2*s*(target_level - i)) * (prev_level_norm - level_norm);
-        prev_level_norm = level_norm;
+double elapsed(const struct timespec& start, const struct timespec& end){
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+}
+
+// f = 1 + sum_d (d + 1) x_d / n_d is linear, so Q_l f = f on every level
+template <class T>
+vector<T> generate_linear(const vector<size_t>& dims){
+    vector<T> data(get_num_elements(dims));
+    for(size_t i=0; i<data.size(); i++){
+        size_t index = i;
+        double value = 1;
+        for(int d=dims.size()-1; d>=0; d--){
+            value += (d + 1) * (double) (index % dims[d]) / dims[d];
+            index /= dims[d];
+        }
+        data[i] = value;
     }
-    operater_norm[0] = prev_level_norm;
-    free(data_buffer);
-    free(Q_copy);
-    free(load_v_buffer);
-    return operater_norm;
+    return data;
 }
 
+// the level norms and weights do not depend on the number of threads, the detail
+// levels of a linear field vanish, and for s = 0 the level norms add up to ||u||^2
+// on grids without virtual nodes
+template <class T>
+void check_operator_norm(const vector<T>& data, const vector<size_t>& dims, int target_level, double s, int num_threads){
+    const double tolerance = 100 * numeric_limits<T>::epsilon();
+    ThreadPool pool(num_threads);
+    OperatorNorm<T> operator_norm, serial_operator_norm;
+    operator_norm.set_thread_pool(&pool);
+    check(operator_norm.compute(data.data(), dims, target_level, s) == serial_operator_norm.compute(data.data(), dims, target_level, s), describe(dims) + ": level norms independent of the number of threads");
+    check(operator_norm.get_level_weights(dims, target_level, s) == serial_operator_norm.get_level_weights(dims, target_level, s), describe(dims) + ": level weights independent of the number of threads");
+    auto linear = generate_linear<T>(dims);
+    auto norms = operator_norm.compute(linear.data(), dims, target_level, s);
+    double detail = 0;
+    for(int l=1; l<norms.size(); l++){
+        detail = max(detail, fabs(norms[l]));
+    }
+    check(detail <= tolerance * norms[0], describe(dims) + ": detail levels of a linear field vanish (" + format(detail / norms[0]) + " of level 0)");
+    // virtual nodes extend the domain of the levels, unless every dimension is 2^k + 1
+    bool extended = false;
+    for(const auto& d:dims){
+        if((d - 1) & (d - 2)) extended = true;
+    }
+    if(extended) return;
+    norms = operator_norm.compute(data.data(), dims, target_level, 0);
+    double sum = 0;
+    for(const auto& norm:norms){
+        sum += norm;
+    }
+    double energy = operator_norm.compute(data.data(), dims, 0, 0)[0];
+    check(fabs(sum - energy) <= tolerance * energy, describe(dims) + ": level norms add up to ||u||^2 (" + format(fabs(sum - energy) / energy) + ")");
+}
 
 template <class T>
-void test_operator_norm(vector<T>& data, const vector<size_t>& dims, int target_level, double s){
+void test_operator_norm(vector<T>& data, const vector<size_t>& dims, int target_level, double s, int num_threads){
     struct timespec start, end;
-    int err = 0;
-    err = clock_gettime(CLOCK_REALTIME, &start);
-    auto norm = compute_operator_norm_3D(data.data(), dims, target_level, s);
-    err = clock_gettime(CLOCK_REALTIME, &end);
-    cout << "Computing operator norm time: " << (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000 << "s" << endl;
+    ThreadPool pool(num_threads);
+    OperatorNorm<T> operator_norm;
+    operator_norm.set_thread_pool(&pool);
+    clock_gettime(CLOCK_REALTIME, &start);
+    auto norm = operator_norm.compute(data.data(), dims, target_level, s);
+    clock_gettime(CLOCK_REALTIME, &end);
+    cout << "Computing operator norm time: " << elapsed(start, end) << "s" << endl;
     cout << "Level operator norms:" << endl;
     for(const auto& norm_l:norm){
         cout << norm_l << endl;
     }
     cout << endl;
+    clock_gettime(CLOCK_REALTIME, &start);
+    auto weights = operator_norm.get_level_weights(dims, target_level, s);
+    clock_gettime(CLOCK_REALTIME, &end);
+    cout << "Computing level weights time: " << elapsed(start, end) << "s" << endl;
+    clock_gettime(CLOCK_REALTIME, &start);
+    operator_norm.get_level_weights(dims, target_level, s);
+    clock_gettime(CLOCK_REALTIME, &end);
+    cout << "Cached level weights time: " << elapsed(start, end) << "s" << endl;
+    cout << "Level weights:" << endl;
+    for(const auto& weight:weights){
+        cout << weight << endl;
+    }
+    cout << endl;
+    check_operator_norm(data, dims, target_level, s, num_threads);
 }
 
 template <class T>
-void test(string filename, const vector<size_t>& dims, int target_level, double s){
+void test(string filename, const vector<size_t>& dims, int target_level, double s, int num_threads){
     size_t num_elements = 0;
-    auto data = MGARD::readfile<T>(filename.c_str(), num_elements);
-    test_operator_norm(data, dims, target_level, s);
+    auto data = (filename == "-") ? generate_data<T>(get_num_elements(dims), 1) : MGARD::readfile<T>(filename.c_str(), num_elements);
+    test_operator_norm(data, dims, target_level, s, num_threads);
 }
 
 int main(int argc, char ** argv){
-    string filename = string(argv[1]);
+    string filename = string(argv[1]); // "-" for generated data
     int type = atoi(argv[2]); // 0 for float, 1 for double
     int target_level = atoi(argv[3]);
     double s = atof(argv[4]);
@@ -85,21 +115,23 @@ int main(int argc, char ** argv){
        cout << dims[i] << " ";
     }
     cout << endl;
+    // optional, after the dimensions
+    int num_threads = (argc > 6 + num_dims) ? atoi(argv[6 + num_dims]) : 1;
     fflush(stdout);
     switch(type){
         case 0:
             {
-                test<float>(filename, dims, target_level, s);
+                test<float>(filename, dims, target_level, s, num_threads);
                 break;
             }
         case 1:
             {
-                test<double>(filename, dims, target_level, s);
+                test<double>(filename, dims, target_level, s, num_threads);
                 break;
             }
         default:
             cerr << "Only 0 (float) and 1 (double) are implemented in this test\n";
             exit(0);
     }
-    return 0;
-}
\ No newline at end of file
+    return report();
+}
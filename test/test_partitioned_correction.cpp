@@ -0,0 +1,53 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "correction.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+// compute_correction_partitioned on a pool of num_threads threads against the Thomas
+// algorithm of compute_correction: lines too short for two partitions fall back to
+// it and match bitwise, the others agree up to rounding (the spikes are truncated
+// where they are far below the precision of T, see partitioned_spike_length)
+template <class T>
+void test_partitioned(size_t n_nodal, int num_threads){
+    const double eps = numeric_limits<T>::epsilon();
+    auto load_v = generate_data<T>(n_nodal, n_nodal + num_threads);
+    vector<T> expected(n_nodal), correction(n_nodal, 0);
+    vector<T> load_v_buffer(load_v);
+    MGARD::compute_correction(expected.data(), n_nodal, (T) 1, load_v_buffer.data());
+    load_v_buffer = load_v;
+    MGARD::ThreadPool pool(num_threads);
+    MGARD::compute_correction_partitioned(correction.data(), n_nodal, (T) 1, load_v_buffer.data(), &pool);
+    size_t num_partitions = min((size_t) num_threads, n_nodal / (2 * MGARD::partitioned_spike_length));
+    string name = to_string(8 * sizeof(T)) + "-bit, " + to_string(n_nodal) + " nodal values, " + to_string(num_threads) + " threads";
+    if(num_partitions < 2){
+        check(correction == expected, name + ": Thomas algorithm (too short to partition)");
+        return;
+    }
+    double max_value = 0, error = 0;
+    for(size_t i=0; i<n_nodal; i++){
+        max_value = max(max_value, (double) fabs(expected[i]));
+        error = max(error, (double) fabs(correction[i] - expected[i]));
+    }
+    // both solves are backward stable on the diagonally dominant M_l, whose inverse
+    // has a norm of at most 3
+    check(error <= 8 * eps * max_value, name + ": " + to_string(num_partitions) + " partitions within " + format(error / (eps * max_value)) + " eps max|x| of the Thomas algorithm");
+}
+
+int main(int argc, char ** argv){
+    // shorter than the number of threads, shorter than two spikes per partition,
+    // at and around the partition boundaries, and long lines
+    vector<size_t> sizes = {1, 2, 3, 5, 255, 300, 511, 512, 513, 1000, 1025, 10000, 65537, 200003};
+    for(int num_threads:{2, 3, 4, 7, 16}){
+        for(size_t n_nodal:sizes){
+            test_partitioned<float>(n_nodal, num_threads);
+            test_partitioned<double>(n_nodal, num_threads);
+        }
+    }
+    return report();
+}
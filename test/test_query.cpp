@@ -0,0 +1,93 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "query.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+string describe(const vector<size_t>& dims, bool hierarchical){
+    return describe(dims) + (hierarchical ? ", hierarchical" : "");
+}
+
+// every value of the grid from query, compared with Recomposer
+template <class T>
+void test_all_positions(const vector<size_t>& dims, bool hierarchical, double tolerance){
+    size_t num_elements = get_num_elements(dims);
+    auto coeff = generate_data<T>(num_elements, 5);
+    MGARD::Decomposer<T> decomposer;
+    int levels = decomposer.decompose(coeff.data(), dims, 10, hierarchical);
+    vector<T> expected(coeff);
+    MGARD::Recomposer<T> recomposer;
+    recomposer.recompose(expected.data(), dims, levels, hierarchical);
+    MGARD::QueryEngine<T> engine(coeff.data(), dims, levels, hierarchical);
+    engine.recompose_threshold = numeric_limits<double>::infinity();
+    vector<vector<size_t>> positions(num_elements, vector<size_t>(dims.size()));
+    for(size_t i=0; i<num_elements; i++){
+        size_t index = i;
+        for(int k=dims.size()-1; k>=0; k--){
+            positions[i][k] = index % dims[k];
+            index /= dims[k];
+        }
+    }
+    vector<T> values;
+    engine.query(positions, values);
+    double error = 0, max_value = 0;
+    for(size_t i=0; i<num_elements; i++){
+        error = max(error, (double) fabs(values[i] - expected[i]));
+        max_value = max(max_value, (double) fabs(expected[i]));
+    }
+    check(!engine.is_recomposed() && (error <= tolerance * max_value), describe(dims, hierarchical) + ": queries match Recomposer");
+    // with threshold 0 the first query recomposes, and all values come from the grid
+    MGARD::QueryEngine<T> fallback(coeff.data(), dims, levels, hierarchical);
+    fallback.recompose_threshold = 0;
+    fallback.query(positions, values);
+    check(fallback.is_recomposed() && (values == expected), describe(dims, hierarchical) + ": recompose fallback matches Recomposer");
+}
+
+// random probes on a larger grid with the default threshold switch to the
+// recomposed grid part way and keep matching Recomposer
+void test_crossover(const vector<size_t>& dims, size_t num_probes){
+    size_t num_elements = get_num_elements(dims);
+    vector<double> coeff(num_elements);
+    for(size_t i=0; i<num_elements; i++){
+        coeff[i] = sin(0.001 * i) + 0.3 * cos(0.07 * i);
+    }
+    MGARD::Decomposer<double> decomposer;
+    int levels = decomposer.decompose(coeff.data(), dims, 10);
+    vector<double> expected(coeff);
+    MGARD::Recomposer<double> recomposer;
+    recomposer.recompose(expected.data(), dims, levels);
+    MGARD::QueryEngine<double> engine(coeff.data(), dims, levels);
+    srand(11);
+    double error = 0;
+    size_t switched = 0;
+    vector<size_t> position(dims.size());
+    for(size_t p=0; p<num_probes; p++){
+        size_t offset = 0;
+        for(int k=0; k<dims.size(); k++){
+            position[k] = rand() % dims[k];
+            offset = offset * dims[k] + position[k];
+        }
+        error = max(error, fabs(engine.query(position) - expected[offset]));
+        if(!switched && engine.is_recomposed()) switched = p + 1;
+    }
+    check((switched > 1) && (switched < num_probes), describe(dims, false) + ": random probes switch to the recomposed grid after " + to_string(switched) + " probes");
+    check(error <= 1e-12, describe(dims, false) + ": values match Recomposer across the switch");
+}
+
+int main(int argc, char ** argv){
+    const vector<vector<size_t>> shapes = {{33}, {64}, {17, 20}, {16, 33}, {9, 12, 17}, {10, 8, 16}, {5, 64, 9}, {1, 40, 7}};
+    for(const auto& dims:shapes){
+        for(int hierarchical=0; hierarchical<2; hierarchical++){
+            test_all_positions<double>(dims, hierarchical, 1e-12);
+        }
+    }
+    test_all_positions<float>({17, 18, 19}, false, 1e-5);
+    test_crossover({65, 64, 63}, 2000);
+    return report();
+}
@@ -0,0 +1,91 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "rate_control.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+string describe(const vector<size_t>& dims, bool hierarchical){
+    return describe(dims) + (hierarchical ? ", hierarchical" : "");
+}
+
+// RateController over increasing budgets: each allocation meets its target rate, and
+// a larger budget gives no larger bin width on any level, a rate that does not
+// decrease and a reconstruction error that does not increase
+template <class T>
+void test_budgets(const vector<size_t>& dims, bool hierarchical, MGARD::ThreadPool * pool){
+    size_t num_elements = get_num_elements(dims);
+    auto data = generate_data<T>(num_elements, num_elements, 0.05);
+    vector<T> coeff(data);
+    MGARD::Decomposer<T> decomposer;
+    size_t levels = decomposer.decompose(coeff.data(), dims, 10, hierarchical);
+    string name = to_string(8 * sizeof(T)) + "-bit " + describe(dims, hierarchical);
+    MGARD::RateAllocation previous;
+    double previous_error = 0;
+    for(double target_bits:{0.5, 1.0, 2.0, 4.0, 8.0}){
+        string target_name = name + ", " + format(target_bits) + " bits";
+        vector<T> quantized(coeff);
+        vector<int> codes;
+        MGARD::RateController<T> controller;
+        auto allocation = controller.quantize(quantized.data(), dims, levels, target_bits, codes, hierarchical);
+        // the controller accepts tolerance after its last pass; allow twice that
+        double deviation = fabs(allocation.bits_per_value - target_bits) / target_bits;
+        check(deviation <= 2 * controller.tolerance, target_name + ": " + format(allocation.bits_per_value) + " bits per value in " + to_string(allocation.passes) + " passes");
+        // the rate adds up over the levels, and the values are the dequantized codes
+        auto level_errors = MGARD::compute_level_errors(coeff.data(), coeff.data(), dims, levels);
+        double total_bits = 0;
+        for(size_t l=0; l<=levels; l++){
+            total_bits += allocation.bits[l] * level_errors.count[l];
+        }
+        bool dequantized = true;
+        MGARD::for_each_level_value(dims, MGARD::init_levels(dims, levels), NULL, [&](size_t b, size_t p, int l){
+            if(quantized[p] != (T) (codes[p] * allocation.bin_width[l])) dequantized = false;
+        });
+        check((fabs(total_bits - allocation.bits_per_value * num_elements) <= 1e-6 * total_bits) && dequantized, target_name + ": level rates and dequantized values are consistent");
+        vector<int> pooled_codes;
+        vector<T> pooled_quantized(coeff);
+        MGARD::RateController<T> pooled_controller;
+        pooled_controller.set_thread_pool(pool);
+        auto pooled_allocation = pooled_controller.quantize(pooled_quantized.data(), dims, levels, target_bits, pooled_codes, hierarchical);
+        check((pooled_codes == codes) && (pooled_allocation.bits_per_value == allocation.bits_per_value), target_name + ": pooled allocation equals the serial one");
+        MGARD::Recomposer<T> recomposer;
+        recomposer.recompose(quantized.data(), dims, levels, hierarchical);
+        double error = 0;
+        for(size_t i=0; i<num_elements; i++){
+            error += ((double) quantized[i] - data[i]) * ((double) quantized[i] - data[i]);
+        }
+        error = sqrt(error / num_elements);
+        if(!previous.bin_width.empty()){
+            bool finer = true;
+            for(size_t l=0; l<=levels; l++){
+                // 0 stands for a dropped level
+                double width = allocation.bin_width[l], previous_width = previous.bin_width[l];
+                if((previous_width > 0) && ((width == 0) || (width > previous_width))) finer = false;
+            }
+            check(finer && (allocation.bits_per_value >= previous.bits_per_value) && (error <= previous_error), target_name + ": bin widths, rate and RMSE " + format(error) + " monotonic in the budget");
+        }
+        previous = allocation;
+        previous_error = error;
+    }
+}
+
+int main(int argc, char ** argv){
+    MGARD::ThreadPool pool(3);
+    vector<vector<size_t>> shapes = {{100000}, {257, 200}, {65, 64, 33}};
+    for(const auto& dims:shapes){
+        test_budgets<float>(dims, false, &pool);
+        test_budgets<double>(dims, true, &pool);
+    }
+    // all-zero fields drop every level, at rate 0
+    vector<float> zeros(1000, 0);
+    vector<int> codes;
+    MGARD::RateController<float> controller;
+    auto allocation = controller.quantize(zeros.data(), {1000}, 5, 2.0, codes);
+    check((allocation.bits_per_value == 0) && (codes == vector<int>(1000, 0)), "all-zero field: rate 0");
+    return report();
+}
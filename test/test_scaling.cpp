@@ -0,0 +1,231 @@
+#include <iostream>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <iomanip>
+#include <cmath>
+#include <thread>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "thread_pool.hpp"
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+double elapsed(const struct timespec& start, const struct timespec& end){
+    return (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec)/(double)1000000000;
+}
+
+// smooth field with some noise, used when no input file is given
+template <class T>
+vector<T> generate_data(const vector<size_t>& dims){
+    size_t num_elements = 1;
+    for(const auto& d:dims) num_elements *= d;
+    vector<T> data(num_elements);
+    srand(1);
+    for(size_t i=0; i<num_elements; i++){
+        size_t index = i;
+        double value = 0;
+        for(int k=dims.size()-1; k>=0; k--){
+            value += sin(0.05 * (k + 1) * (index % dims[k]));
+            index /= dims[k];
+        }
+        data[i] = value + 0.01 * rand() / RAND_MAX;
+    }
+    return data;
+}
+
+// counts the dTLB load misses of this process and of the threads it starts afterwards
+// (so it must be started before the ThreadPool); -1 if perf events are not available
+class TLBMissCounter{
+public:
+    void start(){
+#if defined(__linux__) && defined(SYS_perf_event_open)
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        if(fd >= 0){
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    long long stop(){
+        long long count = -1;
+#ifdef __linux__
+        if(fd >= 0){
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if(read(fd, &count, sizeof(count)) != sizeof(count)) count = -1;
+            close(fd);
+            fd = -1;
+        }
+#endif
+        return count;
+    }
+private:
+    int fd = -1;
+};
+
+// compare the workspace policies with num_threads threads: time, effective bandwidth
+// (one read and one write of the field per call, in GB/s) and dTLB load misses
+// of decomposition and recomposition; returns 1 if a policy changes the coefficients
+template <class T>
+int report_policies(const vector<T>& data_ori, const vector<size_t>& dims, int target_level, int num_threads){
+    const char * names[4] = {"malloc", "huge_pages", "huge_pages+first_touch", "huge_pages+interleave"};
+    double bytes = 2.0 * data_ori.size() * sizeof(T);
+    vector<T> base_coefficients;
+    int status = 0;
+    cout << "policy decompose(s) GB/s dTLB-misses recompose(s) GB/s dTLB-misses (" << num_threads << " threads)" << endl;
+    for(int policy_id=0; policy_id<4; policy_id++){
+        MGARD::MemoryPolicy policy;
+        policy.huge_pages = (policy_id >= 1);
+        policy.first_touch = (policy_id == 2);
+        policy.interleave = (policy_id == 3);
+        auto data(data_ori);
+        struct timespec start, end;
+        TLBMissCounter counter;
+        counter.start();
+        MGARD::ThreadPool pool(num_threads);
+        MGARD::Decomposer<T> decomposer;
+        decomposer.set_thread_pool(&pool);
+        decomposer.set_memory_policy(policy);
+        clock_gettime(CLOCK_REALTIME, &start);
+        decomposer.decompose(data.data(), dims, target_level);
+        clock_gettime(CLOCK_REALTIME, &end);
+        long long decompose_misses = counter.stop();
+        double decompose_time = elapsed(start, end);
+        if(policy_id == 0) base_coefficients = data;
+        else if(data != base_coefficients){
+            cerr << "coefficients with policy " << names[policy_id] << " differ from the malloc ones" << endl;
+            status = 1;
+        }
+        // the threads of pool already exist and would not be counted,
+        // so recomposition gets a fresh pool
+        TLBMissCounter recompose_counter;
+        recompose_counter.start();
+        MGARD::ThreadPool recompose_pool(num_threads);
+        MGARD::Recomposer<T> recomposer;
+        recomposer.set_thread_pool(&recompose_pool);
+        recomposer.set_memory_policy(policy);
+        clock_gettime(CLOCK_REALTIME, &start);
+        recomposer.recompose(data.data(), dims, target_level);
+        clock_gettime(CLOCK_REALTIME, &end);
+        long long recompose_misses = recompose_counter.stop();
+        double recompose_time = elapsed(start, end);
+        cout << names[policy_id] << " " << decompose_time << " " << bytes / decompose_time * 1e-9 << " ";
+        if(decompose_misses >= 0) cout << decompose_misses;
+        else cout << "n/a";
+        cout << " " << recompose_time << " " << bytes / recompose_time * 1e-9 << " ";
+        if(recompose_misses >= 0) cout << recompose_misses;
+        else cout << "n/a";
+        cout << endl;
+    }
+    return status;
+}
+
+// time decomposition and recomposition with 1 to max_threads threads
+// and print the scaling curve; returns 1 if a thread count changes the coefficients
+// or the recomposed data
+template <class T>
+int test(string filename, const vector<size_t>& dims, int target_level, int max_threads, const MGARD::MemoryPolicy& policy, bool report){
+    size_t num_elements = 0;
+    auto data_ori = (filename == "-") ? generate_data<T>(dims) : MGARD::readfile<T>(filename.c_str(), num_elements);
+    double base_decompose_time = 0;
+    double base_recompose_time = 0;
+    vector<T> base_coefficients, base_values;
+    int status = 0;
+    cout << "threads decompose(s) speedup efficiency recompose(s) speedup efficiency" << endl;
+    for(int num_threads=1; num_threads<=max_threads; num_threads++){
+        auto data(data_ori);
+        struct timespec start, end;
+        MGARD::ThreadPool pool(num_threads);
+        MGARD::Decomposer<T> decomposer;
+        decomposer.set_thread_pool(&pool);
+        decomposer.set_memory_policy(policy);
+        clock_gettime(CLOCK_REALTIME, &start);
+        decomposer.decompose(data.data(), dims, target_level);
+        clock_gettime(CLOCK_REALTIME, &end);
+        double decompose_time = elapsed(start, end);
+        // line solves are independent, so the coefficients must not depend on the thread count
+        if(num_threads == 1) base_coefficients = data;
+        else if(data != base_coefficients){
+            cerr << "coefficients with " << num_threads << " threads differ from the sequential ones" << endl;
+            status = 1;
+        }
+        MGARD::Recomposer<T> recomposer;
+        recomposer.set_thread_pool(&pool);
+        recomposer.set_memory_policy(policy);
+        clock_gettime(CLOCK_REALTIME, &start);
+        recomposer.recompose(data.data(), dims, target_level);
+        clock_gettime(CLOCK_REALTIME, &end);
+        double recompose_time = elapsed(start, end);
+        // levels overlap in the task graph, which must not change the result either
+        if(num_threads == 1) base_values = data;
+        else if(data != base_values){
+            cerr << "recomposed data with " << num_threads << " threads differs from the sequential one" << endl;
+            status = 1;
+        }
+        if(num_threads == 1){
+            base_decompose_time = decompose_time;
+            base_recompose_time = recompose_time;
+        }
+        double decompose_speedup = base_decompose_time / decompose_time;
+        double recompose_speedup = base_recompose_time / recompose_time;
+        cout << num_threads << " " << decompose_time << " " << decompose_speedup << " " << decompose_speedup / num_threads << " " << recompose_time << " " << recompose_speedup << " " << recompose_speedup / num_threads << endl;
+    }
+    if(report) status |= report_policies(data_ori, dims, target_level, max_threads);
+    return status;
+}
+
+int main(int argc, char ** argv){
+    string filename = string(argv[1]); // "-" for generated data
+    int type = atoi(argv[2]); // 0 for float, 1 for double
+    int target_level = atoi(argv[3]);
+    int max_threads = atoi(argv[4]); // 0 for all hardware threads
+    if(max_threads <= 0) max_threads = max(1u, thread::hardware_concurrency());
+    const int num_dims = atoi(argv[5]);
+    vector<size_t> dims(num_dims);
+    for(int i=0; i<dims.size(); i++){
+       dims[i] = atoi(argv[6 + i]);
+       cout << dims[i] << " ";
+    }
+    cout << endl;
+    // optional workspace policy: 0 malloc, 1 huge pages, 2 huge pages + first touch,
+    // 3 huge pages + interleave; -1 uses malloc and then compares all policies
+    int policy_id = (argc > 6 + num_dims) ? atoi(argv[6 + num_dims]) : 0;
+    bool report = (policy_id < 0);
+    MGARD::MemoryPolicy policy;
+    policy.huge_pages = (policy_id >= 1);
+    policy.first_touch = (policy_id == 2);
+    policy.interleave = (policy_id == 3);
+    int status = 0;
+    switch(type){
+        case 0:
+            {
+                status = test<float>(filename, dims, target_level, max_threads, policy, report);
+                break;
+            }
+        case 1:
+            {
+                status = test<double>(filename, dims, target_level, max_threads, policy, report);
+                break;
+            }
+        default:
+            cerr << "Only 0 (float) and 1 (double) are implemented in this test\n";
+            exit(0);
+    }
+    return status;
+}
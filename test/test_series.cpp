@@ -0,0 +1,73 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+string describe(size_t num_series, size_t n, bool hierarchical, MGARD::SolverMode mode, int num_threads){
+    string name = to_string(num_series) + " series of " + to_string(n);
+    if(hierarchical) name += ", hierarchical";
+    if(mode == MGARD::SOLVER_DECAY) name += ", decay solver";
+    return name + ", " + to_string(num_threads) + " threads";
+}
+
+// decompose_series and recompose_series against decompose and recompose of every
+// series on its own; num_series around and above series_batch_size leaves partial batches
+template <class T>
+void test_series(size_t num_series, size_t n, bool hierarchical, MGARD::SolverMode mode, int num_threads, double tolerance){
+    auto data = generate_data<T>(num_series * n, num_series + n);
+    const size_t target_level = 10;
+    MGARD::ThreadPool pool(num_threads);
+    vector<T> expected(data);
+    MGARD::Decomposer<T> decomposer;
+    decomposer.set_solver_mode(mode);
+    size_t levels = 0;
+    for(size_t s=0; s<num_series; s++){
+        levels = decomposer.decompose(expected.data() + s * n, {n}, target_level, hierarchical);
+    }
+    vector<T> coeff(data);
+    MGARD::Decomposer<T> series_decomposer;
+    series_decomposer.set_solver_mode(mode);
+    if(num_threads > 1) series_decomposer.set_thread_pool(&pool);
+    size_t series_levels = series_decomposer.decompose_series(coeff.data(), num_series, n, target_level, hierarchical);
+    double error = 0, max_value = 0;
+    for(size_t i=0; i<data.size(); i++){
+        error = max(error, (double) fabs(coeff[i] - expected[i]));
+        max_value = max(max_value, (double) fabs(expected[i]));
+    }
+    check((series_levels == levels) && (error <= tolerance * max_value), describe(num_series, n, hierarchical, mode, num_threads) + ": decompose_series matches decompose");
+    MGARD::Recomposer<T> recomposer;
+    recomposer.set_solver_mode(mode);
+    for(size_t s=0; s<num_series; s++){
+        recomposer.recompose(expected.data() + s * n, {n}, levels, hierarchical);
+    }
+    MGARD::Recomposer<T> series_recomposer;
+    series_recomposer.set_solver_mode(mode);
+    if(num_threads > 1) series_recomposer.set_thread_pool(&pool);
+    series_recomposer.recompose_series(coeff.data(), num_series, n, levels, hierarchical);
+    error = 0;
+    double round_trip_error = 0;
+    for(size_t i=0; i<data.size(); i++){
+        error = max(error, (double) fabs(coeff[i] - expected[i]));
+        round_trip_error = max(round_trip_error, (double) fabs(coeff[i] - data[i]));
+    }
+    check(error <= tolerance * max_value, describe(num_series, n, hierarchical, mode, num_threads) + ": recompose_series matches recompose");
+    check(round_trip_error <= 4 * tolerance * max_value, describe(num_series, n, hierarchical, mode, num_threads) + ": round trip");
+}
+
+int main(int argc, char ** argv){
+    for(size_t num_series:{15, 17, 100}){
+        for(size_t n:{65, 64, 37, 5}){
+            test_series<double>(num_series, n, false, MGARD::SOLVER_THOMAS, 1, 1e-13);
+            test_series<double>(num_series, n, true, MGARD::SOLVER_THOMAS, 1, 1e-13);
+            test_series<double>(num_series, n, false, MGARD::SOLVER_DECAY, 3, 1e-13);
+            test_series<float>(num_series, n, false, MGARD::SOLVER_THOMAS, 3, 1e-5);
+        }
+    }
+    return report();
+}
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "thread_pool.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+// value of the cells around and between the data, which must stay untouched
+const double ghost_value = -7777;
+
+// position of the value with row-major index i of dims in an array with the given strides
+size_t get_position(size_t i, const vector<size_t>& dims, const vector<size_t>& strides){
+    size_t pos = 0;
+    for(int d=dims.size()-1; d>=0; d--){
+        pos += (i % dims[d]) * strides[d];
+        i /= dims[d];
+    }
+    return pos;
+}
+
+string describe(const vector<size_t>& dims, size_t ghost, size_t spacing, bool hierarchical, int num_threads){
+    string name = describe(dims) + ", " + to_string(ghost) + " ghost cells, spacing " + to_string(spacing);
+    if(hierarchical) name += ", hierarchical";
+    return name + ", " + to_string(num_threads) + " threads";
+}
+
+// decompose and recompose the interior of a buffer with ghost cells on each side of
+// every dimension and spacing - 1 cells between adjacent values of the last one
+// (spacing > 1 leaves no contiguous dimension); the coefficients and the recomposed
+// data equal the dense run bitwise, and the ghost cells are never written
+template <class T>
+void test_padded(const vector<size_t>& dims, size_t ghost, size_t spacing, bool hierarchical, int num_threads){
+    size_t num_elements = get_num_elements(dims);
+    auto data = generate_data<T>(num_elements, num_elements);
+    vector<size_t> padded_dims(dims);
+    for(auto& d:padded_dims) d += 2 * ghost;
+    auto strides = MGARD::init_strides(padded_dims);
+    for(auto& s:strides) s *= spacing;
+    size_t offset = 0;
+    for(const auto& s:strides) offset += ghost * s;
+    vector<T> padded(get_num_elements(padded_dims) * spacing, ghost_value);
+    vector<bool> interior(padded.size(), false);
+    for(size_t i=0; i<num_elements; i++){
+        size_t pos = offset + get_position(i, dims, strides);
+        padded[pos] = data[i];
+        interior[pos] = true;
+    }
+    auto ghosts_untouched = [&](){
+        for(size_t i=0; i<padded.size(); i++){
+            if(!interior[i] && (padded[i] != (T) ghost_value)) return false;
+        }
+        return true;
+    };
+    auto interior_equals = [&](const vector<T>& dense){
+        for(size_t i=0; i<num_elements; i++){
+            if(padded[offset + get_position(i, dims, strides)] != dense[i]) return false;
+        }
+        return true;
+    };
+    string name = to_string(8 * sizeof(T)) + "-bit " + describe(dims, ghost, spacing, hierarchical, num_threads);
+    const size_t target_level = 10;
+    MGARD::ThreadPool pool(num_threads);
+    vector<T> dense(data);
+    MGARD::Decomposer<T> dense_decomposer;
+    int levels = dense_decomposer.decompose(dense.data(), dims, target_level, hierarchical);
+    MGARD::Decomposer<T> decomposer;
+    if(num_threads > 1) decomposer.set_thread_pool(&pool);
+    int padded_levels = decomposer.decompose(padded.data() + offset, dims, target_level, hierarchical, strides);
+    check((padded_levels == levels) && interior_equals(dense), name + ": coefficients equal the dense decomposition");
+    check(ghosts_untouched(), name + ": decomposition leaves the ghost cells untouched");
+    MGARD::Recomposer<T> dense_recomposer;
+    dense_recomposer.recompose(dense.data(), dims, levels, hierarchical);
+    MGARD::Recomposer<T> recomposer;
+    if(num_threads > 1) recomposer.set_thread_pool(&pool);
+    recomposer.recompose(padded.data() + offset, dims, levels, hierarchical, strides);
+    check(interior_equals(dense), name + ": recomposition equals the dense recomposition");
+    check(ghosts_untouched(), name + ": recomposition leaves the ghost cells untouched");
+}
+
+// strides of dims laid out densely in the given order of dimensions, slowest first
+vector<size_t> init_permuted_strides(const vector<size_t>& dims, const vector<size_t>& order){
+    vector<size_t> strides(dims.size());
+    size_t stride = 1;
+    for(int i=order.size()-1; i>=0; i--){
+        strides[order[i]] = stride;
+        stride *= dims[order[i]];
+    }
+    return strides;
+}
+
+// decompose and recompose data stored with the dimensions in the given order (slowest
+// first; the reversed order is column-major), passed with its strides: the buffer is a
+// row-major array of the permuted dims, whose decomposition it must equal bitwise
+template <class T>
+void test_permuted(const vector<size_t>& dims, const vector<size_t>& order, bool hierarchical, int num_threads){
+    size_t num_elements = get_num_elements(dims);
+    auto data = generate_data<T>(num_elements, num_elements + 1);
+    bool column_major = true;
+    for(int i=0; i<order.size(); i++){
+        if(order[i] != order.size() - 1 - i) column_major = false;
+    }
+    auto strides = column_major ? MGARD::init_column_major_strides(dims) : init_permuted_strides(dims, order);
+    // row-major data of dims, transposed into the layout
+    vector<T> transposed(num_elements);
+    for(size_t i=0; i<num_elements; i++){
+        transposed[get_position(i, dims, strides)] = data[i];
+    }
+    string layout = ", column-major";
+    if(!column_major){
+        layout = ", dimension order";
+        for(const auto& d:order) layout += " " + to_string(d);
+    }
+    string name = to_string(8 * sizeof(T)) + "-bit " + describe(dims) + layout + (hierarchical ? ", hierarchical, " : ", ") + to_string(num_threads) + " threads";
+    const size_t target_level = 10;
+    MGARD::ThreadPool pool(num_threads);
+    auto permuted_dims = MGARD::permute(dims, order);
+    vector<T> expected(transposed);
+    MGARD::Decomposer<T> row_major_decomposer;
+    int levels = row_major_decomposer.decompose(expected.data(), permuted_dims, target_level, hierarchical);
+    vector<T> coeff(transposed);
+    MGARD::Decomposer<T> decomposer;
+    if(num_threads > 1) decomposer.set_thread_pool(&pool);
+    int strided_levels = decomposer.decompose(coeff.data(), dims, target_level, hierarchical, strides);
+    check((strided_levels == levels) && (coeff == expected), name + ": coefficients equal the row-major decomposition of the transpose");
+    MGARD::Recomposer<T> recomposer;
+    if(num_threads > 1) recomposer.set_thread_pool(&pool);
+    recomposer.recompose(coeff.data(), dims, levels, hierarchical, strides);
+    MGARD::Recomposer<T> row_major_recomposer;
+    row_major_recomposer.recompose(expected.data(), permuted_dims, levels, hierarchical);
+    double error = 0;
+    for(size_t i=0; i<num_elements; i++){
+        error = max(error, (double) fabs(coeff[get_position(i, dims, strides)] - data[i]));
+    }
+    check(coeff == expected, name + ": recomposition equals the row-major recomposition of the transpose (round trip error " + format(error) + ")");
+}
+
+int main(int argc, char ** argv){
+    vector<vector<size_t>> shapes = {{1000}, {65, 40}, {64, 33}, {17, 16, 9}, {33, 20, 12}};
+    for(const auto& dims:shapes){
+        for(bool hierarchical:{false, true}){
+            for(int num_threads:{1, 3}){
+                // padded rows, and strided values without a contiguous dimension
+                test_padded<float>(dims, 2, 1, hierarchical, num_threads);
+                test_padded<double>(dims, 2, 1, hierarchical, num_threads);
+                test_padded<float>(dims, 1, 2, hierarchical, num_threads);
+                test_padded<double>(dims, 1, 2, hierarchical, num_threads);
+            }
+        }
+    }
+    vector<vector<size_t>> permuted_shapes = {{65, 40}, {64, 33}, {17, 16, 9}, {33, 20, 12}};
+    for(const auto& dims:permuted_shapes){
+        vector<vector<size_t>> orders = {{1, 0}};
+        if(dims.size() == 3) orders = {{2, 1, 0}, {1, 0, 2}, {2, 0, 1}};
+        for(const auto& order:orders){
+            for(bool hierarchical:{false, true}){
+                for(int num_threads:{1, 3}){
+                    test_permuted<float>(dims, order, hierarchical, num_threads);
+                    test_permuted<double>(dims, order, hierarchical, num_threads);
+                }
+            }
+        }
+    }
+    return report();
+}
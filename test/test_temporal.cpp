@@ -0,0 +1,152 @@
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <cfloat>
+#include "decompose.hpp"
+#include "recompose.hpp"
+#include "temporal.hpp"
+#include "test_helpers.hpp"
+
+using namespace std;
+
+string describe(const vector<size_t>& dims, int radius){
+    return describe(dims) + ", radius " + to_string(radius);
+}
+
+// step t of a slowly moving wave with noise; step 5 jumps, so that
+// small radii leave residuals unpredictable
+template <class T>
+vector<T> generate_step(const vector<size_t>& dims, size_t t){
+    size_t num_elements = get_num_elements(dims);
+    vector<T> data(num_elements);
+    srand(11 + t);
+    double shift = 0.2 * t + ((t == 5) ? 3 : 0);
+    for(size_t i=0; i<num_elements; i++){
+        data[i] = sin(0.05 * i + shift) + 0.01 * rand() / RAND_MAX;
+    }
+    return data;
+}
+
+// every step of a series over several key frames: coefficient errors within the bound
+// of their level, and TemporalRecomposer gives the recomposition of those coefficients
+template <class T>
+void test_series(const vector<size_t>& dims, int target_level, int radius, double tolerance){
+    const size_t num_steps = 11;
+    const vector<double> eb = {1e-4, 1e-3, 1e-2};
+    MGARD::TemporalDecomposer<T> decomposer;
+    decomposer.set_error_bounds(eb);
+    decomposer.set_key_frame_interval(4);
+    MGARD::TemporalRecomposer<T> recomposer;
+    recomposer.set_error_bounds(eb);
+    size_t levels = min((size_t) target_level, MGARD::get_max_level(dims));
+    auto level_dims = MGARD::init_levels(dims, levels);
+    auto bin_width = MGARD::get_temporal_bin_width(eb, levels);
+    bool within_bound = true, same_values = true, recomposed = true;
+    size_t num_key_frames = 0, num_unpredictable = 0;
+    for(size_t t=0; t<num_steps; t++){
+        auto data = generate_step<T>(dims, t);
+        vector<T> exact(data);
+        MGARD::Decomposer<T> reference_decomposer;
+        reference_decomposer.decompose(exact.data(), dims, target_level);
+        MGARD::TemporalFrame<T> frame;
+        frame.radius = radius;
+        decomposer.decompose(data.data(), dims, target_level, frame);
+        num_key_frames += frame.key_frame;
+        num_unpredictable += frame.unpredictable.size();
+        MGARD::for_each_level_value(dims, level_dims, NULL, [&](size_t b, size_t p, int l){
+            if(fabs((double) data[p] - exact[p]) > bin_width[l] / 2 + tolerance * fabs(exact[p])) within_bound = false;
+        });
+        vector<T> expected(data);
+        MGARD::Recomposer<T> reference_recomposer;
+        reference_recomposer.recompose(expected.data(), dims, levels);
+        vector<T> decoded(data.size());
+        recomposed = recomposer.recompose(frame, dims, target_level, decoded.data()) && recomposed;
+        if(decoded != expected) same_values = false;
+    }
+    check(num_key_frames == 3, describe(dims, radius) + ": key frames at steps 0, 4 and 8");
+    check(within_bound, describe(dims, radius) + ": coefficient errors within eb of their level at every step");
+    check(recomposed && same_values, describe(dims, radius) + ": frames recompose to the quantized coefficients");
+    if(radius < 1024) check(num_unpredictable > 0, describe(dims, radius) + ": residuals beyond the radius are stored as is");
+}
+
+// a frame that does not follow the previous one is rejected and data is left untouched
+template <class T>
+void test_out_of_order(const vector<size_t>& dims, int target_level){
+    MGARD::TemporalDecomposer<T> decomposer;
+    decomposer.set_error_bound(1e-3);
+    decomposer.set_key_frame_interval(8);
+    vector<MGARD::TemporalFrame<T>> frames(4);
+    for(size_t t=0; t<frames.size(); t++){
+        auto data = generate_step<T>(dims, t);
+        decomposer.decompose(data.data(), dims, target_level, frames[t]);
+    }
+    MGARD::TemporalRecomposer<T> recomposer;
+    recomposer.set_error_bound(1e-3);
+    vector<T> data(frames[0].codes.size(), -7);
+    vector<T> untouched(data);
+    check(!recomposer.recompose(frames[1], dims, target_level, data.data()) && (data == untouched), describe(dims) + ": frame without its key frame rejected, data untouched");
+    recomposer.recompose(frames[0], dims, target_level, data.data());
+    vector<T> step0(data);
+    check(!recomposer.recompose(frames[2], dims, target_level, data.data()) && (data == step0), describe(dims) + ": skipped frame rejected, data untouched");
+    // a key frame is always accepted and restarts the series
+    check(recomposer.recompose(frames[0], dims, target_level, data.data()) && (data == step0), describe(dims) + ": key frame accepted again");
+    // the rejected frame did not change the reference: the series continues in order
+    vector<T> decoded(data.size());
+    bool in_order = recomposer.recompose(frames[1], dims, target_level, decoded.data()) && recomposer.recompose(frames[2], dims, target_level, decoded.data());
+    MGARD::TemporalRecomposer<T> fresh;
+    fresh.set_error_bound(1e-3);
+    vector<T> expected(data.size());
+    for(int t=0; t<3; t++) fresh.recompose(frames[t], dims, target_level, expected.data());
+    check(in_order && (decoded == expected), describe(dims) + ": in-order frames recompose after a rejection");
+    check(!recomposer.recompose(frames[2], dims, target_level, decoded.data()) && (decoded == expected), describe(dims) + ": repeated frame rejected, data untouched");
+}
+
+// eb = 0 (the default) stores every coefficient as is: the frames recompose to the
+// recomposition of the exact coefficients, and partly lossless bounds keep their levels exact
+template <class T>
+void test_lossless(const vector<size_t>& dims, int target_level, const vector<double>& eb){
+    MGARD::TemporalDecomposer<T> decomposer;
+    MGARD::TemporalRecomposer<T> recomposer;
+    if(!eb.empty()){
+        decomposer.set_error_bounds(eb);
+        recomposer.set_error_bounds(eb);
+    }
+    size_t levels = min((size_t) target_level, MGARD::get_max_level(dims));
+    auto level_dims = MGARD::init_levels(dims, levels);
+    auto bin_width = MGARD::get_temporal_bin_width(eb.empty() ? vector<double>(1, 0) : eb, levels);
+    bool exact_levels = true, same_values = true;
+    for(size_t t=0; t<6; t++){
+        auto data = generate_step<T>(dims, t);
+        vector<T> exact(data);
+        MGARD::Decomposer<T> reference_decomposer;
+        reference_decomposer.decompose(exact.data(), dims, target_level);
+        MGARD::TemporalFrame<T> frame;
+        decomposer.decompose(data.data(), dims, target_level, frame);
+        MGARD::for_each_level_value(dims, level_dims, NULL, [&](size_t b, size_t p, int l){
+            if((bin_width[l] <= 0) && ((data[p] != exact[p]) || frame.codes[p])) exact_levels = false;
+        });
+        vector<T> expected(data);
+        MGARD::Recomposer<T> reference_recomposer;
+        reference_recomposer.recompose(expected.data(), dims, levels);
+        vector<T> decoded(data.size());
+        if(!recomposer.recompose(frame, dims, target_level, decoded.data()) || (decoded != expected)) same_values = false;
+    }
+    string name = describe(dims) + (eb.empty() ? ", default eb" : ", eb " + format(eb[0]) + " on level 0");
+    check(exact_levels, name + ": coefficients of the levels with eb <= 0 stored as is");
+    check(same_values, name + ": frames recompose to the stored coefficients");
+}
+
+int main(int argc, char ** argv){
+    vector<vector<size_t>> shapes = {{257}, {33, 64}, {17, 16, 9}};
+    for(const auto& dims:shapes){
+        test_series<double>(dims, 3, 1 << 20, 1e-12);
+        test_series<float>(dims, 3, 1 << 20, 4 * FLT_EPSILON);
+        test_series<float>(dims, 3, 8, 4 * FLT_EPSILON);
+        test_out_of_order<float>(dims, 3);
+        test_lossless<float>(dims, 3, {});
+        test_lossless<double>(dims, 3, {0, 1e-3});
+        test_lossless<float>(dims, 3, {-1, 0, 1e-2});
+    }
+    return report();
+}